@@ -26,7 +26,7 @@ bool up::TransformEditComponent::syncAdd(Space& space, EntityId entityId, SceneC
 }
 
 bool up::TransformEditComponent::syncUpdate(Space& space, EntityId entityId, SceneComponent const& component) const {
-    auto& trans = *space.entities().getComponentSlow<TransformComponent>(entityId);
+    auto& trans = *space.entities().getMut<TransformComponent>(entityId);
     trans.position = data(component).position;
     trans.rotation = eulerToQuat(data(component).rotation);
     return true;
@@ -53,7 +53,7 @@ bool up::MeshEditComponent::syncAdd(Space& space, EntityId entityId, SceneCompon
 }
 
 bool up::MeshEditComponent::syncUpdate(Space& space, EntityId entityId, SceneComponent const& component) const {
-    *space.entities().getComponentSlow<MeshComponent>(entityId) =
+    *space.entities().getMut<MeshComponent>(entityId) =
         MeshComponent{.mesh = data(component).mesh, .material = data(component).material};
     return true;
 }
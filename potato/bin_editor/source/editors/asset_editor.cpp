@@ -11,11 +11,13 @@
 #include "potato/runtime/filesystem.h"
 #include "potato/runtime/path.h"
 #include "potato/runtime/resource_manifest.h"
+#include "potato/spud/ascii.h"
 #include "potato/spud/box.h"
 #include "potato/spud/delegate.h"
 #include "potato/spud/enumerate.h"
 #include "potato/spud/numeric_util.h"
 #include "potato/spud/sequence.h"
+#include "potato/spud/sort.h"
 #include "potato/spud/string.h"
 #include "potato/spud/vector.h"
 
@@ -65,7 +67,7 @@ namespace up::shell {
         , _onFileSelected(onFileSelected) {
         addPanel("Asset Tree", PanelDir::Left, [this] { _showTreeFolders(); });
 
-        _rebuild();
+        _refresh();
     }
 
     void AssetEditor::addFactory(
@@ -79,7 +81,7 @@ namespace up::shell {
 
     void AssetEditor::content(CommandManager&) {
         if (_manifestRevision != _assetLoader.manifestRevision()) {
-            _rebuild();
+            _refresh();
         }
 
         _showBreadcrumbs();
@@ -477,120 +479,114 @@ namespace up::shell {
         }
     }
 
-    void AssetEditor::_rebuild() {
+    void AssetEditor::_refresh() {
         ResourceManifest const* const manifest = _assetLoader.manifest();
         _manifestRevision = _assetLoader.manifestRevision();
 
-        uint64 const selectedId = _currentFolder < static_cast<int>(_entries.size()) ? _entries[_currentFolder].id : 0;
-
-        _entries.clear();
-        _currentFolder = 0;
-
-        auto rootOsPath = _assetEditService.makeFullPath("/");
-        auto const id = hash_value(rootOsPath);
-        _entries.push_back({.id = id, .osPath = std::move(rootOsPath), .name = "<root>", .typeHash = folderTypeHash});
-
-        if (manifest == nullptr) {
-            return;
+        // entries are patched in place rather than rebuilt, so that entry indices
+        // (current folder, history) and ids (selection) remain valid across revisions
+        if (_entries.empty()) {
+            auto rootOsPath = _assetEditService.makeFullPath("/");
+            auto const id = hash_value(rootOsPath);
+            _allocateEntry({.id = id, .osPath = std::move(rootOsPath), .name = "<root>", .typeHash = folderTypeHash});
         }
 
-        for (ResourceManifest::Record const& record : manifest->records()) {
-            auto const lastSepIndex = record.filename.find_last_of("\\/"_sv);
-            auto const start = lastSepIndex != string::npos ? lastSepIndex + 1 : 0;
+        ++_refreshMark;
+        _entries.front().refreshMark = _refreshMark;
 
-            if (record.logicalId != 0) {
-                continue;
+        if (manifest != nullptr) {
+            for (ResourceManifest::Record const& record : manifest->records()) {
+                _refreshRecord(record);
             }
+        }
 
-            if (record.type == folderType) {
-                _addFolders(record.filename);
+        // anything not visited by this refresh has been removed from the manifest
+        for (int index = 1; index != static_cast<int>(_entries.size()); ++index) {
+            Entry& entry = _entries[index];
+            if (entry.id == 0 || entry.refreshMark == _refreshMark) {
                 continue;
             }
 
-            int folderIndex = 0;
-            if (lastSepIndex != string::npos) {
-                folderIndex = _addFolders(record.filename.substr(0, lastSepIndex));
-            }
-
-            int const newIndex = static_cast<int>(_entries.size());
-            _entries.push_back(
-                {.id = hash_value(record.uuid),
-                 .uuid = record.uuid,
-                 .osPath = _assetEditService.makeFullPath(record.filename),
-                 .name = string{record.filename.substr(start)},
-                 .typeHash = hash_value(record.type),
-                 .parentIndex = folderIndex});
-
-            if (_entries[folderIndex].firstChild == -1) {
-                _entries[folderIndex].firstChild = newIndex;
+            if (entry.typeHash == folderTypeHash) {
+                if (entry.hasRecord) {
+                    entry.hasRecord = false;
+                    _pruneFolder(index);
+                }
             }
             else {
-                for (int childIndex = _entries[folderIndex].firstChild; childIndex != -1;
-                     childIndex = _entries[childIndex].nextSibling) {
-                    if (_entries[childIndex].nextSibling == -1) {
-                        _entries[childIndex].nextSibling = newIndex;
-                        break;
-                    }
-                }
+                int const parentIndex = entry.parentIndex;
+                _removeEntry(index);
+                _pruneFolder(parentIndex);
             }
-
-            ++_entries[folderIndex].childFileCount;
         }
 
-        for (auto const& [index, entry] : enumerate(_entries)) {
-            if (entry.id == selectedId) {
-                _currentFolder = static_cast<int>(index);
-                break;
-            }
-        }
+        _sortFolders();
     }
 
-    int AssetEditor::_addFolder(string_view name, int parentIndex) {
-        UP_ASSERT(parentIndex >= 0 && parentIndex < static_cast<int>(_entries.size()));
-        UP_ASSERT(_entries[parentIndex].typeHash == folderTypeHash);
+    void AssetEditor::_refreshRecord(ResourceManifest::Record const& record) {
+        if (record.logicalId != 0) {
+            return;
+        }
 
-        Entry& parent = _entries[parentIndex];
+        if (record.type == folderType) {
+            int const folderIndex = _addFolders(record.filename);
+            _entries[folderIndex].hasRecord = true;
+            _entries[folderIndex].refreshMark = _refreshMark;
+            return;
+        }
 
-        int childIndex = -1;
-        if (parent.firstChild != -1 && _entries[parent.firstChild].typeHash == folderTypeHash) {
-            childIndex = parent.firstChild;
-            while (_entries[childIndex].nextSibling != -1) {
-                if (_entries[childIndex].name == name) {
-                    return childIndex;
-                }
-                if (_entries[_entries[childIndex].nextSibling].typeHash != folderTypeHash) {
-                    break;
-                }
-                childIndex = _entries[childIndex].nextSibling;
-            }
+        auto const lastSepIndex = record.filename.find_last_of("\\/"_sv);
+        auto const start = lastSepIndex != string::npos ? lastSepIndex + 1 : 0;
+        uint64 const recordHash = hash_combine(hash_value(record.filename), hash_value(record.type));
+        uint64 const id = hash_value(record.uuid);
 
-            if (_entries[childIndex].name == name) {
-                return childIndex;
+        int index = -1;
+        if (auto const found = _entryIndices.find(id)) {
+            index = found->value;
+            _entries[index].refreshMark = _refreshMark;
+            if (_entries[index].recordHash == recordHash) {
+                return;
             }
         }
 
-        int const newIndex = static_cast<int>(_entries.size());
+        int const folderIndex = lastSepIndex != string::npos ? _addFolders(record.filename.substr(0, lastSepIndex)) : 0;
 
-        auto osPath = path::join(path::Separator::Native, parent.osPath, name);
-        auto const id = hash_value(osPath);
-        _entries.push_back(
-            {.id = id,
-             .osPath = std::move(osPath),
-             .name = string{name},
-             .typeHash = folderTypeHash,
-             .parentIndex = parentIndex});
+        // existing records have been moved, renamed, or retyped
+        int oldParentIndex = -1;
+        if (index == -1) {
+            index = _allocateEntry({.id = id, .uuid = record.uuid, .refreshMark = _refreshMark});
+        }
+        else {
+            oldParentIndex = _entries[index].parentIndex;
+            _unlinkEntry(index);
+        }
+
+        Entry& entry = _entries[index];
+        entry.osPath = _assetEditService.makeFullPath(record.filename);
+        entry.name = string{record.filename.substr(start)};
+        entry.typeHash = hash_value(record.type);
+        entry.recordHash = recordHash;
 
-        ++parent.childFolderCount;
+        _linkEntry(index, folderIndex);
 
-        if (childIndex == -1) {
-            _entries[newIndex].nextSibling = _entries[parentIndex].firstChild;
-            _entries[parentIndex].firstChild = newIndex;
+        if (oldParentIndex != -1 && oldParentIndex != folderIndex) {
+            _pruneFolder(oldParentIndex);
         }
-        else {
-            _entries[newIndex].nextSibling = _entries[childIndex].nextSibling;
-            _entries[childIndex].nextSibling = newIndex;
+    }
+
+    int AssetEditor::_addFolder(string_view name, int parentIndex) {
+        UP_ASSERT(parentIndex >= 0 && parentIndex < static_cast<int>(_entries.size()));
+        UP_ASSERT(_entries[parentIndex].typeHash == folderTypeHash);
+
+        auto osPath = path::join(path::Separator::Native, _entries[parentIndex].osPath, name);
+        auto const id = hash_value(osPath);
+        if (auto const found = _entryIndices.find(id)) {
+            return found->value;
         }
 
+        int const newIndex = _allocateEntry(
+            {.id = id, .osPath = std::move(osPath), .name = string{name}, .typeHash = folderTypeHash});
+        _linkEntry(newIndex, parentIndex);
         return newIndex;
     }
 
@@ -612,6 +608,165 @@ namespace up::shell {
         return folderIndex;
     }
 
+    int AssetEditor::_allocateEntry(Entry entry) {
+        int index = static_cast<int>(_entries.size());
+        if (!_freeEntries.empty()) {
+            index = _freeEntries.back();
+            _freeEntries.pop_back();
+            _entries[index] = std::move(entry);
+        }
+        else {
+            _entries.push_back(std::move(entry));
+        }
+
+        _entryIndices.insert(_entries[index].id, index);
+        return index;
+    }
+
+    void AssetEditor::_removeEntry(int index) {
+        UP_ASSERT(index > 0 && index < static_cast<int>(_entries.size()));
+        UP_ASSERT(_entries[index].firstChild == -1);
+
+        int const parentIndex = _entries[index].parentIndex;
+
+        _unlinkEntry(index);
+        _entryIndices.erase(_entries[index].id);
+        _selection.select(_entries[index].id, false);
+
+        // fall back to the parent for any navigation state referring to the removed folder
+        if (_currentFolder == index) {
+            _currentFolder = parentIndex;
+        }
+        for (int& historyIndex : _folderHistory) {
+            if (historyIndex == index) {
+                historyIndex = parentIndex;
+            }
+        }
+
+        _entries[index] = {};
+        _freeEntries.push_back(index);
+    }
+
+    void AssetEditor::_pruneFolder(int index) {
+        // implicit folders only exist to hold their children
+        while (index > 0 && _entries[index].firstChild == -1 && !_entries[index].hasRecord) {
+            int const parentIndex = _entries[index].parentIndex;
+            _removeEntry(index);
+            index = parentIndex;
+        }
+    }
+
+    void AssetEditor::_linkEntry(int index, int parentIndex) {
+        Entry& entry = _entries[index];
+        Entry& parent = _entries[parentIndex];
+
+        entry.parentIndex = parentIndex;
+        entry.prevSibling = -1;
+        entry.nextSibling = parent.firstChild;
+        if (parent.firstChild != -1) {
+            _entries[parent.firstChild].prevSibling = index;
+        }
+        parent.firstChild = index;
+
+        if (entry.typeHash == folderTypeHash) {
+            ++parent.childFolderCount;
+        }
+        else {
+            ++parent.childFileCount;
+        }
+
+        _markUnsorted(parentIndex);
+    }
+
+    void AssetEditor::_unlinkEntry(int index) {
+        Entry& entry = _entries[index];
+        if (entry.parentIndex == -1) {
+            return;
+        }
+
+        Entry& parent = _entries[entry.parentIndex];
+        if (entry.prevSibling != -1) {
+            _entries[entry.prevSibling].nextSibling = entry.nextSibling;
+        }
+        else {
+            parent.firstChild = entry.nextSibling;
+        }
+        if (entry.nextSibling != -1) {
+            _entries[entry.nextSibling].prevSibling = entry.prevSibling;
+        }
+
+        if (entry.typeHash == folderTypeHash) {
+            --parent.childFolderCount;
+        }
+        else {
+            --parent.childFileCount;
+        }
+
+        entry.parentIndex = entry.prevSibling = entry.nextSibling = -1;
+    }
+
+    void AssetEditor::_markUnsorted(int folderIndex) {
+        if (!_entries[folderIndex].sortDirty) {
+            _entries[folderIndex].sortDirty = true;
+            _unsortedFolders.push_back(folderIndex);
+        }
+    }
+
+    void AssetEditor::_sortFolders() {
+        auto const isBefore = [this](int lhsIndex, int rhsIndex) {
+            Entry const& lhs = _entries[lhsIndex];
+            Entry const& rhs = _entries[rhsIndex];
+
+            // folders are listed before assets
+            bool const lhsFolder = lhs.typeHash == folderTypeHash;
+            bool const rhsFolder = rhs.typeHash == folderTypeHash;
+            if (lhsFolder != rhsFolder) {
+                return lhsFolder;
+            }
+
+            size_t const length = min(lhs.name.size(), rhs.name.size());
+            for (size_t index = 0; index != length; ++index) {
+                char const lhsChar = ascii::toLowercase(lhs.name[index]);
+                char const rhsChar = ascii::toLowercase(rhs.name[index]);
+                if (lhsChar != rhsChar) {
+                    return lhsChar < rhsChar;
+                }
+            }
+            return lhs.name.size() < rhs.name.size();
+        };
+
+        // only folders whose children changed since the last refresh are re-sorted
+        vector<int> children;
+        for (int const folderIndex : _unsortedFolders) {
+            if (!_entries[folderIndex].sortDirty) {
+                continue;
+            }
+            _entries[folderIndex].sortDirty = false;
+
+            children.clear();
+            for (int childIndex = _entries[folderIndex].firstChild; childIndex != -1;
+                 childIndex = _entries[childIndex].nextSibling) {
+                children.push_back(childIndex);
+            }
+
+            sort(children, isBefore);
+
+            int prevIndex = -1;
+            for (int const childIndex : children) {
+                _entries[childIndex].prevSibling = prevIndex;
+                _entries[childIndex].nextSibling = -1;
+                if (prevIndex == -1) {
+                    _entries[folderIndex].firstChild = childIndex;
+                }
+                else {
+                    _entries[prevIndex].nextSibling = childIndex;
+                }
+                prevIndex = childIndex;
+            }
+        }
+        _unsortedFolders.clear();
+    }
+
     void AssetEditor::_openFolder(int index) {
         // cut any of the "future" history
         if (_folderHistory.size() > _folderHistoryIndex + 1) {
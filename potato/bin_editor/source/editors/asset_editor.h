@@ -6,10 +6,12 @@
 #include "potato/editor/editor.h"
 #include "potato/editor/selection.h"
 #include "potato/runtime/asset_loader.h"
+#include "potato/runtime/resource_manifest.h"
 #include "potato/runtime/uuid.h"
 #include "potato/spud/delegate.h"
 #include "potato/spud/generator.h"
 #include "potato/spud/hash.h"
+#include "potato/spud/hash_map.h"
 #include "potato/spud/string.h"
 #include "potato/spud/vector.h"
 
@@ -53,11 +55,16 @@ namespace up::shell {
             string osPath;
             string name;
             uint64 typeHash = 0;
+            uint64 recordHash = 0;
             size_t size = 0;
             uint32 childFileCount = 0;
             uint32 childFolderCount = 0;
+            uint32 refreshMark = 0;
+            bool hasRecord = false;
+            bool sortDirty = false;
             int firstChild = -1;
             int nextSibling = -1;
+            int prevSibling = -1;
             int parentIndex = -1;
         };
 
@@ -93,10 +100,19 @@ namespace up::shell {
         void _showNewFolderDialog();
         void _showNewAssetDialog();
 
-        void _rebuild();
+        void _refresh();
+        void _refreshRecord(ResourceManifest::Record const& record);
         int _addFolder(string_view name, int parentIndex = 0);
         int _addFolders(string_view folderPath);
 
+        int _allocateEntry(Entry entry);
+        void _removeEntry(int index);
+        void _pruneFolder(int index);
+        void _linkEntry(int index, int parentIndex);
+        void _unlinkEntry(int index);
+        void _markUnsorted(int folderIndex);
+        void _sortFolders();
+
         void _openFolder(int index);
         void _importAsset(UUID const& uuid, bool force = false);
 
@@ -114,8 +130,12 @@ namespace up::shell {
         OnFileSelected& _onFileSelected;
         SelectionState _selection;
         vector<Entry> _entries;
+        vector<int> _freeEntries;
+        vector<int> _unsortedFolders;
+        hash_map<uint64, int> _entryIndices;
         int _currentFolder = 0;
         int _manifestRevision = 0;
+        uint32 _refreshMark = 0;
         Command _command = Command::None;
         char _nameBuffer[128] = {0};
         char _renameBuffer[128] = {0};
@@ -156,7 +156,7 @@ namespace up::shell {
 
     void GameEditor::tick(float deltaTime) {
         if (!_paused) {
-            _space->update(deltaTime);
+            _space->advance(deltaTime);
         }
     }
 
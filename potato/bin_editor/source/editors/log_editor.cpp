@@ -1,7 +1,6 @@
 // Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
 
 #include "log_editor.h"
-#include "../log_history.h"
 
 #include "potato/editor/imgui_ext.h"
 #include "potato/editor/workspace.h"
@@ -61,6 +60,24 @@ void up::shell::LogEditor::content(CommandManager&) {
 
         ImGui::SameLine();
 
+        if (ImGui::BeginCombo(
+                "Category",
+                _category == LogFilter::anyCategory ? "All" : _history.categoryName(_category).c_str())) {
+            if (ImGui::Selectable("All", _category == LogFilter::anyCategory)) {
+                _category = LogFilter::anyCategory;
+            }
+            uint32 index = 0;
+            for (string const& category : _history.categories()) {
+                if (ImGui::Selectable(category.c_str(), _category == index)) {
+                    _category = index;
+                }
+                ++index;
+            }
+            ImGui::EndCombo();
+        }
+
+        ImGui::SameLine();
+
         ImGui::InputText("Filter", _filter, sizeof(_filter));
 
         ImGui::SameLine();
@@ -85,7 +102,8 @@ void up::shell::LogEditor::content(CommandManager&) {
         ImGui::GetContentRegionAvail() - statusSize,
         ImGuiWindowFlags_AlwaysVerticalScrollbar);
 
-    size_t displayed = 0;
+    _results.setFilter({.mask = _mask, .category = _category, .text = string(_filter)});
+    _results.update(_history);
 
     if (ImGui::BeginTable(
             "##logs",
@@ -98,37 +116,32 @@ void up::shell::LogEditor::content(CommandManager&) {
         ImGui::TableSetupColumn("Location", ImGuiTableColumnFlags_None, 4);
         ImGui::TableHeadersRow();
 
-        for (LogEntry const& log : _history.logs()) {
-            if ((to_underlying(toMask(log.severity)) & to_underlying(_mask)) == 0) {
-                continue;
-            }
-
-            if (_filter[0] != '\0' &&
-                stringIndexOfNoCase(log.message.c_str(), log.message.size(), _filter, stringLength(_filter)) == -1) {
-                continue;
-            }
-
-            ImColor const color = log.severity == LogSeverity::Error ? ImColor(1.f, 0.f, 0.f, 1.f)
-                                                                     : ImColor(ImGui::GetColorU32(ImGuiCol_Text));
-
-            ImGui::TableNextRow();
-            ImGui::TableNextColumn();
-            ImGui::TextColored(color, "%s", toString(log.severity).c_str());
-            ImGui::TableNextColumn();
-            ImGui::TextColored(color, "%s", log.category.c_str());
-            ImGui::TableNextColumn();
-            ImGui::TextColored(color, "%s", log.message.c_str());
-            if (log.count > 1) {
-                ImGui::SameLine();
-                ImGui::TextDisabled(" (x%u)", static_cast<unsigned>(log.count));
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(_results.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row != clipper.DisplayEnd; ++row) {
+                LogEntry const& log = _history.entry(_results[row]);
+
+                ImColor const color = log.severity == LogSeverity::Error ? ImColor(1.f, 0.f, 0.f, 1.f)
+                                                                         : ImColor(ImGui::GetColorU32(ImGuiCol_Text));
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextColored(color, "%s", toString(log.severity).c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextColored(color, "%s", _history.categoryName(log.category).c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextColored(color, "%.*s", static_cast<int>(log.message.size()), log.message.data());
+                if (log.count > 1) {
+                    ImGui::SameLine();
+                    ImGui::TextDisabled(" (x%u)", static_cast<unsigned>(log.count));
+                }
             }
-
-            ++displayed;
         }
 
         _stickyBottom = ImGui::IsWindowAppearing() || (ImGui::GetScrollY() >= ImGui::GetScrollMaxY());
         if (_stickyBottom) {
-            ImGui::ScrollToItem();
+            ImGui::SetScrollHereY(1.f);
         }
 
         ImGui::EndTable();
@@ -137,7 +150,8 @@ void up::shell::LogEditor::content(CommandManager&) {
     ImGui::EndChildFrame();
 
     ImGui::TextDisabled(
-        "Showing %u of %u logs",
-        static_cast<unsigned>(displayed),
-        static_cast<unsigned>(_history.logs().size()));
+        "Showing %u of %u logs (%llu evicted)",
+        static_cast<unsigned>(_results.size()),
+        static_cast<unsigned>(_history.size()),
+        static_cast<unsigned long long>(_history.evicted()));
 }
@@ -1,5 +1,7 @@
 // Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
 
+#include "../log_history.h"
+
 #include "potato/editor/editor.h"
 #include "potato/runtime/logger.h"
 #include "potato/spud/hash.h"
@@ -8,8 +10,6 @@
 #include "potato/spud/vector.h"
 
 namespace up::shell {
-    class LogHistory;
-
     class LogEditor : public Editor<LogEditor> {
     public:
         static constexpr EditorTypeId editorTypeId{"potato.editor.logs"};
@@ -27,7 +27,9 @@ namespace up::shell {
 
     private:
         LogHistory& _history;
+        LogFilterResults _results;
         LogSeverityMask _mask = LogSeverityMask::Everything;
+        uint32 _category = LogFilter::anyCategory;
         bool _stickyBottom = true;
         char _filter[128] = {
             0,
@@ -240,7 +240,7 @@ namespace up::shell {
             _previewScene->entities().addComponent<TransformComponent>(_cameraId);
         }
 
-        if (auto* const cameraTrans = _previewScene->entities().getComponentSlow<TransformComponent>(_cameraId);
+        if (auto* const cameraTrans = _previewScene->entities().getMut<TransformComponent>(_cameraId);
             cameraTrans != nullptr) {
             _arcball.applyToTransform(*cameraTrans);
         }
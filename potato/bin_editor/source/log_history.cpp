@@ -2,21 +2,31 @@
 
 #include "log_history.h"
 
+#include "potato/runtime/assertion.h"
+#include "potato/spud/string_util.h"
+#include "potato/spud/utility.h"
+
+namespace up::shell {
+    namespace {
+        constexpr size_t logChunkSize = 64 * 1024;
+    } // namespace
+} // namespace up::shell
+
 class up::shell::LogHistory::LogHistorySink : public LogSink {
 public:
     LogHistorySink(LogHistory& history) : _history(history) { }
 
     void log(string_view loggerName, LogSeverity severity, string_view message, LogLocation location) noexcept
         override {
-        if (!_history._logs.empty()) {
-            LogEntry& last = _history._logs.back();
+        if (!_history.empty()) {
+            LogEntry& last = _history._ring[(_history._head + _history._size - 1) % _history._ring.size()];
             if (last.severity == severity && last.message == message) {
                 ++last.count;
                 return;
             }
         }
 
-        _history._logs.push_back({severity, string(message), string(loggerName), string{}});
+        _history._append(severity, loggerName, message);
 
         next(loggerName, severity, message, location);
     }
@@ -24,10 +34,168 @@ public:
     LogHistory& _history;
 };
 
-up::shell::LogHistory::LogHistory() : _sink(new_shared<LogHistorySink>(*this)) {
+up::shell::LogHistory::LogHistory(size_t capacity) : _sink(new_shared<LogHistorySink>(*this)) {
+    setCapacity(capacity);
     Logger::root().attach(_sink);
 }
 
 up::shell::LogHistory::~LogHistory() {
     Logger::root().detach(_sink.get());
 }
+
+void up::shell::LogHistory::setCapacity(size_t capacity) {
+    if (capacity == 0) {
+        capacity = 1;
+    }
+
+    while (_size > capacity) {
+        _evictOldest();
+    }
+    _releaseChunks();
+
+    vector<LogEntry> ring(capacity);
+    for (size_t index = 0; index != _size; ++index) {
+        ring[index] = _ring[(_head + index) % _ring.size()];
+    }
+    _ring = std::move(ring);
+    _head = 0;
+}
+
+auto up::shell::LogHistory::entry(uint64 sequence) const noexcept -> LogEntry const& {
+    UP_ASSERT(sequence >= _firstSequence && sequence < endSequence());
+    return _ring[(_head + static_cast<size_t>(sequence - _firstSequence)) % _ring.size()];
+}
+
+void up::shell::LogHistory::_append(LogSeverity severity, string_view category, string_view message) {
+    if (_size == _ring.size()) {
+        _evictOldest();
+        _releaseChunks();
+    }
+
+    uint64 const sequence = endSequence();
+
+    LogEntry& entry = _ring[(_head + _size) % _ring.size()];
+    entry.severity = severity;
+    entry.category = _intern(category);
+    entry.message = _store(message, sequence);
+    entry.count = 1;
+    ++_size;
+}
+
+void up::shell::LogHistory::_evictOldest() noexcept {
+    UP_ASSERT(_size != 0);
+
+    _ring[_head] = {};
+    _head = (_head + 1) % _ring.size();
+    --_size;
+    ++_firstSequence;
+}
+
+void up::shell::LogHistory::_releaseChunks() noexcept {
+    // the newest chunk is always kept as it is the active allocation target
+    size_t released = 0;
+    while (released + 1 < _chunks.size() && _chunks[released].lastSequence < _firstSequence) {
+        ++released;
+    }
+    if (released == 0) {
+        return;
+    }
+
+    for (size_t index = 0; index != released; ++index) {
+        Chunk& chunk = _chunks[index];
+        if (chunk.storage.size() == logChunkSize) {
+            chunk.used = 0;
+            _freeChunks.push_back(std::move(chunk));
+        }
+    }
+    _chunks.erase(_chunks.begin(), _chunks.begin() + released);
+}
+
+auto up::shell::LogHistory::_store(string_view text, uint64 sequence) -> string_view {
+    if (text.empty()) {
+        return {};
+    }
+
+    if (_chunks.empty() || _chunks.back().storage.size() - _chunks.back().used < text.size()) {
+        if (text.size() > logChunkSize) {
+            Chunk& oversized = _chunks.emplace_back();
+            oversized.storage.resize(text.size());
+        }
+        else if (!_freeChunks.empty()) {
+            _chunks.push_back(std::move(_freeChunks.back()));
+            _freeChunks.pop_back();
+        }
+        else {
+            _chunks.emplace_back().storage.resize(logChunkSize);
+        }
+    }
+
+    Chunk& chunk = _chunks.back();
+    char* const memory = chunk.storage.data() + chunk.used;
+    std::memcpy(memory, text.data(), text.size());
+    chunk.used += text.size();
+    chunk.lastSequence = sequence;
+    return {memory, text.size()};
+}
+
+auto up::shell::LogHistory::_intern(string_view category) -> uint32 {
+    for (uint32 index = 0; index != _categories.size(); ++index) {
+        if (_categories[index] == category) {
+            return index;
+        }
+    }
+    _categories.push_back(string(category));
+    return static_cast<uint32>(_categories.size() - 1);
+}
+
+bool up::shell::LogFilter::matches(LogEntry const& entry) const noexcept {
+    if ((to_underlying(toMask(entry.severity)) & to_underlying(mask)) == 0) {
+        return false;
+    }
+
+    if (category != anyCategory && entry.category != category) {
+        return false;
+    }
+
+    if (!text.empty() &&
+        stringIndexOfNoCase(entry.message.data(), entry.message.size(), text.data(), text.size()) == -1) {
+        return false;
+    }
+
+    return true;
+}
+
+void up::shell::LogFilterResults::setFilter(LogFilter filter) {
+    if (filter == _filter) {
+        return;
+    }
+    _filter = std::move(filter);
+    _dirty = true;
+}
+
+void up::shell::LogFilterResults::update(LogHistory const& history) {
+    if (_dirty) {
+        _matches.clear();
+        _head = 0;
+        _scanned = history.firstSequence();
+        _dirty = false;
+    }
+
+    // drop matches which have since been evicted from the history
+    while (_head != _matches.size() && _matches[_head] < history.firstSequence()) {
+        ++_head;
+    }
+    if (_head != 0 && _head >= _matches.size() / 2) {
+        _matches.erase(_matches.begin(), _matches.begin() + _head);
+        _head = 0;
+    }
+
+    if (_scanned < history.firstSequence()) {
+        _scanned = history.firstSequence();
+    }
+    for (; _scanned != history.endSequence(); ++_scanned) {
+        if (_filter.matches(history.entry(_scanned))) {
+            _matches.push_back(_scanned);
+        }
+    }
+}
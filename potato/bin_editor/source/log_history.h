@@ -1,32 +1,123 @@
 // Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
 
+#pragma once
+
 #include "potato/runtime/logger.h"
+#include "potato/spud/int_types.h"
 #include "potato/spud/rc.h"
 #include "potato/spud/string.h"
+#include "potato/spud/string_view.h"
 #include "potato/spud/vector.h"
+#include "potato/spud/zstring_view.h"
 
 namespace up::shell {
+    /// A single (possibly collapsed) log message held by a LogHistory.
+    ///
+    /// The message text is owned by the history's string arena and is only
+    /// valid until the entry is evicted.
     struct LogEntry {
         LogSeverity severity = LogSeverity::Info;
-        string message;
-        string category;
-        string location;
+        uint32 category = 0;
+        string_view message;
         size_t count = 1;
     };
 
+    /// Fixed-capacity ring of recent log messages.
+    ///
+    /// Entries are addressed by a monotonically increasing sequence number; once
+    /// the ring is full the oldest entry is evicted for every new one. Message
+    /// text is copied into chunked arenas which are recycled once every entry
+    /// referencing them has been evicted.
     class LogHistory {
     public:
-        LogHistory();
+        static constexpr size_t defaultCapacity = 16 * 1024;
+
+        explicit LogHistory(size_t capacity = defaultCapacity);
         ~LogHistory();
 
-        view<LogEntry> logs() const noexcept { return _logs; }
+        LogHistory(LogHistory const&) = delete;
+        LogHistory& operator=(LogHistory const&) = delete;
+
+        size_t capacity() const noexcept { return _ring.size(); }
+        void setCapacity(size_t capacity);
+
+        size_t size() const noexcept { return _size; }
+        bool empty() const noexcept { return _size == 0; }
+
+        /// Number of entries dropped from the history to make room for new ones.
+        uint64 evicted() const noexcept { return _firstSequence; }
+
+        /// Sequence number of the oldest live entry.
+        uint64 firstSequence() const noexcept { return _firstSequence; }
+        /// Sequence number one past the newest live entry.
+        uint64 endSequence() const noexcept { return _firstSequence + _size; }
+
+        LogEntry const& entry(uint64 sequence) const noexcept;
+
+        span<string const> categories() const noexcept { return _categories; }
+        zstring_view categoryName(uint32 category) const noexcept {
+            return category < _categories.size() ? zstring_view{_categories[category]} : ""_zsv;
+        }
 
     private:
         class LogHistorySink;
 
+        struct Chunk {
+            vector<char> storage;
+            size_t used = 0;
+            uint64 lastSequence = 0;
+        };
+
+        void _append(LogSeverity severity, string_view category, string_view message);
+        void _evictOldest() noexcept;
+        void _releaseChunks() noexcept;
+        string_view _store(string_view text, uint64 sequence);
+        uint32 _intern(string_view category);
+
         rc<LogHistorySink> _sink;
-        vector<LogEntry> _logs;
+        vector<LogEntry> _ring;
+        size_t _head = 0;
+        size_t _size = 0;
+        uint64 _firstSequence = 0;
+        vector<Chunk> _chunks;
+        vector<Chunk> _freeChunks;
+        vector<string> _categories;
 
         friend LogHistorySink;
     };
+
+    struct LogFilter {
+        static constexpr uint32 anyCategory = ~uint32{0};
+
+        LogSeverityMask mask = LogSeverityMask::Everything;
+        uint32 category = anyCategory;
+        string text;
+
+        bool matches(LogEntry const& entry) const noexcept;
+
+        friend bool operator==(LogFilter const&, LogFilter const&) noexcept = default;
+    };
+
+    /// Sequence numbers of the LogHistory entries matching a LogFilter.
+    ///
+    /// The results are maintained incrementally: update() only examines entries
+    /// appended since the previous update and discards evicted ones. Changing the
+    /// filter triggers a full rescan on the next update.
+    class LogFilterResults {
+    public:
+        LogFilter const& filter() const noexcept { return _filter; }
+        void setFilter(LogFilter filter);
+
+        void update(LogHistory const& history);
+
+        size_t size() const noexcept { return _matches.size() - _head; }
+        uint64 operator[](size_t index) const noexcept { return _matches[_head + index]; }
+
+    private:
+        LogFilter _filter;
+        vector<uint64> _matches;
+        size_t _head = 0;
+        uint64 _scanned = 0;
+        bool _dirty = true;
+    };
 } // namespace up::shell
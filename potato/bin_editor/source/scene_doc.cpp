@@ -3,6 +3,7 @@
 #include "scene_doc.h"
 
 #include "potato/game/common.h"
+#include "potato/game/components/parent_component.h"
 #include "potato/game/space.h"
 #include "potato/reflex/serialize.h"
 #include "potato/render/mesh.h"
@@ -217,16 +218,43 @@ void up::SceneDocument::syncPreview(Space& space) {
             }
         }
     }
+
+    // mirror the document hierarchy, so that transforms are relative to their parents
+    for (auto const& entity : _entities) {
+        EntityId const parentId = entity.parent != -1 ? _entities[entity.parent].previewId : EntityId::None;
+        auto const* const parent = space.entities().getComponentSlow<ParentComponent>(entity.previewId);
+        if (parentId == EntityId::None) {
+            if (parent != nullptr) {
+                space.entities().removeComponent<ParentComponent>(entity.previewId);
+            }
+        }
+        else if (parent == nullptr) {
+            space.entities().addComponent(entity.previewId, ParentComponent{parentId});
+        }
+        else if (parent->parent != parentId) {
+            space.entities().getMut<ParentComponent>(entity.previewId)->parent = parentId;
+        }
+    }
 }
 
 void up::SceneDocument::syncGame(Space& space) const {
+    vector<EntityId> entityIds;
+    entityIds.reserve(_entities.size());
+
     for (auto& entity : _entities) {
         EntityId entityId = space.entities().createEntity();
+        entityIds.push_back(entityId);
 
         for (auto& component : entity.components) {
             component->info->syncGame(space, entityId, *component);
         }
     }
+
+    for (size_t index = 0; index != _entities.size(); ++index) {
+        if (int const parent = _entities[index].parent; parent != -1) {
+            space.entities().addComponent(entityIds[index], ParentComponent{entityIds[parent]});
+        }
+    }
 }
 
 void up::SceneDocument::toJson(nlohmann::json& doc) const {
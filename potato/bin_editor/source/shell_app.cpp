@@ -28,6 +28,7 @@
 #include "potato/render/shader.h"
 #include "potato/schema/recon_messages_schema.h"
 #include "potato/schema/scene_schema.h"
+#include "potato/runtime/asset_archive.h"
 #include "potato/runtime/filesystem.h"
 #include "potato/runtime/json.h"
 #include "potato/runtime/path.h"
@@ -494,6 +495,8 @@ void up::shell::ShellApp::run() {
 
         _render();
 
+        // assets re-imported by recon are swapped in between frames
+        _assetLoader.processReloads();
         _assetLoader.collectDoomedAssets();
 
         if (_closeProject) {
@@ -641,6 +644,14 @@ bool up::shell::ShellApp::_loadConfig(zstring_view path) {
         return false;
     }
 
+    if (auto const it = jsonRoot.find("logHistoryCapacity"); it != jsonRoot.end() && it->is_number_unsigned()) {
+        _logHistory.setCapacity(it->get<size_t>());
+    }
+
+    if (auto const it = jsonRoot.find("assetRetentionBytes"); it != jsonRoot.end() && it->is_number_unsigned()) {
+        _assetLoader.setRetentionBudget(it->get<uint64>());
+    }
+
     return true;
 }
 
@@ -686,6 +697,20 @@ void up::shell::ShellApp::_loadManifest() {
         }
         string casPath = path::join(_project->libraryPath(), "cache");
         _assetLoader.bindManifest(std::move(manifest), std::move(casPath));
+
+        // an archive packed by `recon -pack` serves whatever content it holds;
+        // it's looked up by content hash, so a stale archive is merely less useful
+        string archivePath = path::join(_project->libraryPath(), "assets.pack");
+        if (_assetLoader.archive() == nullptr && fs::fileExists(archivePath)) {
+            auto archive = new_box<AssetArchive>();
+            if (auto const rs = archive->open(archivePath); rs == IOResult::Success) {
+                _logger.info("Loading assets from archive {}", archivePath);
+                _assetLoader.bindArchive(std::move(archive));
+            }
+            else {
+                _logger.error("Failed to open asset archive `{}`: {}", archivePath, rs);
+            }
+        }
     }
     else {
         _logger.error("Failed to load resource manifest");
@@ -0,0 +1,294 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "headless_app.h"
+
+#include "potato/audio/audio_engine.h"
+#include "potato/game/components/camera_component.h"
+#include "potato/game/components/demo_components.h"
+#include "potato/game/components/parent_component.h"
+#include "potato/game/components/rigidbody_component.h"
+#include "potato/game/components/transform_component.h"
+#include "potato/game/space.h"
+#include "potato/render/context.h"
+#include "potato/render/gpu_device.h"
+#include "potato/render/gpu_factory.h"
+#include "potato/render/renderer.h"
+#include "potato/runtime/filesystem.h"
+#include "potato/runtime/json.h"
+#include "potato/runtime/stream.h"
+#include "potato/spud/platform.h"
+#include "potato/spud/sort.h"
+
+#include <chrono>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <glm/trigonometric.hpp>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+#if UP_PLATFORM_WINDOWS
+#    include "potato/runtime/platform_windows.h"
+#    include <psapi.h>
+#elif UP_PLATFORM_POSIX
+#    include <sys/resource.h>
+#endif
+
+namespace up::headless {
+    namespace {
+        /// Stands in for the audio device, which CI machines don't have.
+        class NullAudioEngine final : public AudioEngine {
+        public:
+            void registerAssetBackends(AssetLoader&) override { }
+            auto play(SoundResource const*) -> PlayHandle override { return {}; }
+        };
+
+        using Clock = std::chrono::steady_clock;
+
+        double secondsSince(Clock::time_point start) noexcept {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        /// Nearest-rank percentile of sorted samples.
+        double percentile(span<double const> sorted, double fraction) noexcept {
+            if (sorted.empty()) {
+                return 0.0;
+            }
+            auto const rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+            return sorted[rank != 0 ? rank - 1 : 0];
+        }
+
+        /// Summary of timing samples, in milliseconds.
+        nlohmann::json summarize(span<double const> seconds) {
+            vector<double> sorted(seconds.begin(), seconds.end());
+            sort(sorted);
+
+            double total = 0.0;
+            for (double const sample : sorted) {
+                total += sample;
+            }
+
+            constexpr double millisecondsPerSecond = 1000.0;
+            return {
+                {"p50", percentile(sorted, 0.50) * millisecondsPerSecond},
+                {"p95", percentile(sorted, 0.95) * millisecondsPerSecond},
+                {"p99", percentile(sorted, 0.99) * millisecondsPerSecond},
+                {"max", sorted.empty() ? 0.0 : sorted.back() * millisecondsPerSecond},
+                {"mean", sorted.empty() ? 0.0 : total / static_cast<double>(sorted.size()) * millisecondsPerSecond},
+            };
+        }
+
+        /// Largest resident set of the process so far, or 0 where unknown.
+        uint64 peakMemoryBytes() noexcept {
+#if UP_PLATFORM_WINDOWS
+            PROCESS_MEMORY_COUNTERS counters = {};
+            if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+                return counters.PeakWorkingSetSize;
+            }
+            return 0;
+#elif UP_PLATFORM_POSIX
+            rusage usage = {};
+            if (getrusage(RUSAGE_SELF, &usage) != 0) {
+                return 0;
+            }
+#    if UP_PLATFORM_APPLE
+            return static_cast<uint64>(usage.ru_maxrss);
+#    else
+            return static_cast<uint64>(usage.ru_maxrss) * 1024;
+#    endif
+#else
+            return 0;
+#endif
+        }
+    } // namespace
+} // namespace up::headless
+
+up::headless::HeadlessApp::HeadlessApp() : _logger("headless") { }
+
+up::headless::HeadlessApp::~HeadlessApp() = default;
+
+bool up::headless::HeadlessApp::run(span<char const*> args) {
+    if (!parseArguments(_config, args, _logger)) {
+        _logger.error("Failed to parse arguments");
+        return false;
+    }
+
+    auto device = CreateFactoryNull()->createDevice(0);
+    if (device == nullptr) {
+        _logger.error("Failed to create null GPU device");
+        return false;
+    }
+    _renderer = new_box<Renderer>(std::move(device));
+
+    _audio = new_box<NullAudioEngine>();
+    _space = new_box<Space>();
+    Space::addDemoSystem(*_space, *_audio);
+    _space->setTickRate(_config.tickRate);
+    _space->setProfiling(true);
+
+    if (!_config.loadPath.empty()) {
+        if (!_loadWorld()) {
+            return false;
+        }
+    }
+    else {
+        _createSyntheticEntities();
+    }
+
+    if (!_config.savePath.empty() && !_saveWorld()) {
+        return false;
+    }
+
+    _initialEntityCount = _space->entities().entityCount();
+
+    _simulate();
+
+    return _writeReport();
+}
+
+bool up::headless::HeadlessApp::_loadWorld() {
+    Stream stream = fs::openRead(_config.loadPath);
+    if (!stream) {
+        _logger.error("Failed to open `{}'", _config.loadPath);
+        return false;
+    }
+
+    if (auto const rs = _space->entities().readSnapshot(stream); rs != IOResult::Success) {
+        _logger.error("Failed to load world snapshot `{}': {}", _config.loadPath, rs);
+        return false;
+    }
+    return true;
+}
+
+bool up::headless::HeadlessApp::_saveWorld() {
+    Stream stream = fs::openWrite(_config.savePath);
+    if (!stream) {
+        _logger.error("Failed to open `{}'", _config.savePath);
+        return false;
+    }
+
+    if (auto const rs = _space->entities().writeSnapshot(stream); rs != IOResult::Success) {
+        _logger.error("Failed to save world snapshot `{}': {}", _config.savePath, rs);
+        return false;
+    }
+    return true;
+}
+
+void up::headless::HeadlessApp::_createSyntheticEntities() {
+    EntityManager& entities = _space->entities();
+
+    TransformComponent eye;
+    eye.position = {0.f, 10.f, -40.f};
+    entities.createEntity(std::move(eye), CameraComponent{});
+
+    // the ring of the editor's demo scene, with a sprinkling of hierarchy and
+    // rigid bodies so that every game system has work to do
+    EntityId previous = EntityId::None;
+    for (uint32 index = 0; index != _config.entityCount; ++index) {
+        float const angle =
+            static_cast<float>(index) / static_cast<float>(_config.entityCount) * glm::two_pi<float>();
+
+        TransformComponent trans;
+        trans.position = {
+            (20.f + glm::cos(angle) * 10.f) * glm::sin(angle),
+            1.f + glm::sin(angle * 10.f) * 5.f,
+            (20.f + glm::sin(angle) * 10.f) * glm::cos(angle)};
+
+        EntityId const entityId = entities.createEntity(
+            std::move(trans),
+            DemoWaveComponent{.offset = angle},
+            DemoSpinComponent{.radians = glm::sin(angle) * 2.f - 1.f});
+
+        if (index % 8 == 7) {
+            entities.addComponent<ParentComponent>(entityId, ParentComponent{.parent = previous});
+        }
+        if (index % 32 == 0) {
+            entities.addComponent<RigidBodyComponent>(entityId);
+        }
+        previous = entityId;
+    }
+}
+
+void up::headless::HeadlessApp::_simulate() {
+    float const tickDuration = _space->tickDuration();
+
+    _frameSeconds.reserve(_config.tickCount);
+    _renderSeconds.reserve(_config.tickCount);
+
+    _space->start();
+
+    _systemSeconds.resize(_space->systems().size());
+    for (auto& samples : _systemSeconds) {
+        samples.reserve(_config.tickCount);
+    }
+
+    auto const runStart = Clock::now();
+    for (uint32 tick = 0; tick != _config.tickCount; ++tick) {
+        auto const frameStart = Clock::now();
+
+        // exactly one tick per frame, so that slow ticks are measured rather
+        // than dropped by the catch-up limit of Space::advance
+        _space->update(tickDuration);
+
+        auto const renderStart = Clock::now();
+        _renderer->beginFrame();
+        RenderContext ctx = _renderer->context();
+        _space->render(ctx);
+        ctx.finish();
+
+        _renderSeconds.push_back(secondsSince(renderStart));
+        _frameSeconds.push_back(secondsSince(frameStart));
+
+        view<double> const systemSeconds = _space->systemUpdateSeconds();
+        for (size_t index = 0; index != systemSeconds.size(); ++index) {
+            _systemSeconds[index].push_back(systemSeconds[index]);
+        }
+    }
+    _wallSeconds = secondsSince(runStart);
+
+    _space->stop();
+}
+
+bool up::headless::HeadlessApp::_writeReport() {
+    nlohmann::json systems = nlohmann::json::object();
+    view<box<System>> const spaceSystems = _space->systems();
+    for (size_t index = 0; index != spaceSystems.size(); ++index) {
+        systems[spaceSystems[index]->name().c_str()] = summarize(_systemSeconds[index]);
+    }
+
+    nlohmann::json components = nlohmann::json::object();
+    for (auto const& storage : _space->entities().storages()) {
+        components[storage->debugName().c_str()] = storage->size();
+    }
+
+    nlohmann::json const report = {
+        {"ticks", _config.tickCount},
+        {"tickRate", _config.tickRate},
+        {"wallSeconds", _wallSeconds},
+        {"peakMemoryBytes", peakMemoryBytes()},
+        {"entities",
+         {
+             {"initial", _initialEntityCount},
+             {"final", _space->entities().entityCount()},
+             {"components", std::move(components)},
+         }},
+        {"timesMs",
+         {
+             {"frame", summarize(_frameSeconds)},
+             {"render", summarize(_renderSeconds)},
+             {"systems", std::move(systems)},
+         }},
+    };
+
+    std::string const text = report.dump(4);
+    if (_config.reportPath.empty()) {
+        std::cout << text << '\n';
+        return true;
+    }
+
+    if (auto const rs = fs::writeAllText(_config.reportPath, string_view{text.data(), text.size()});
+        rs != IOResult::Success) {
+        _logger.error("Failed to write report `{}': {}", _config.reportPath, rs);
+        return false;
+    }
+    return true;
+}
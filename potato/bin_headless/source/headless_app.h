@@ -0,0 +1,50 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "headless_config.h"
+
+#include "potato/runtime/logger.h"
+#include "potato/spud/box.h"
+#include "potato/spud/span.h"
+#include "potato/spud/vector.h"
+
+namespace up {
+    class AudioEngine;
+    class Renderer;
+    class Space;
+} // namespace up
+
+namespace up::headless {
+    /// Steps a Space for a fixed number of ticks without a window, audio device or
+    /// GPU, and reports how long each tick and each system took as JSON.
+    class HeadlessApp {
+    public:
+        HeadlessApp();
+        ~HeadlessApp();
+
+        HeadlessApp(HeadlessApp const&) = delete;
+        HeadlessApp& operator=(HeadlessApp const&) = delete;
+
+        bool run(span<char const*> args);
+
+    private:
+        bool _loadWorld();
+        bool _saveWorld();
+        void _createSyntheticEntities();
+        void _simulate();
+        bool _writeReport();
+
+        HeadlessConfig _config;
+        Logger _logger;
+        box<AudioEngine> _audio;
+        box<Renderer> _renderer;
+        box<Space> _space;
+        uint32 _initialEntityCount = 0;
+        double _wallSeconds = 0.0;
+        vector<double> _frameSeconds;
+        vector<double> _renderSeconds;
+        /// Update times of each system, one vector per system in update order.
+        vector<vector<double>> _systemSeconds;
+    };
+} // namespace up::headless
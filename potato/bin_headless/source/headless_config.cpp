@@ -0,0 +1,114 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "headless_config.h"
+
+#include "potato/runtime/logger.h"
+#include "potato/spud/string_view.h"
+#include "potato/spud/zstring_view.h"
+
+#include <charconv>
+
+namespace {
+    template <typename T>
+    bool parseNumber(up::zstring_view text, T& out) {
+        char const* const end = text.c_str() + text.size();
+        auto const [last, error] = std::from_chars(text.c_str(), end, out);
+        return error == std::errc{} && last == end;
+    }
+} // namespace
+
+bool up::headless::parseArguments(HeadlessConfig& config, span<char const*> args, Logger& logger) {
+    if (args.empty()) {
+        return false;
+    }
+
+    [[maybe_unused]] auto program = args.front();
+    args.pop_front();
+
+    enum {
+        ArgNone,
+        ArgLoad,
+        ArgSave,
+        ArgReport,
+        ArgEntities,
+        ArgTicks,
+        ArgTickRate,
+    } argMode = ArgNone;
+    zstring_view argName;
+
+    for (zstring_view arg : args) {
+        if (!arg.empty() && arg.front() == '-') {
+            if (argMode != ArgNone) {
+                logger.error("Unexpected option: {}", arg.c_str());
+                return false;
+            }
+
+            auto name = arg.substr(1);
+            if (name == "load") {
+                argMode = ArgLoad;
+            }
+            else if (name == "save") {
+                argMode = ArgSave;
+            }
+            else if (name == "report") {
+                argMode = ArgReport;
+            }
+            else if (name == "entities") {
+                argMode = ArgEntities;
+            }
+            else if (name == "ticks") {
+                argMode = ArgTicks;
+            }
+            else if (name == "tick-rate") {
+                argMode = ArgTickRate;
+            }
+            else {
+                logger.error("Unknown option: {}", arg.c_str());
+                return false;
+            }
+            argName = arg;
+            continue;
+        }
+
+        switch (argMode) {
+            case ArgNone:
+                logger.error("Unexpected value: {}", arg.c_str());
+                return false;
+            case ArgLoad:
+                config.loadPath = string(arg);
+                break;
+            case ArgSave:
+                config.savePath = string(arg);
+                break;
+            case ArgReport:
+                config.reportPath = string(arg);
+                break;
+            case ArgEntities:
+                if (!parseNumber(arg, config.entityCount)) {
+                    logger.error("Invalid entity count: {}", arg.c_str());
+                    return false;
+                }
+                break;
+            case ArgTicks:
+                if (!parseNumber(arg, config.tickCount)) {
+                    logger.error("Invalid tick count: {}", arg.c_str());
+                    return false;
+                }
+                break;
+            case ArgTickRate:
+                if (!parseNumber(arg, config.tickRate) || !(config.tickRate > 0.f)) {
+                    logger.error("Invalid tick rate: {}", arg.c_str());
+                    return false;
+                }
+                break;
+        }
+        argMode = ArgNone;
+    }
+
+    if (argMode != ArgNone) {
+        logger.error("No value provided after `{}' argument", argName.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,24 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "potato/runtime/logger.h"
+#include "potato/spud/int_types.h"
+#include "potato/spud/span.h"
+#include "potato/spud/string.h"
+
+namespace up::headless {
+    struct HeadlessConfig {
+        /// World snapshot to simulate; synthetic entities are created when empty.
+        string loadPath;
+        /// Path to which the initial world is written as a snapshot, for later -load.
+        string savePath;
+        /// Path of the JSON report; written to standard output when empty.
+        string reportPath;
+        uint32 entityCount = 10'000;
+        uint32 tickCount = 600;
+        float tickRate = 60.f;
+    };
+
+    bool parseArguments(HeadlessConfig& config, span<char const*> args, Logger& logger);
+} // namespace up::headless
@@ -0,0 +1,13 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "headless_app.h"
+
+int main(int argc, char const** argv) {
+    up::headless::HeadlessApp app;
+
+    if (!app.run(up::span<char const*>{argv, static_cast<std::size_t>(argc)})) {
+        return 1;
+    }
+
+    return 0;
+}
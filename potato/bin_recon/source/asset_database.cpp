@@ -10,6 +10,8 @@
 #include "potato/spud/hash_fnv1a.h"
 #include "potato/spud/out_ptr.h"
 #include "potato/spud/string_writer.h"
+#include <algorithm>
+#include <cstring>
 
 up::AssetDatabase::~AssetDatabase() = default;
 
@@ -88,6 +90,7 @@ void up::AssetDatabase::updateSourceAsset(UUID const& uuid, string_view filename
         filename,
         sourceHash);
     UP_ASSERT(rc == SqlResult::Ok);
+    _markManifestDirty(uuid);
 }
 
 bool up::AssetDatabase::isSourceAssetUpToDate(
@@ -119,6 +122,7 @@ void up::AssetDatabase::beginAssetImport(
         importerVersion,
         uuid);
     UP_ASSERT(rc == SqlResult::Ok);
+    _markManifestDirty(uuid);
 }
 
 void up::AssetDatabase::finishAssetImport(UUID const& uuid, bool success) {
@@ -127,10 +131,12 @@ void up::AssetDatabase::finishAssetImport(UUID const& uuid, bool success) {
     UP_ASSERT(rc == SqlResult::Ok);
     (void)_db.execute("DELETE FROM imported_assets WHERE uuid=?", uuid);
     (void)_db.execute("DELETE FROM import_dependencies WHERE uuid=?", uuid);
+    _markManifestDirty(uuid);
 }
 
 bool up::AssetDatabase::removeSourceAsset(UUID const& uuid) {
     (void)_db.execute("DELETE FROM source_assets WHERE uuid=?", uuid);
+    _markManifestDirty(uuid);
     return true;
 }
 
@@ -147,6 +153,7 @@ void up::AssetDatabase::addAssetImport(UUID const& uuid, zstring_view name, zstr
         name,
         assetType,
         outputHash);
+    _markManifestDirty(uuid);
 }
 
 bool up::AssetDatabase::open(zstring_view filename) {
@@ -194,6 +201,15 @@ bool up::AssetDatabase::open(zstring_view filename) {
         return false;
     }
 
+    // indices for the joins used by manifest generation and dependency lookups
+    if (_db.execute("CREATE INDEX IF NOT EXISTS imported_assets_uuid ON imported_assets(uuid)") != SqlResult::Ok) {
+        return false;
+    }
+    if (_db.execute("CREATE INDEX IF NOT EXISTS import_dependencies_path ON import_dependencies(path)") !=
+        SqlResult::Ok) {
+        return false;
+    }
+
     // ensure any left-over source_assets are transitioned to failed status
     (void)_db.execute("UPDATE source_assets SET status='FAILED' WHERE status<>'IMPORTED'");
 
@@ -201,14 +217,16 @@ bool up::AssetDatabase::open(zstring_view filename) {
 }
 
 bool up::AssetDatabase::close() {
+    invalidateManifest();
     _db.close();
     return true;
 }
 
-void up::AssetDatabase::generateManifest(string_writer& writer) {
-    writer.append("# Potato Manifest\n");
-    writer.format(".version={}\n", ResourceManifest::version);
-    writer.format(
+auto up::AssetDatabase::generateManifest(Stream& stream) -> IOResult {
+    string_writer header;
+    header.append("# Potato Manifest\n");
+    header.format(".version={}\n", ResourceManifest::version);
+    header.format(
         ":{}|{}|{}|{}|{}|{}\n",
         ResourceManifest::columnUuid,
         ResourceManifest::columnLogicalId,
@@ -216,32 +234,149 @@ void up::AssetDatabase::generateManifest(string_writer& writer) {
         ResourceManifest::columnContentType,
         ResourceManifest::columnContentHash,
         ResourceManifest::columnDebugName);
+    if (IOResult const rs = writeAllText(stream, header); rs != IOResult::Success) {
+        return rs;
+    }
 
-    char fullName[1024];
+    if (!_manifestCached) {
+        return _rebuildManifest(stream);
+    }
+
+    for (UUID const& uuid : _manifestDirty) {
+        _updateManifestBlock(uuid);
+    }
+    _manifestDirty.clear();
+    _manifestDirtySet.clear();
 
-    for (auto const& [uuid, filename, assetType] :
-         _db.query<zstring_view, zstring_view, zstring_view>("SELECT uuid, path, asset_type FROM source_assets")) {
-        writer.format("{}|||{}||{}\n", uuid, assetType, filename);
+    for (ManifestBlock const& block : _manifestBlocks) {
+        if (IOResult const rs = writeAllText(stream, block.text); rs != IOResult::Success) {
+            return rs;
+        }
     }
+    return IOResult::Success;
+}
+
+void up::AssetDatabase::invalidateManifest() noexcept {
+    _manifestCached = false;
+    _manifestBlocks.clear();
+    _manifestDirty.clear();
+    _manifestDirtySet.clear();
+}
 
-    for (auto const& [uuid, filename] : _db.query<UUID, zstring_view>("SELECT uuid, path FROM source_assets")) {
-        for (auto const& [logicalId, logicalName, outputType, outputHash] :
-             _db.query<AssetId, zstring_view, zstring_view, uint64>(
-                 "SELECT id, name, type, hash FROM imported_assets WHERE uuid=?",
-                 uuid)) {
-            nanofmt::format_to(fullName, "{}", filename);
-            if (!logicalName.empty()) {
-                nanofmt::format_append_to(fullName, ":{}", logicalName);
+void up::AssetDatabase::_markManifestDirty(UUID const& uuid) {
+    if (_manifestCached && _manifestDirtySet.insert(uuid)) {
+        _manifestDirty.push_back(uuid);
+    }
+}
+
+auto up::AssetDatabase::_rebuildManifest(Stream& stream) -> IOResult {
+    invalidateManifest();
+
+    // a single ordered join yields each source asset's rows contiguously, so each
+    // block is complete (and can be written out) as soon as the uuid changes; after
+    // a failed write the blocks are still cached, but nothing more is written
+    string_writer block;
+    UUID blockUuid;
+    IOResult result = IOResult::Success;
+    auto const flush = [&] {
+        if (!block.empty()) {
+            if (result == IOResult::Success) {
+                result = writeAllText(stream, block);
             }
+            _manifestBlocks.push_back({.uuid = blockUuid, .text = string{string_view{block}}});
+            block.clear();
+        }
+    };
+
+    for (auto const& [uuid, filename, assetType, imported, logicalName, outputType, outputHash] :
+         _db.query<UUID, zstring_view, zstring_view, bool, zstring_view, zstring_view, uint64>(
+             "SELECT source_assets.uuid, source_assets.path, source_assets.asset_type, "
+             "imported_assets.uuid IS NOT NULL, imported_assets.name, imported_assets.type, imported_assets.hash "
+             "FROM source_assets LEFT JOIN imported_assets ON imported_assets.uuid=source_assets.uuid "
+             "ORDER BY source_assets.uuid")) {
+        if (block.empty() || uuid != blockUuid) {
+            flush();
+            blockUuid = uuid;
+            _formatManifestSource(block, uuid, filename, assetType);
+        }
+        if (imported) {
+            _formatManifestImport(block, uuid, filename, logicalName, outputType, outputHash);
+        }
+    }
+    flush();
 
-            writer.format(
-                "{}|{:016X}|{}|{}|{:016X}|{}\n",
-                uuid,
-                createLogicalAssetId(uuid, logicalName),
-                logicalName,
-                outputType,
-                outputHash,
-                fullName);
+    _manifestCached = true;
+    return result;
+}
+
+void up::AssetDatabase::_updateManifestBlock(UUID const& uuid) {
+    string_writer block;
+    for (auto const& [filename, assetType, imported, logicalName, outputType, outputHash] :
+         _db.query<zstring_view, zstring_view, bool, zstring_view, zstring_view, uint64>(
+             "SELECT source_assets.path, source_assets.asset_type, "
+             "imported_assets.uuid IS NOT NULL, imported_assets.name, imported_assets.type, imported_assets.hash "
+             "FROM source_assets LEFT JOIN imported_assets ON imported_assets.uuid=source_assets.uuid "
+             "WHERE source_assets.uuid=?",
+             uuid)) {
+        if (block.empty()) {
+            _formatManifestSource(block, uuid, filename, assetType);
         }
+        if (imported) {
+            _formatManifestImport(block, uuid, filename, logicalName, outputType, outputHash);
+        }
+    }
+
+    // SQLite orders uuids by their lowercase hex text, which follows their byte order
+    auto const it = std::lower_bound(
+        _manifestBlocks.begin(),
+        _manifestBlocks.end(),
+        uuid,
+        [](ManifestBlock const& block, UUID const& key) {
+            return std::memcmp(block.uuid.bytes(), key.bytes(), UUID::octects) < 0;
+        });
+    bool const found = it != _manifestBlocks.end() && it->uuid == uuid;
+
+    if (block.empty()) {
+        // source asset was removed
+        if (found) {
+            _manifestBlocks.erase(it);
+        }
+    }
+    else if (found) {
+        it->text = string{string_view{block}};
+    }
+    else {
+        _manifestBlocks.insert(it, ManifestBlock{.uuid = uuid, .text = string{string_view{block}}});
+    }
+}
+
+void up::AssetDatabase::_formatManifestSource(
+    string_writer& writer,
+    UUID const& uuid,
+    zstring_view filename,
+    zstring_view assetType) {
+    writer.format("{}|||{}||{}\n", uuid, assetType, filename);
+}
+
+void up::AssetDatabase::_formatManifestImport(
+    string_writer& writer,
+    UUID const& uuid,
+    zstring_view filename,
+    zstring_view logicalName,
+    zstring_view outputType,
+    uint64 outputHash) {
+    char fullName[1024];
+    nanofmt::format_to(fullName, "{}", filename);
+    if (!logicalName.empty()) {
+        nanofmt::format_append_to(fullName, ":{}", logicalName);
     }
+
+    writer.format(
+        "{}|{:016X}|{}|{}|{:016X}|{}\n",
+        uuid,
+        createLogicalAssetId(uuid, logicalName),
+        logicalName,
+        outputType,
+        outputHash,
+        fullName);
 }
@@ -5,8 +5,10 @@
 #include "posql.h"
 
 #include "potato/runtime/asset.h"
+#include "potato/runtime/io_result.h"
 #include "potato/runtime/uuid.h"
 #include "potato/spud/generator.h"
+#include "potato/spud/hash_set.h"
 #include "potato/spud/string.h"
 #include "potato/spud/string_view.h"
 #include "potato/spud/string_writer.h"
@@ -72,7 +74,13 @@ namespace up {
         bool open(zstring_view filename);
         bool close();
 
-        void generateManifest(string_writer& writer);
+        /// Writes the manifest to the stream. After the first call, only the source
+        /// assets modified since the previous call are queried from the database.
+        /// Returns the first failed write, if any.
+        [[nodiscard]] IOResult generateManifest(Stream& stream);
+        void invalidateManifest() noexcept;
+
+        StatementCacheStats statementCacheStats() const noexcept { return _db.statementCacheStats(); }
 
         template <callable<posql::Transaction&> Fn>
         void transact(Fn&& fn) {
@@ -86,6 +94,32 @@ namespace up {
             constexpr uint64 operator()(AssetId assetId) const noexcept { return assetId.value(); }
         };
 
+        struct ManifestBlock {
+            UUID uuid;
+            string text;
+        };
+
+        void _markManifestDirty(UUID const& uuid);
+        IOResult _rebuildManifest(Stream& stream);
+        void _updateManifestBlock(UUID const& uuid);
+        static void _formatManifestSource(
+            string_writer& writer,
+            UUID const& uuid,
+            zstring_view filename,
+            zstring_view assetType);
+        static void _formatManifestImport(
+            string_writer& writer,
+            UUID const& uuid,
+            zstring_view filename,
+            zstring_view logicalName,
+            zstring_view outputType,
+            uint64 outputHash);
+
         Database _db;
+        /// Sorted by uuid, in the order of the full rebuild's query.
+        vector<ManifestBlock> _manifestBlocks;
+        vector<UUID> _manifestDirty;
+        hash_set<UUID> _manifestDirtySet;
+        bool _manifestCached = false;
     };
 } // namespace up
@@ -3,6 +3,8 @@
 #include "posql.h"
 
 #include "potato/runtime/assertion.h"
+#include "potato/spud/hash.h"
+#include "potato/spud/sort.h"
 
 #include <sqlite3.h>
 
@@ -18,6 +20,11 @@ up::SqlResult up::Database::open(zstring_view file_name) noexcept {
 }
 
 void up::Database::close() noexcept {
+    // a live cursor would be left stepping a finalized statement on a closed connection
+    for (CachedStatement const& cached : _statements) {
+        UP_ASSERT(!cached.stmt->leased, "database closed while a query is still live: {}", cached.sql);
+    }
+    _clearStatementCache();
     sqlite3_close(_conn);
     _conn = nullptr;
 }
@@ -30,6 +37,107 @@ up::Transaction up::Database::begin() noexcept {
     return Transaction(_conn);
 }
 
+auto up::Database::statementCacheStats() const noexcept -> StatementCacheStats {
+    return {
+        .hits = _statementHits,
+        .misses = _statementMisses,
+        .evictions = _statementEvictions,
+        .size = _statements.size(),
+        .capacity = _statementCapacity};
+}
+
+void up::Database::setStatementCacheCapacity(size_t capacity) noexcept {
+    _statementCapacity = capacity;
+    if (_statements.size() <= _statementCapacity) {
+        return;
+    }
+
+    // keep the most-recently used statements; an evicted statement that is still
+    // leased lives on until its cursor releases it
+    sort(_statements, [](CachedStatement const& lhs, CachedStatement const& rhs) {
+        return lhs.lastUsed > rhs.lastUsed;
+    });
+    _statementEvictions += _statements.size() - _statementCapacity;
+    _statements.erase(_statements.begin() + _statementCapacity, _statements.end());
+
+    _statementIndices.clear();
+    for (size_t index = 0; index != _statements.size(); ++index) {
+        _statementIndices.insert(_statements[index].hash, index);
+    }
+}
+
+auto up::Database::_acquire(string_view sql) -> sqlutil::StmtLease {
+    uint64 const hash = hash_value(sql);
+    ++_statementClock;
+
+    if (auto const found = _statementIndices.find(hash)) {
+        CachedStatement& cached = _statements[found->value];
+
+        // a statement still held by an outstanding cursor cannot be rebound, and a
+        // hash collision cannot be reused; either way fall back to a fresh compile
+        if (!cached.stmt->leased && string_view{cached.sql} == sql) {
+            ++_statementHits;
+            cached.lastUsed = _statementClock;
+            sqlutil::reset(cached.stmt->stmt);
+            return sqlutil::StmtLease{cached.stmt};
+        }
+
+        ++_statementMisses;
+        sqlite3_stmt* const stmt = sqlutil::compile(_conn, sql);
+        if (stmt == nullptr) {
+            return {};
+        }
+        return sqlutil::StmtLease{new_shared<sqlutil::Stmt>(stmt)};
+    }
+
+    ++_statementMisses;
+
+    sqlite3_stmt* const stmt = sqlutil::compile(_conn, sql);
+    if (stmt == nullptr) {
+        return {};
+    }
+
+    auto shared = new_shared<sqlutil::Stmt>(stmt);
+    if (_statementCapacity == 0) {
+        return sqlutil::StmtLease{std::move(shared)};
+    }
+
+    size_t index = _statements.size();
+    if (_statements.size() >= _statementCapacity) {
+        // evict the least-recently used statement that is not currently in use
+        index = _statements.size();
+        for (size_t candidate = 0; candidate != _statements.size(); ++candidate) {
+            if (!_statements[candidate].stmt->leased &&
+                (index == _statements.size() || _statements[candidate].lastUsed < _statements[index].lastUsed)) {
+                index = candidate;
+            }
+        }
+        if (index == _statements.size()) {
+            return sqlutil::StmtLease{std::move(shared)};
+        }
+
+        ++_statementEvictions;
+        _statementIndices.erase(_statements[index].hash);
+    }
+    else {
+        _statements.emplace_back();
+    }
+
+    CachedStatement& cached = _statements[index];
+    cached.sql = string{sql};
+    cached.hash = hash;
+    cached.lastUsed = _statementClock;
+    cached.stmt = shared;
+    _statementIndices.insert(hash, index);
+
+    return sqlutil::StmtLease{std::move(shared)};
+}
+
+void up::Database::_clearStatementCache() noexcept {
+    _statementIndices.clear();
+    _statements.clear();
+}
+
 void up::Transaction::commit() {
     if (_conn != nullptr) {
         sqlite3_exec(_conn, "COMMIT", nullptr, nullptr, nullptr);
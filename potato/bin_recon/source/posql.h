@@ -5,9 +5,13 @@
 #include "potato/runtime/assertion.h"
 #include "potato/runtime/uuid.h"
 #include "potato/spud/concepts.h"
+#include "potato/spud/hash_map.h"
+#include "potato/spud/int_types.h"
 #include "potato/spud/rc.h"
+#include "potato/spud/string.h"
 #include "potato/spud/typelist.h"
 #include "potato/spud/utility.h"
+#include "potato/spud/vector.h"
 #include "potato/spud/zstring_view.h"
 
 #include <tuple>
@@ -81,6 +85,44 @@ namespace up {
                 explicit Stmt(sqlite3_stmt* s) noexcept : stmt(s) { }
                 virtual ~Stmt() { destroy(stmt); }
                 sqlite3_stmt* stmt = nullptr;
+                bool leased = false;
+            };
+
+            // Marks a statement as in-use for the lifetime of the lease, and resets
+            // it when released so that an abandoned cursor never leaves a cached
+            // statement mid-iteration.
+            class StmtLease {
+            public:
+                StmtLease() noexcept = default;
+                explicit StmtLease(rc<Stmt> stmt) noexcept : _stmt(std::move(stmt)) {
+                    if (_stmt != nullptr) {
+                        _stmt->leased = true;
+                    }
+                }
+                ~StmtLease() { release(); }
+
+                StmtLease(StmtLease&& rhs) noexcept : _stmt(std::move(rhs._stmt)) { }
+                StmtLease& operator=(StmtLease&& rhs) noexcept {
+                    if (this != &rhs) {
+                        release();
+                        _stmt = std::move(rhs._stmt);
+                    }
+                    return *this;
+                }
+
+                [[nodiscard]] sqlite3_stmt* get() const noexcept { return _stmt != nullptr ? _stmt->stmt : nullptr; }
+                [[nodiscard]] explicit operator bool() const noexcept { return _stmt != nullptr; }
+
+                void release() noexcept {
+                    if (_stmt != nullptr) {
+                        reset(_stmt->stmt);
+                        _stmt->leased = false;
+                        _stmt = nullptr;
+                    }
+                }
+
+            private:
+                rc<Stmt> _stmt;
             };
 
         } // namespace sqlutil
@@ -103,20 +145,33 @@ namespace up {
             using iterator = Cursor<T...>;
             using sentinel = QuerySentinel;
 
+            Query(Query&&) noexcept = default;
+            Query& operator=(Query&&) noexcept = default;
+
             iterator begin() noexcept { return iterator(std::move(_stmt)); }
             sentinel end() noexcept { return sentinel{}; }
 
         private:
-            explicit Query(rc<sqlutil::Stmt> stmt) : _stmt(std::move(stmt)) { }
+            explicit Query(sqlutil::StmtLease stmt) noexcept : _stmt(std::move(stmt)) { }
 
-            rc<sqlutil::Stmt> _stmt;
+            sqlutil::StmtLease _stmt;
 
             friend Statement;
             friend Database;
         };
 
+        struct StatementCacheStats {
+            uint64 hits = 0;
+            uint64 misses = 0;
+            uint64 evictions = 0;
+            size_t size = 0;
+            size_t capacity = 0;
+        };
+
         class Database {
         public:
+            static constexpr size_t defaultStatementCacheCapacity = 64;
+
             Database() noexcept = default;
             ~Database() noexcept { close(); }
 
@@ -134,40 +189,60 @@ namespace up {
             template <typename... T>
             [[nodiscard]] SqlResult execute(string_view sql, T const&... args) {
                 UP_GUARD(_conn != nullptr, SqlResult::Invalid);
-                sqlite3_stmt* stmt = compile(sql, args...);
-                SqlResult const result = stmt ? SqlResult::Ok : SqlResult::Error;
-                sqlutil::destroy(stmt);
-                return result;
+                sqlutil::StmtLease const stmt = compile(sql, args...);
+                return stmt ? SqlResult::Ok : SqlResult::Error;
             }
 
             template <typename... R, typename... T>
             [[nodiscard]] Query<R...> query(string_view sql, T const&... args) {
                 UP_ASSERT(_conn != nullptr);
-                return Query<R...>{new_shared<sqlutil::Stmt>(compile(sql, args...))};
+                return Query<R...>{compile(sql, args...)};
             }
 
             template <typename... R, typename... T>
             [[nodiscard]] auto queryOne(string_view sql, T const&... args) {
                 UP_ASSERT(_conn != nullptr);
-                sqlutil::Stmt stmt(compile(sql, args...));
-                auto const rs = sqlutil::fetchColumns<R...>(stmt.stmt);
+                sqlutil::StmtLease const stmt = compile(sql, args...);
+                auto const rs = sqlutil::fetchColumns<R...>(stmt.get());
                 return rs;
             }
 
             [[nodiscard]] Transaction begin() noexcept;
 
+            /// Statements compiled by execute(), query(), and queryOne() are kept in
+            /// a least-recently-used cache keyed by their SQL text.
+            [[nodiscard]] StatementCacheStats statementCacheStats() const noexcept;
+            void setStatementCacheCapacity(size_t capacity) noexcept;
+
         private:
+            struct CachedStatement {
+                string sql;
+                uint64 hash = 0;
+                uint64 lastUsed = 0;
+                rc<sqlutil::Stmt> stmt;
+            };
+
             template <typename... T>
-            sqlite3_stmt* compile(string_view sql, T const&... args) {
-                sqlite3_stmt* stmt = sqlutil::compile(_conn, sql);
-                if (stmt != nullptr) {
-                    sqlutil::bindParams(stmt, args...);
-                    sqlutil::nextRow(stmt);
+            sqlutil::StmtLease compile(string_view sql, T const&... args) {
+                sqlutil::StmtLease stmt = _acquire(sql);
+                if (stmt) {
+                    sqlutil::bindParams(stmt.get(), args...);
+                    sqlutil::nextRow(stmt.get());
                 }
                 return stmt;
             }
 
+            sqlutil::StmtLease _acquire(string_view sql);
+            void _clearStatementCache() noexcept;
+
             sqlite3* _conn = nullptr;
+            vector<CachedStatement> _statements;
+            hash_map<uint64, size_t, identity> _statementIndices;
+            size_t _statementCapacity = defaultStatementCacheCapacity;
+            uint64 _statementClock = 0;
+            uint64 _statementHits = 0;
+            uint64 _statementMisses = 0;
+            uint64 _statementEvictions = 0;
         };
 
         class Transaction {
@@ -206,31 +281,35 @@ namespace up {
 
             template <typename... T>
             [[nodiscard]] SqlResult execute(T const&... args) noexcept {
-                sqlutil::reset(_stmt->stmt);
-                sqlutil::bindParams(_stmt->stmt, args...);
-                sqlutil::nextRow(_stmt->stmt);
+                _run(args...);
                 return SqlResult::Ok;
             }
 
+            /// The statement has a single cursor, so the returned query must be released
+            /// before the statement is executed or queried again.
             template <typename... R, typename... T>
             [[nodiscard]] Query<R...> query(T const&... args) noexcept {
-                sqlutil::reset(_stmt->stmt);
-                sqlutil::bindParams(_stmt->stmt, args...);
-                sqlutil::nextRow(_stmt->stmt);
-                return Query<R...>{_stmt};
+                _run(args...);
+                return Query<R...>{sqlutil::StmtLease{_stmt}};
             }
 
             template <typename... R, typename... T>
             [[nodiscard]] auto queryOne(T const&... args) noexcept {
-                sqlutil::reset(_stmt->stmt);
-                sqlutil::bindParams(_stmt->stmt, args...);
-                sqlutil::nextRow(_stmt->stmt);
+                _run(args...);
                 auto result = sqlutil::fetchColumns<R...>(_stmt->stmt);
                 sqlutil::reset(_stmt->stmt);
                 return result;
             }
 
         private:
+            template <typename... T>
+            void _run(T const&... args) noexcept {
+                UP_ASSERT(!_stmt->leased, "statement rebound while a query over it is still live");
+                sqlutil::reset(_stmt->stmt);
+                sqlutil::bindParams(_stmt->stmt, args...);
+                sqlutil::nextRow(_stmt->stmt);
+            }
+
             template <typename...>
             friend class Query;
             template <typename...>
@@ -242,19 +321,20 @@ namespace up {
         template <typename... T>
         class Cursor {
         public:
-            [[nodiscard]] bool operator==(QuerySentinel) noexcept {
-                return _stmt == nullptr || sqlutil::isComplete(_stmt->stmt);
-            }
+            Cursor(Cursor&&) noexcept = default;
+            Cursor& operator=(Cursor&&) noexcept = default;
+
+            [[nodiscard]] bool operator==(QuerySentinel) noexcept { return sqlutil::isComplete(_stmt.get()); }
             Cursor& operator++() noexcept {
-                sqlutil::nextRow(_stmt->stmt);
+                sqlutil::nextRow(_stmt.get());
                 return *this;
             }
-            [[nodiscard]] inline std::tuple<T...> operator*() { return sqlutil::fetchColumns<T...>(_stmt->stmt); }
+            [[nodiscard]] inline std::tuple<T...> operator*() { return sqlutil::fetchColumns<T...>(_stmt.get()); }
 
         private:
-            explicit Cursor(rc<sqlutil::Stmt> stmt) : _stmt(std::move(stmt)) { }
+            explicit Cursor(sqlutil::StmtLease stmt) noexcept : _stmt(std::move(stmt)) { }
 
-            rc<sqlutil::Stmt> _stmt;
+            sqlutil::StmtLease _stmt;
 
             template <typename...>
             friend class Query;
@@ -10,13 +10,16 @@
 #include "potato/recon/recon_protocol.h"
 #include "potato/recon/recon_server.h"
 #include "potato/schema/recon_messages_schema.h"
+#include "potato/runtime/asset_archive.h"
 #include "potato/runtime/concurrent_queue.h"
 #include "potato/runtime/filesystem.h"
 #include "potato/runtime/io_loop.h"
 #include "potato/runtime/json.h"
 #include "potato/runtime/path.h"
+#include "potato/runtime/resource_manifest.h"
 #include "potato/runtime/stream.h"
 #include "potato/runtime/uuid.h"
+#include "potato/spud/arena.h"
 #include "potato/spud/overload.h"
 #include "potato/spud/string_view.h"
 #include "potato/spud/string_writer.h"
@@ -59,6 +62,11 @@ bool up::recon::ReconApp::run(span<char const*> args) {
         return false;
     }
 
+    if (_config.server && !_config.packPath.empty()) {
+        _logger.error("Packing is not supported in server mode");
+        return false;
+    }
+
     if (_config.server) {
         _server.start(_loop);
         Logger::root().attach(new_shared<ReconProtocolLogSink>(_server));
@@ -103,6 +111,13 @@ bool up::recon::ReconApp::run(span<char const*> args) {
         return false;
     }
 
+    auto const statementStats = _library.statementCacheStats();
+    _logger.info(
+        "Asset library statement cache: {} hits, {} misses, {} evictions",
+        statementStats.hits,
+        statementStats.misses,
+        statementStats.evictions);
+
     if (!_library.close()) {
         _logger.error("Failed to close library `{}'", libraryPath);
         return false;
@@ -121,6 +136,11 @@ bool up::recon::ReconApp::_runOnce() {
         return false;
     }
 
+    if (!_config.packPath.empty() && !_writeArchive()) {
+        _logger.error("Failed to write archive");
+        return false;
+    }
+
     return true;
 }
 
@@ -370,8 +390,10 @@ auto up::recon::ReconApp::_importFile(zstring_view file, bool force) -> ReconImp
 
     _manifestDirty = true;
 
-    vector<string> dependencies;
-    vector<ImporterContext::Output> outputs;
+    // the bookkeeping lists only live for the duration of this import
+    scratch_scope scratch;
+    vector<string> dependencies(scratch.resource());
+    vector<ImporterContext::Output> outputs(scratch.resource());
     ImporterContext context(
         metaFile.uuid,
         file,
@@ -547,13 +569,64 @@ void up::recon::ReconApp::_collectMissingFiles() {
 }
 
 bool up::recon::ReconApp::_writeManifest() {
-    string_writer manifest;
-    _library.generateManifest(manifest);
+    // write to a temporary file and swap it into place so that clients never
+    // observe a partially-written manifest
+    string_writer tempPath;
+    tempPath.format("{}.tmp", _manifestPath);
+    {
+        Stream stream = fs::openWrite(tempPath, fs::OpenMode::Text);
+        if (!stream) {
+            _logger.error("Failed to open manifest `{}'", tempPath);
+            return false;
+        }
+        if (_library.generateManifest(stream) != IOResult::Success || stream.flush() != IOResult::Success) {
+            _logger.error("Failed to write manifest `{}'", tempPath);
+            return false;
+        }
+    }
 
-    if (auto rs = fs::writeAllText(_manifestPath.c_str(), manifest); rs != IOResult::Success) {
+    if (auto rs = fs::moveFileTo(tempPath, _manifestPath); rs != IOResult::Success) {
         _logger.error("Failed to write manifest `{}'", _manifestPath);
         return false;
     }
 
     return true;
 }
+
+bool up::recon::ReconApp::_writeArchive() {
+    auto [readRs, manifestText] = fs::readText(_manifestPath);
+    ResourceManifest manifest;
+    if (readRs != IOResult::Success || !ResourceManifest::parseManifest(manifestText, manifest)) {
+        _logger.error("Failed to read manifest `{}'", _manifestPath);
+        return false;
+    }
+
+    // every record of the manifest is packed, so that the archive serves
+    // anything the manifest can resolve
+    AssetArchiveWriter writer;
+    for (ResourceManifest::Record const& record : manifest.records()) {
+        writer.addFile(record.hash, path::join(path::Separator::Native, _libraryPath, "cache", CasPath{record.hash}));
+    }
+
+    string_writer tempPath;
+    tempPath.format("{}.tmp", _config.packPath);
+    {
+        Stream stream = fs::openWrite(tempPath);
+        if (!stream) {
+            _logger.error("Failed to open archive `{}'", tempPath);
+            return false;
+        }
+        if (auto const rs = writer.write(stream); rs != IOResult::Success) {
+            _logger.error("Failed to write archive `{}': {}", tempPath, rs);
+            return false;
+        }
+    }
+
+    if (auto rs = fs::moveFileTo(tempPath, _config.packPath); rs != IOResult::Success) {
+        _logger.error("Failed to write archive `{}'", _config.packPath);
+        return false;
+    }
+
+    _logger.info("Packed {} blobs into `{}'", writer.size(), _config.packPath);
+    return true;
+}
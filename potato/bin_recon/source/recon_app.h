@@ -54,6 +54,7 @@ namespace up::recon {
         bool _processQueue();
 
         bool _writeManifest();
+        bool _writeArchive();
 
         bool _isUpToDate(zstring_view assetPath, uint64 contentHash);
         bool _isCasUpToDate(uint64 contentHash);
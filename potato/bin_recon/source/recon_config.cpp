@@ -24,6 +24,7 @@ bool up::recon::parseArguments(ReconConfig& config, span<char const*> args, Logg
         ArgNone,
         ArgPath,
         ArgConfig,
+        ArgPack,
     } argMode = ArgNone;
 
     for (zstring_view arg : args) {
@@ -40,6 +41,9 @@ bool up::recon::parseArguments(ReconConfig& config, span<char const*> args, Logg
             else if (name == "config") {
                 argMode = ArgConfig;
             }
+            else if (name == "pack") {
+                argMode = ArgPack;
+            }
             else if (name == "server") {
                 config.server = true;
             }
@@ -64,6 +68,10 @@ bool up::recon::parseArguments(ReconConfig& config, span<char const*> args, Logg
                 }
                 argMode = ArgNone;
                 break;
+            case ArgPack:
+                config.packPath = string(arg);
+                argMode = ArgNone;
+                break;
         }
     }
 
@@ -76,6 +84,9 @@ bool up::recon::parseArguments(ReconConfig& config, span<char const*> args, Logg
         case ArgConfig:
             logger.error("No value provided after `-config' argument");
             return false;
+        case ArgPack:
+            logger.error("No value provided after `-pack' argument");
+            return false;
         default:
             logger.error("No value provided");
             return false;
@@ -21,6 +21,8 @@ namespace up::recon {
     struct ReconConfig {
         string path;
         vector<ReconConfigImportMapping> mapping;
+        /// When set, the manifest's content is also packed into an AssetArchive at this path.
+        string packPath;
         bool server = false;
     };
 
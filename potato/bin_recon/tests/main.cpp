@@ -0,0 +1,4 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
@@ -0,0 +1,87 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "posql.h"
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("potato.recon.posql", "[potato][recon]") {
+    using namespace up;
+
+    Database db;
+    REQUIRE(db.open(":memory:") == SqlResult::Ok);
+    REQUIRE(db.execute("CREATE TABLE numbers (value INTEGER)") == SqlResult::Ok);
+    for (int64 value = 1; value <= 3; ++value) {
+        REQUIRE(db.execute("INSERT INTO numbers (value) VALUES(?)", value) == SqlResult::Ok);
+    }
+
+    auto const sum = [&db](string_view sql) {
+        int64 total = 0;
+        for (auto const& [value] : db.query<int64>(sql)) {
+            total += value;
+        }
+        return total;
+    };
+
+    SECTION("repeated statements hit the cache") {
+        StatementCacheStats const before = db.statementCacheStats();
+        CHECK(before.hits == 2);
+        CHECK(before.misses == 2);
+
+        CHECK(sum("SELECT value FROM numbers") == 6);
+        CHECK(sum("SELECT value FROM numbers") == 6);
+
+        StatementCacheStats const after = db.statementCacheStats();
+        CHECK(after.hits == before.hits + 1);
+        CHECK(after.misses == before.misses + 1);
+        CHECK(after.size == 3);
+    }
+
+    SECTION("least-recently used statements are evicted at capacity") {
+        db.setStatementCacheCapacity(3);
+
+        CHECK(sum("SELECT value FROM numbers") == 6);
+        CHECK(sum("SELECT value FROM numbers WHERE value > 1") == 5);
+        CHECK(db.statementCacheStats().evictions == 1);
+
+        // the INSERT was used after the CREATE, so it survived the eviction
+        REQUIRE(db.execute("INSERT INTO numbers (value) VALUES(?)", 4) == SqlResult::Ok);
+        StatementCacheStats const stats = db.statementCacheStats();
+        CHECK(stats.hits == 3);
+        CHECK(stats.misses == 4);
+        CHECK(stats.evictions == 1);
+        CHECK(stats.size == 3);
+    }
+
+    SECTION("shrinking the capacity keeps the most-recently used statements") {
+        CHECK(sum("SELECT value FROM numbers") == 6);
+        db.setStatementCacheCapacity(1);
+
+        StatementCacheStats const before = db.statementCacheStats();
+        CHECK(before.evictions == 2);
+        CHECK(before.size == 1);
+
+        CHECK(sum("SELECT value FROM numbers") == 6);
+        CHECK(db.statementCacheStats().hits == before.hits + 1);
+    }
+
+    SECTION("a cursor abandoned by an exception is reset before its next lease") {
+        auto const throwOnFirstRow = [&db] {
+            for (auto const& [value] : db.query<int64>("SELECT value FROM numbers ORDER BY value")) {
+                throw value;
+            }
+        };
+        CHECK_THROWS_AS(throwOnFirstRow(), int64);
+
+        StatementCacheStats const before = db.statementCacheStats();
+        CHECK(sum("SELECT value FROM numbers ORDER BY value") == 6);
+        CHECK(db.statementCacheStats().hits == before.hits + 1);
+    }
+
+    SECTION("nested queries over the same sql use separate statements") {
+        int64 pairs = 0;
+        for (auto const& [outer] : db.query<int64>("SELECT value FROM numbers")) {
+            pairs += outer * sum("SELECT value FROM numbers");
+        }
+        CHECK(pairs == 36);
+    }
+}
@@ -4,15 +4,56 @@
 
 #include "common.h"
 
+#include "potato/reflex/schema.h"
+#include "potato/reflex/serialize.h"
 #include "potato/reflex/typeid.h"
 #include "potato/spud/delegate_ref.h"
 #include "potato/spud/find.h"
-#include "potato/spud/hash_map.h"
+#include "potato/spud/span.h"
 #include "potato/spud/vector.h"
 #include "potato/spud/zstring_view.h"
 
+#include <type_traits>
+
 namespace up {
     class ComponentStorage;
+    class EntityManager;
+
+    /// How a ComponentStorage fills the slots vacated by removed components.
+    enum class ComponentLayout : uint8 {
+        /// The last component is moved into the vacated slot, keeping storage
+        /// dense so that iteration never visits holes. Component addresses are
+        /// only stable until the next removal.
+        Packed,
+        /// Vacated slots are left empty and reused by later additions. Component
+        /// addresses are stable for the lifetime of the component.
+        Sparse
+    };
+
+    /// How the components of a ComponentStorage are written to world snapshots.
+    enum class ComponentEncoding : uint8 {
+        /// Trivially copyable components are copied as raw memory.
+        Raw,
+        /// Components with a reflex schema are encoded one at a time.
+        Schema,
+        /// Components that are neither, or that are registered as transient, are
+        /// left out of snapshots and deltas.
+        None
+    };
+
+    /// Whether the components of a ComponentStorage are written to snapshots and deltas.
+    enum class ComponentPersistence : uint8 {
+        /// Components are written with the encoding their type supports.
+        Persistent,
+        /// Components hold runtime-only state, such as handles into another system,
+        /// that is derived from other components; they are never written.
+        Transient
+    };
+
+    /// Checks whether a change tick is more recent than since, allowing for wrap-around.
+    constexpr bool isChangedSince(uint32 tick, uint32 since) noexcept {
+        return static_cast<int32>(tick - since) > 0;
+    }
 
     template <typename ComponentT>
     consteval ComponentId makeComponentId() noexcept {
@@ -28,12 +69,18 @@ namespace up {
         [[nodiscard]] inline bool next() noexcept;
 
     private:
-        explicit ComponentCursor(ComponentStorage& storage) : _storage(&storage) { }
+        explicit ComponentCursor(ComponentStorage& storage, uint32 first = 0, uint32 last = ~uint32{0})
+            : _storage(&storage)
+            , _index(first)
+            , _end(last) { }
 
         ComponentStorage* _storage = nullptr;
         EntityId _entityId = EntityId::None;
         void* _componentData = nullptr;
         uint32 _index = 0;
+        uint32 _end = ~uint32{0};
+        uint32 _since = 0;
+        bool _changedOnly = false;
 
         friend ComponentStorage;
     };
@@ -43,6 +90,8 @@ namespace up {
         virtual ComponentId componentId() const = 0;
         virtual void onAdd(EntityId entityId, void* data) = 0;
         virtual void onRemove(EntityId entityId, void* data) = 0;
+        /// Called when a packed storage relocates a component to fill a vacated slot.
+        virtual void onMove(EntityId entityId, void* data) { }
 
     protected:
         ~RawComponentObserver() = default;
@@ -55,6 +104,7 @@ namespace up {
 
         virtual void onAdd(EntityId entityId, ComponentT& component) = 0;
         virtual void onRemove(EntityId entityId, ComponentT& component) = 0;
+        virtual void onMove(EntityId entityId, ComponentT& component) { }
 
     protected:
         ~ComponentObserver() = default;
@@ -62,6 +112,7 @@ namespace up {
     private:
         void onAdd(EntityId entityId, void* data) final { onAdd(entityId, *static_cast<ComponentT*>(data)); }
         void onRemove(EntityId entityId, void* data) final { onRemove(entityId, *static_cast<ComponentT*>(data)); }
+        void onMove(EntityId entityId, void* data) final { onMove(entityId, *static_cast<ComponentT*>(data)); }
     };
 
     class ComponentStorage {
@@ -69,82 +120,150 @@ namespace up {
         virtual ~ComponentStorage() = default;
 
         [[nodiscard]] constexpr ComponentId componentId() const noexcept { return _id; }
+        [[nodiscard]] constexpr ComponentLayout layout() const noexcept { return _layout; }
         [[nodiscard]] virtual zstring_view debugName() const noexcept = 0;
 
+        [[nodiscard]] virtual ComponentEncoding encoding() const noexcept = 0;
+        [[nodiscard]] virtual uint32 componentSize() const noexcept = 0;
+
         [[nodiscard]] size_t size() const noexcept { return _size; }
 
-        inline void* add(EntityId entityId, void const* source);
-        inline bool remove(EntityId entityId);
-        [[nodiscard]] inline bool contains(EntityId entityId) const noexcept;
+        /// Number of storage slots, including vacated ones; the upper bound for enumerated ranges.
+        [[nodiscard]] uint32 slotCount() const noexcept { return static_cast<uint32>(_entities.size()); }
 
-        [[nodiscard]] inline void* getUnsafe(EntityId entityId) noexcept;
+        /// Constructs a component for the entity, copying from source if it is non-null,
+        /// and marks it changed at tick. The slot holding the component is stored to
+        /// location before observers run.
+        inline void* add(EntityId entityId, void const* source, uint32 tick, uint32& location);
+        /// Destroys the component in the given slot. If another Entity's component is
+        /// moved into the vacated slot, relocated is invoked before observers are notified.
+        inline void remove(uint32 index, delegate_ref<void(EntityId entityId, uint32 index)> relocated);
+
+        [[nodiscard]] void* getUnsafe(uint32 index) noexcept { return getByIndexUnsafe(index); }
+
+        /// Tick at which the component in the given slot was last added or marked changed.
+        [[nodiscard]] uint32 changeTick(uint32 index) const noexcept { return _changeTicks[index]; }
+        void markChanged(uint32 index, uint32 tick) noexcept { _changeTicks[index] = tick; }
 
         [[nodiscard]] inline ComponentCursor enumerateUnsafe() noexcept;
 
+        /// Enumerates the components stored in slots [first, last).
+        [[nodiscard]] inline ComponentCursor enumerateUnsafe(uint32 first, uint32 last) noexcept;
+
+        /// Enumerates the components marked changed after the since tick.
+        [[nodiscard]] inline ComponentCursor enumerateChangedUnsafe(uint32 since) noexcept;
+
         inline void observe(RawComponentObserver* observer);
         inline void unobserve(RawComponentObserver* observer);
 
-    protected:
         static constexpr uint32 InvalidIndex = uint32(-1);
 
-        explicit ComponentStorage(ComponentId id) noexcept : _id(id) { }
+    protected:
+        explicit ComponentStorage(ComponentId id, ComponentLayout layout) noexcept : _id(id), _layout(layout) { }
 
         virtual void* allocateComponentAt(uint32 index, void const* source) = 0;
         virtual void* getByIndexUnsafe(uint32 index) noexcept = 0;
+        /// Moves the component at from into the slot at to, then destroys the last component.
+        virtual void moveComponentAndPop(uint32 from, uint32 to) noexcept = 0;
+
+        /// Resizes the component array to slotCount default-constructed components.
+        virtual void resetComponents(uint32 slotCount) = 0;
+        /// Memory of the components in every slot; only valid for the Raw encoding.
+        virtual span<byte> rawComponents() noexcept = 0;
+        /// Appends the encoding of the component in the given slot; only valid for the Schema encoding.
+        virtual bool encodeComponent(uint32 index, vector<char>& out) const = 0;
+        virtual bool decodeComponent(uint32 index, view<char> data) = 0;
 
     private:
         [[nodiscard]] inline uint32 allocateIndex(EntityId entityId);
-        [[nodiscard]] inline uint32 indexOf(EntityId entityId) const noexcept;
 
         vector<EntityId> _entities;
+        vector<uint32> _changeTicks;
         vector<uint32> _free;
         vector<RawComponentObserver*> _observers;
-        hash_map<EntityId, uint32> _map;
         size_t _size = 0;
         ComponentId _id;
+        ComponentLayout _layout = ComponentLayout::Packed;
+        /// Position of this storage in its EntityManager's per-entity location records.
+        uint32 _column = InvalidIndex;
 
         friend ComponentCursor;
+        friend EntityManager;
     };
 
     template <typename ComponentT, bool IsEmptyComponent = false>
     class TypedComponentStorage final : public ComponentStorage {
     public:
-        TypedComponentStorage() noexcept
-            : ComponentStorage(makeComponentId<ComponentT>())
-            , _name(nameof<ComponentT>()) { }
+        explicit TypedComponentStorage(ComponentLayout layout, ComponentPersistence persistence) noexcept
+            : ComponentStorage(makeComponentId<ComponentT>(), layout)
+            , _name(nameof<ComponentT>())
+            , _persistence(persistence) { }
 
     private:
+        static constexpr ComponentEncoding _encoding = std::is_trivially_copyable_v<ComponentT>
+            ? ComponentEncoding::Raw
+            : reflex::has_schema<ComponentT> ? ComponentEncoding::Schema
+                                             : ComponentEncoding::None;
+
         zstring_view debugName() const noexcept override { return _name.c_str(); }
+        ComponentEncoding encoding() const noexcept override {
+            return _persistence == ComponentPersistence::Transient ? ComponentEncoding::None : _encoding;
+        }
+        uint32 componentSize() const noexcept override { return sizeof(ComponentT); }
 
         void* allocateComponentAt(uint32 index, void const* source) override;
         void* getByIndexUnsafe(uint32 index) noexcept override;
+        void moveComponentAndPop(uint32 from, uint32 to) noexcept override;
+
+        void resetComponents(uint32 slotCount) override;
+        span<byte> rawComponents() noexcept override;
+        bool encodeComponent(uint32 index, vector<char>& out) const override;
+        bool decodeComponent(uint32 index, view<char> data) override;
 
         vector<ComponentT> _components;
         decltype(nameof<ComponentT>()) _name;
+        ComponentPersistence _persistence = ComponentPersistence::Persistent;
     };
 
     template <typename ComponentT>
     class TypedComponentStorage<ComponentT, true> final : public ComponentStorage {
     public:
-        TypedComponentStorage() noexcept
-            : ComponentStorage(makeComponentId<ComponentT>())
-            , _name(nameof<ComponentT>()) { }
+        explicit TypedComponentStorage(ComponentLayout layout, ComponentPersistence persistence) noexcept
+            : ComponentStorage(makeComponentId<ComponentT>(), layout)
+            , _name(nameof<ComponentT>())
+            , _persistence(persistence) { }
 
     private:
         zstring_view debugName() const noexcept override { return _name.c_str(); }
 
+        ComponentEncoding encoding() const noexcept override {
+            return _persistence == ComponentPersistence::Transient ? ComponentEncoding::None : ComponentEncoding::Raw;
+        }
+        uint32 componentSize() const noexcept override { return 0; }
+
         void* allocateComponentAt(uint32 index, void const*) override { return &_empty; }
         void* getByIndexUnsafe(uint32 index) noexcept override { return &_empty; }
+        void moveComponentAndPop(uint32, uint32) noexcept override { }
+
+        void resetComponents(uint32) override { }
+        span<byte> rawComponents() noexcept override { return {}; }
+        bool encodeComponent(uint32, vector<char>&) const override { return false; }
+        bool decodeComponent(uint32, view<char>) override { return false; }
 
         decltype(nameof<ComponentT>()) _name;
         ComponentT _empty;
+        ComponentPersistence _persistence = ComponentPersistence::Persistent;
     };
 
     bool ComponentCursor::next() noexcept {
-        while (_index < _storage->_entities.size()) {
+        while (_index < _end && _index < _storage->_entities.size()) {
             uint32 const index = _index++;
             EntityId const entityId = _storage->_entities[index];
-            if (entityId != EntityId::None) {
+            // packed storages have no holes to skip
+            if (_storage->_layout == ComponentLayout::Packed || entityId != EntityId::None) {
+                if (_changedOnly && !isChangedSince(_storage->_changeTicks[index], _since)) {
+                    continue;
+                }
                 _entityId = entityId;
                 _componentData = _storage->getByIndexUnsafe(index);
                 return true;
@@ -153,18 +272,12 @@ namespace up {
         return false;
     }
 
-    void* ComponentStorage::add(EntityId entityId, void const* source) {
-        {
-            uint32 const index = indexOf(entityId);
-            if (index != InvalidIndex) {
-                return getByIndexUnsafe(index);
-            }
-        }
-
+    void* ComponentStorage::add(EntityId entityId, void const* source, uint32 tick, uint32& location) {
         uint32 const index = allocateIndex(entityId);
-        _map.insert(entityId, index);
+        _changeTicks[index] = tick;
         ++_size;
         void* component = allocateComponentAt(index, source);
+        location = index;
 
         for (RawComponentObserver* observer : _observers) {
             observer->onAdd(entityId, component);
@@ -173,38 +286,54 @@ namespace up {
         return component;
     }
 
-    bool ComponentStorage::remove(EntityId entityId) {
-        if (_size == 0) {
-            return false;
-        }
-
-        uint32 const index = indexOf(entityId);
-        if (index == InvalidIndex) {
-            return false;
-        }
+    void ComponentStorage::remove(uint32 index, delegate_ref<void(EntityId entityId, uint32 index)> relocated) {
+        UP_ASSERT(index < _entities.size());
+        UP_ASSERT(_entities[index] != EntityId::None);
 
         for (RawComponentObserver* observer : _observers) {
-            observer->onRemove(entityId, getByIndexUnsafe(index));
+            observer->onRemove(_entities[index], getByIndexUnsafe(index));
         }
 
-        _entities[index] = {};
-        _map.erase(entityId);
-        _free.push_back(index);
         --_size;
-        return true;
-    }
 
-    bool ComponentStorage::contains(EntityId entityId) const noexcept {
-        return _size != 0 ? indexOf(entityId) != InvalidIndex : false;
-    }
+        if (_layout == ComponentLayout::Sparse) {
+            _entities[index] = {};
+            _free.push_back(index);
+            return;
+        }
+
+        auto const last = static_cast<uint32>(_entities.size() - 1);
+        EntityId const moved = index != last ? _entities[last] : EntityId::None;
+        moveComponentAndPop(last, index);
+        _entities[index] = _entities[last];
+        _entities.pop_back();
+        _changeTicks[index] = _changeTicks[last];
+        _changeTicks.pop_back();
+
+        if (moved != EntityId::None) {
+            relocated(moved, index);
 
-    void* ComponentStorage::getUnsafe(EntityId entityId) noexcept {
-        uint32 const index = indexOf(entityId);
-        return index != InvalidIndex ? getByIndexUnsafe(index) : nullptr;
+            void* const component = getByIndexUnsafe(index);
+            for (RawComponentObserver* observer : _observers) {
+                observer->onMove(moved, component);
+            }
+        }
     }
 
     ComponentCursor ComponentStorage::enumerateUnsafe() noexcept { return ComponentCursor{*this}; }
 
+    ComponentCursor ComponentStorage::enumerateUnsafe(uint32 first, uint32 last) noexcept {
+        UP_ASSERT(first <= last);
+        return ComponentCursor{*this, first, last};
+    }
+
+    ComponentCursor ComponentStorage::enumerateChangedUnsafe(uint32 since) noexcept {
+        ComponentCursor cursor{*this};
+        cursor._since = since;
+        cursor._changedOnly = true;
+        return cursor;
+    }
+
     void ComponentStorage::observe(RawComponentObserver* observer) {
         UP_GUARD_VOID(observer != nullptr);
         UP_GUARD_VOID(observer->componentId() == _id);
@@ -230,14 +359,10 @@ namespace up {
 
         auto const index = static_cast<uint32>(_entities.size());
         _entities.push_back(entityId);
+        _changeTicks.push_back(0);
         return index;
     }
 
-    uint32 ComponentStorage::indexOf(EntityId entityId) const noexcept {
-        auto const& item = _map.find(entityId);
-        return item ? item->value : InvalidIndex;
-    }
-
     template <typename ComponentT, bool IsEmptyComponent>
     void* TypedComponentStorage<ComponentT, IsEmptyComponent>::allocateComponentAt(uint32 index, void const* source) {
         UP_ASSERT(index <= _components.size());
@@ -265,4 +390,51 @@ namespace up {
         UP_ASSERT(index < _components.size());
         return &_components[index];
     }
+
+    template <typename ComponentT, bool IsEmptyComponent>
+    void TypedComponentStorage<ComponentT, IsEmptyComponent>::moveComponentAndPop(uint32 from, uint32 to) noexcept {
+        UP_ASSERT(from < _components.size() && to < _components.size());
+        if (from != to) {
+            _components[to] = std::move(_components[from]);
+        }
+        _components.pop_back();
+    }
+
+    template <typename ComponentT, bool IsEmptyComponent>
+    void TypedComponentStorage<ComponentT, IsEmptyComponent>::resetComponents(uint32 slotCount) {
+        _components.clear();
+        _components.resize(slotCount);
+    }
+
+    template <typename ComponentT, bool IsEmptyComponent>
+    span<byte> TypedComponentStorage<ComponentT, IsEmptyComponent>::rawComponents() noexcept {
+        if constexpr (_encoding == ComponentEncoding::Raw) {
+            return {reinterpret_cast<byte*>(_components.data()), _components.size() * sizeof(ComponentT)};
+        }
+        else {
+            return {};
+        }
+    }
+
+    template <typename ComponentT, bool IsEmptyComponent>
+    bool TypedComponentStorage<ComponentT, IsEmptyComponent>::encodeComponent(uint32 index, vector<char>& out) const {
+        if constexpr (_encoding == ComponentEncoding::Schema) {
+            UP_ASSERT(index < _components.size());
+            return reflex::encodeToBinary(out, _components[index]);
+        }
+        else {
+            return false;
+        }
+    }
+
+    template <typename ComponentT, bool IsEmptyComponent>
+    bool TypedComponentStorage<ComponentT, IsEmptyComponent>::decodeComponent(uint32 index, view<char> data) {
+        if constexpr (_encoding == ComponentEncoding::Schema) {
+            UP_ASSERT(index < _components.size());
+            return reflex::decodeFromBinary(data, _components[index]);
+        }
+        else {
+            return false;
+        }
+    }
 } // namespace up
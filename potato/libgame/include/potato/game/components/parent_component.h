@@ -0,0 +1,13 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "potato/game/common.h"
+
+namespace up {
+    /// Attaches an Entity to a parent Entity; the child's TransformComponent
+    /// is then relative to the parent's.
+    struct ParentComponent {
+        EntityId parent = EntityId::None;
+    };
+} // namespace up
@@ -10,6 +10,18 @@
 
 namespace up {
     struct TransformComponent : Transform {
+        /// Local-to-world matrix, including the transforms of any parents.
+        /// Maintained by the transform system.
         glm::mat4x4 matrix = {};
+        /// Value of matrix at the previous tick, for interpolated rendering.
+        /// Maintained by the transform system.
+        glm::mat4x4 previousMatrix = {};
+
+        /// Blends previousMatrix towards matrix by alpha. Consecutive ticks are
+        /// close enough that a linear blend stands in for interpolating position,
+        /// rotation and scale separately.
+        glm::mat4x4 UP_VECTORCALL interpolatedMatrix(float alpha) const noexcept {
+            return previousMatrix + (matrix - previousMatrix) * alpha;
+        }
     };
 } // namespace up
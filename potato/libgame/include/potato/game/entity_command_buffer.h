@@ -0,0 +1,130 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "_export.h"
+#include "common.h"
+#include "component.h"
+
+#include "potato/spud/arena.h"
+#include "potato/spud/traits.h"
+#include "potato/spud/utility.h"
+#include "potato/spud/vector.h"
+
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace up {
+    /// Records structural changes to be applied to an EntityManager later.
+    ///
+    /// Entities and Components can't be created or destroyed while a select is
+    /// iterating over them or from worker threads, so such changes are recorded
+    /// here and applied by EntityManager::playback at a sync point. Recording is
+    /// safe from any thread.
+    ///
+    /// createEntity returns a placeholder EntityId that is only meaningful to the
+    /// buffer that issued it; it may be passed to the other commands of the same
+    /// buffer, and is replaced by the real EntityId on playback.
+    ///
+    class EntityCommandBuffer {
+    public:
+        EntityCommandBuffer() = default;
+        UP_GAME_API ~EntityCommandBuffer();
+
+        EntityCommandBuffer(EntityCommandBuffer const&) = delete;
+        EntityCommandBuffer& operator=(EntityCommandBuffer const&) = delete;
+
+        /// Records the creation of an Entity, returning a placeholder for it.
+        ///
+        UP_GAME_API EntityId createEntity();
+
+        /// Records the creation of an Entity with the given components.
+        ///
+        template <typename... Components>
+        EntityId createEntity(identity_t<Components>&&... components);
+
+        /// Records the destruction of an Entity.
+        ///
+        UP_GAME_API void destroyEntity(EntityId entityId);
+
+        /// Records the addition of a Component to an Entity.
+        ///
+        template <typename Component>
+        void addComponent(EntityId entityId, identity_t<Component>&& component);
+
+        /// Records the addition of a default-constructed Component to an Entity.
+        ///
+        template <typename Component>
+        void addComponent(EntityId entityId) {
+            addComponent<Component>(entityId, Component{});
+        }
+
+        /// Records the removal of a Component from an Entity.
+        ///
+        UP_GAME_API void removeComponent(EntityId entityId, ComponentId componentId);
+
+        template <typename Component>
+        void removeComponent(EntityId entityId) {
+            removeComponent(entityId, makeComponentId<Component>());
+        }
+
+        /// Checks whether an EntityId is a placeholder issued by createEntity.
+        ///
+        [[nodiscard]] static constexpr bool isPlaceholder(EntityId entityId) noexcept {
+            // real EntityIds never have a generation of 0
+            return entityId != EntityId::None && (to_underlying(entityId) >> 32) == 0;
+        }
+
+        [[nodiscard]] UP_GAME_API bool empty() const noexcept;
+
+        /// Discards every recorded command.
+        ///
+        UP_GAME_API void clear() noexcept;
+
+    private:
+        enum class CommandType : uint8 { Destroy, Add, Remove };
+
+        struct Command {
+            EntityId entityId = EntityId::None;
+            ComponentId componentId = ComponentId::Unknown;
+            /// Component to copy from for Add commands, allocated from _payloads.
+            void* component = nullptr;
+            void (*destroy)(void* component) = nullptr;
+            /// Position in recording order, so that sorting keeps each Entity's commands in order.
+            uint32 sequence = 0;
+            CommandType type = CommandType::Destroy;
+        };
+
+        void _record(Command command);
+        void _clearUnlocked() noexcept;
+
+        mutable std::mutex _lock;
+        vector<Command> _commands;
+        arena_resource _payloads;
+        uint32 _placeholderCount = 0;
+
+        friend EntityManager;
+    };
+
+    template <typename... Components>
+    EntityId EntityCommandBuffer::createEntity(identity_t<Components>&&... components) {
+        auto const entityId = createEntity();
+        (addComponent<Components>(entityId, std::move(components)), ...);
+        return entityId;
+    }
+
+    template <typename Component>
+    void EntityCommandBuffer::addComponent(EntityId entityId, identity_t<Component>&& component) {
+        Command command{.entityId = entityId, .componentId = makeComponentId<Component>(), .type = CommandType::Add};
+        if constexpr (!std::is_trivially_destructible_v<Component>) {
+            command.destroy = [](void* data) { static_cast<Component*>(data)->~Component(); };
+        }
+
+        std::lock_guard lock(_lock);
+        command.component = new (_payloads.allocate(sizeof(Component), alignof(Component)))
+            Component(std::move(component));
+        command.sequence = static_cast<uint32>(_commands.size());
+        _commands.push_back(command);
+    }
+} // namespace up
@@ -6,21 +6,31 @@
 #include "common.h"
 #include "component.h"
 
+#include "potato/runtime/io_result.h"
+#include "potato/runtime/task_worker.h"
 #include "potato/spud/bit_set.h"
 #include "potato/spud/box.h"
 #include "potato/spud/concepts.h"
 #include "potato/spud/delegate_ref.h"
 #include "potato/spud/hash_map.h"
-#include "potato/spud/hash_set.h"
 #include "potato/spud/rc.h"
 #include "potato/spud/traits.h"
 #include "potato/spud/vector.h"
 
+#include <atomic>
+
 namespace up {
-    class Query;
+    class EntityCommandBuffer;
+    class RawQuery;
+    class Stream;
 
     /// Contains a collection of Entities and their associated Components.
     ///
+    /// Entities live in a dense array of slots. An EntityId encodes a slot and
+    /// the generation of that slot; destroying an entity bumps the generation,
+    /// so stale ids are detected and slots can be recycled. Each slot records
+    /// where every one of its components is stored.
+    ///
     class EntityManager {
     public:
         UP_GAME_API EntityManager();
@@ -42,6 +52,29 @@ namespace up {
         ///
         UP_GAME_API bool destroyEntity(EntityId entity) noexcept;
 
+        /// Applies and clears the commands recorded in a buffer.
+        ///
+        /// Commands are grouped by Entity, keeping each Entity's commands in the
+        /// order they were recorded in, and the components of destroyed Entities
+        /// are then removed one storage at a time. Observers must not record into
+        /// the buffer that is being played back.
+        ///
+        UP_GAME_API void playback(EntityCommandBuffer& commands);
+
+        /// Checks whether an EntityId refers to a live Entity
+        ///
+        [[nodiscard]] bool isAlive(EntityId entityId) const noexcept {
+            uint32 const slot = _slotOf(entityId);
+            return slot < _records.size() && _records[slot].alive &&
+                _records[slot].generation == _generationOf(entityId);
+        }
+
+        /// Number of live Entities
+        ///
+        [[nodiscard]] uint32 entityCount() const noexcept {
+            return static_cast<uint32>(_records.size() - _freeSlots.size());
+        }
+
         /// Adds a new Component to an existing Entity.
         ///
         template <typename Component>
@@ -75,6 +108,25 @@ namespace up {
             requires is_invocable_v<Callback, EntityId, Components&...>
         void select(Callback&& callback);
 
+        /// Invokes callback for every Entity matching the signature whose first
+        /// Component was added or marked changed after the since tick.
+        ///
+        /// Systems typically pass the tick of their own previous update.
+        template <typename... Components, typename Callback>
+            requires is_invocable_v<Callback, EntityId, Components&...>
+        void selectChanged(uint32 since, Callback&& callback);
+
+        /// Invokes callback for every Entity matching the signature, splitting the
+        /// work into batches of at least minBatch slots that run on the workers
+        /// servicing queue. The calling thread participates and returns once every
+        /// batch is complete. With a null queue, the work runs on the calling thread.
+        ///
+        /// The callback must be safe to invoke concurrently, and must not create or
+        /// destroy entities or add or remove components while the select is running.
+        template <typename... Components, typename Callback>
+            requires is_invocable_v<Callback, EntityId, Components&...>
+        void parallelSelect(TaskQueue* queue, Callback&& callback, uint32 minBatch = 1024);
+
         /// Retrieves a pointer to a Component on the specified Entity.
         ///
         /// This is typically a slow operation. It will incur several table lookups
@@ -90,9 +142,38 @@ namespace up {
         ///
         UP_GAME_API [[nodiscard]] void* getComponentUnsafe(EntityId entityId, ComponentId componentId) noexcept;
 
+        /// Retrieves a pointer to a Component that the caller intends to modify,
+        /// and marks the Component changed at the current tick.
+        ///
+        template <typename Component>
+        [[nodiscard]] Component* getMut(EntityId entityId) noexcept;
+
+        /// Marks a Component changed at the current tick, so that it is visited by
+        /// selectChanged. Safe to call for distinct Entities from a parallelSelect.
+        ///
+        bool markChanged(EntityId entityId, ComponentId componentId) noexcept {
+            return _getMutUnsafe(entityId, componentId) != nullptr;
+        }
+
+        template <typename Component>
+        bool markChanged(EntityId entityId) noexcept {
+            return markChanged(entityId, makeComponentId<Component>());
+        }
+
+        /// Tick stamped on Components as they are added or marked changed.
+        [[nodiscard]] uint32 changeTick() const noexcept { return _changeTick; }
+
+        /// Starts a new tick; changes made from now on are newer than any made before.
+        void advanceChangeTick() noexcept { ++_changeTick; }
+
         /// Registers a new component type
         template <typename Component>
-        ComponentStorage& registerComponent();
+        ComponentStorage& registerComponent(
+            ComponentLayout layout = ComponentLayout::Packed,
+            ComponentPersistence persistence = ComponentPersistence::Persistent);
+
+        /// Storages of every registered component type, in registration order
+        [[nodiscard]] view<box<ComponentStorage>> storages() const noexcept { return _components; }
 
         /// Adds an observer for a specific component type
         UP_GAME_API void observe(RawComponentObserver& observer);
@@ -100,18 +181,135 @@ namespace up {
         /// Releases an observer
         UP_GAME_API void unobserve(RawComponentObserver& observer);
 
+        /// Starts maintaining a query's matches; the query is filled with the
+        /// Entities that already match it.
+        UP_GAME_API void registerQuery(RawQuery& query);
+
+        /// Stops maintaining a query's matches and clears them.
+        UP_GAME_API void unregisterQuery(RawQuery& query) noexcept;
+
+        /// Writes every Entity to a stream, along with the components of every
+        /// storage whose encoding is not ComponentEncoding::None. Transient
+        /// components are left to observers to recreate when the snapshot is read.
+        ///
+        /// Each storage is written as a contiguous block, preceded by a table of
+        /// component types that readSnapshot validates before loading anything.
+        ///
+        UP_GAME_API IOResult writeSnapshot(Stream& stream);
+
+        /// Replaces every Entity with those of a snapshot written by writeSnapshot.
+        ///
+        /// The snapshot's component types must be registered with the same layout
+        /// and size as when it was written. Loaded components are marked changed at
+        /// the current tick and reported to observers. If the snapshot turns out to
+        /// be malformed after loading has begun, the EntityManager is left empty.
+        ///
+        UP_GAME_API IOResult readSnapshot(Stream& stream);
+
+        /// Writes the changes that turn baseline into this EntityManager.
+        ///
+        /// Changed entity records are written as runs of slots, and components as
+        /// additions, removals and changes keyed by Entity. Changed components of
+        /// the Raw encoding are written as the run-length encoded XOR of their old
+        /// and new bytes; those of the Schema encoding are re-encoded whole.
+        ///
+        /// baseline must have the same component types registered, with the same
+        /// sizes, as this EntityManager.
+        ///
+        UP_GAME_API IOResult writeDelta(EntityManager& baseline, Stream& stream);
+
+        /// Applies a delta written by writeDelta, turning an EntityManager equal to
+        /// its baseline into a bit-exact copy of the EntityManager that wrote it.
+        ///
+        /// Components are compared by Entity, so the order of components within
+        /// storages may differ between the copies. A malformed delta may be
+        /// partially applied before it is rejected; the EntityManager stays valid,
+        /// but should be resynchronized with readSnapshot.
+        ///
+        UP_GAME_API IOResult applyDelta(Stream& stream);
+
     private:
+        struct EntityRecord {
+            uint32 generation = 1;
+            /// Number of storages holding a component of the Entity.
+            uint32 componentCount = 0;
+            bool alive = false;
+        };
+
+        static constexpr EntityId _makeEntityId(uint32 slot, uint32 generation) noexcept {
+            return EntityId{(uint64{generation} << 32) | slot};
+        }
+        static constexpr uint32 _slotOf(EntityId entityId) noexcept {
+            return static_cast<uint32>(to_underlying(entityId));
+        }
+        static constexpr uint32 _generationOf(EntityId entityId) noexcept {
+            return static_cast<uint32>(to_underlying(entityId) >> 32);
+        }
+
+        /// Location of an Entity's component in storage; the Entity must be alive.
+        uint32& _locationOf(EntityId entityId, ComponentStorage const& storage) noexcept {
+            return _locations[_slotOf(entityId) * _components.size() + storage._column];
+        }
+
+        void _removeComponentAt(EntityId entityId, ComponentStorage& storage, uint32 location);
+        void _removeComponents(EntityId entityId);
+        void _releaseEntity(EntityId entityId) noexcept;
+        void _matchQueries(EntityId entityId, ComponentStorage const& storage);
+        void _unmatchQueries(EntityId entityId, ComponentStorage const& storage) noexcept;
+        bool _matchesQuery(uint32 slot, RawQuery const& query) const noexcept;
+        void _populateQuery(RawQuery& query);
+        void _clear(bool notifyObservers);
+        IOResult _readSnapshotStorage(Stream& stream, ComponentStorage& storage, uint32 slotCount, uint64 payloadSize);
+        bool _applyDeltaRecords(view<byte>& delta, uint32 recordCount);
+        bool _applyDeltaStorage(view<byte>& delta);
+
         UP_GAME_API ComponentStorage& _registerComponent(box<ComponentStorage> storage);
         UP_GAME_API void* _addComponentRaw(EntityId entityId, ComponentId componentId, void const* source);
         UP_GAME_API ComponentStorage* _getComponent(ComponentId componentId) noexcept;
+        UP_GAME_API void* _getMutUnsafe(EntityId entityId, ComponentId componentId) noexcept;
+        UP_GAME_API void _parallelFor(
+            TaskQueue* queue,
+            uint32 count,
+            uint32 minBatch,
+            delegate_ref<void(uint32 first, uint32 last)> process);
 
         template <typename Callback, typename... Components, size_t... Indices>
-        void _select(Callback&& callback, typelist<Components...>, std::index_sequence<Indices...>);
+        void _select(
+            Callback&& callback,
+            bool changedOnly,
+            uint32 since,
+            typelist<Components...>,
+            std::index_sequence<Indices...>);
 
-        hash_set<EntityId> _entities;
+        template <typename Callback, typename... Components, size_t... Indices>
+        void _parallelSelect(
+            TaskQueue* queue,
+            uint32 minBatch,
+            Callback&& callback,
+            typelist<Components...>,
+            std::index_sequence<Indices...>);
+
+        template <typename Callback, typename... Components, size_t... Indices>
+        void _selectRange(
+            Callback& callback,
+            ComponentStorage* const (&componentStorages)[sizeof...(Components)],
+            ComponentCursor cursor,
+            typelist<Components...>,
+            std::index_sequence<Indices...>);
+
+        vector<EntityRecord> _records;
+        vector<uint32> _freeSlots;
+        /// Component locations, one row per entity record and one column per storage.
+        vector<uint32> _locations;
         hash_map<ComponentId, ComponentStorage*> _componentMap;
         vector<box<ComponentStorage>> _components;
-        std::underlying_type_t<EntityId> _nextEntityId = to_underlying(EntityId::None) + 1;
+        vector<RawQuery*> _queries;
+        /// Registered queries that include each storage, indexed by column.
+        vector<vector<RawQuery*>> _columnQueries;
+        uint32 _changeTick = 1;
+        std::atomic<int> _structureLocks = 0;
+
+        friend RawQuery;
     };
 
     template <typename... Components>
@@ -129,6 +327,11 @@ namespace up {
         return static_cast<Component*>(getComponentUnsafe(entity, makeComponentId<Component>()));
     }
 
+    template <typename Component>
+    Component* EntityManager::getMut(EntityId entityId) noexcept {
+        return static_cast<Component*>(_getMutUnsafe(entityId, makeComponentId<Component>()));
+    }
+
     template <typename Component>
     Component& EntityManager::addComponent(EntityId entityId, identity_t<Component>&& component) noexcept {
         void* const data = _addComponentRaw(entityId, makeComponentId<Component>(), std::addressof(component));
@@ -146,18 +349,40 @@ namespace up {
     template <typename... Components, typename Callback>
         requires is_invocable_v<Callback, EntityId, Components&...>
     void EntityManager::select(Callback&& callback) {
-        _select(callback, typelist<Components...>{}, std::make_index_sequence<sizeof...(Components)>{});
+        _select(callback, false, 0, typelist<Components...>{}, std::make_index_sequence<sizeof...(Components)>{});
+    }
+
+    template <typename... Components, typename Callback>
+        requires is_invocable_v<Callback, EntityId, Components&...>
+    void EntityManager::selectChanged(uint32 since, Callback&& callback) {
+        _select(callback, true, since, typelist<Components...>{}, std::make_index_sequence<sizeof...(Components)>{});
+    }
+
+    template <typename... Components, typename Callback>
+        requires is_invocable_v<Callback, EntityId, Components&...>
+    void EntityManager::parallelSelect(TaskQueue* queue, Callback&& callback, uint32 minBatch) {
+        _parallelSelect(
+            queue,
+            minBatch,
+            callback,
+            typelist<Components...>{},
+            std::make_index_sequence<sizeof...(Components)>{});
     }
 
     template <typename Component>
-    ComponentStorage& EntityManager::registerComponent() {
-        return _registerComponent(new_box<TypedComponentStorage<Component, std::is_empty_v<Component>>>());
+    ComponentStorage& EntityManager::registerComponent(ComponentLayout layout, ComponentPersistence persistence) {
+        return _registerComponent(
+            new_box<TypedComponentStorage<Component, std::is_empty_v<Component>>>(layout, persistence));
     }
 
     template <typename Callback, typename... Components, size_t... Indices>
-    void EntityManager::_select(Callback&& callback, typelist<Components...>, std::index_sequence<Indices...>) {
-        ComponentStorage* componentStorages[] = {_getComponent(makeComponentId<Components>())...};
-        void* componentData[sizeof...(Components)] = {};
+    void EntityManager::_select(
+        Callback&& callback,
+        bool changedOnly,
+        uint32 since,
+        typelist<Components...> types,
+        std::index_sequence<Indices...> indices) {
+        ComponentStorage* const componentStorages[] = {_getComponent(makeComponentId<Components>())...};
 
 #if !defined(NDEBUG)
         for (size_t index = 0; index != sizeof...(Components); ++index) {
@@ -165,15 +390,50 @@ namespace up {
         }
 #endif
 
-        auto cursor = componentStorages[0]->enumerateUnsafe();
+        auto cursor = changedOnly ? componentStorages[0]->enumerateChangedUnsafe(since)
+                                  : componentStorages[0]->enumerateUnsafe();
+        _selectRange(callback, componentStorages, cursor, types, indices);
+    }
+
+    template <typename Callback, typename... Components, size_t... Indices>
+    void EntityManager::_parallelSelect(
+        TaskQueue* queue,
+        uint32 minBatch,
+        Callback&& callback,
+        typelist<Components...> types,
+        std::index_sequence<Indices...> indices) {
+        ComponentStorage* const componentStorages[] = {_getComponent(makeComponentId<Components>())...};
+
+#if !defined(NDEBUG)
+        for (size_t index = 0; index != sizeof...(Components); ++index) {
+            UP_GUARD_VOID(componentStorages[index] != nullptr);
+        }
+#endif
+
+        _parallelFor(queue, componentStorages[0]->slotCount(), minBatch, [&](uint32 first, uint32 last) {
+            auto cursor = componentStorages[0]->enumerateUnsafe(first, last);
+            _selectRange(callback, componentStorages, cursor, types, indices);
+        });
+    }
+
+    template <typename Callback, typename... Components, size_t... Indices>
+    void EntityManager::_selectRange(
+        Callback& callback,
+        ComponentStorage* const (&componentStorages)[sizeof...(Components)],
+        ComponentCursor cursor,
+        typelist<Components...>,
+        std::index_sequence<Indices...>) {
+        void* componentData[sizeof...(Components)] = {};
+
         while (cursor.next()) {
             componentData[0] = cursor.componentData();
 
             for (size_t index = 1; index != sizeof...(Components); ++index) {
-                componentData[index] = componentStorages[index]->getUnsafe(cursor.entityId());
-                if (componentData[index] == nullptr) {
+                uint32 const location = _locationOf(cursor.entityId(), *componentStorages[index]);
+                if (location == ComponentStorage::InvalidIndex) {
                     goto skip;
                 }
+                componentData[index] = componentStorages[index]->getUnsafe(location);
             }
 
             callback(cursor.entityId(), *(static_cast<Components*>(componentData[Indices]))...);
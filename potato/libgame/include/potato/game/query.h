@@ -0,0 +1,128 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "_export.h"
+#include "common.h"
+#include "component.h"
+#include "entity_manager.h"
+
+#include "potato/spud/concepts.h"
+#include "potato/spud/span.h"
+#include "potato/spud/vector.h"
+
+#include <utility>
+
+namespace up {
+    /// Type-erased base of Query.
+    ///
+    /// A query registered with an EntityManager caches the storages of its
+    /// Components and the slots of every Entity that has all of them. The
+    /// EntityManager keeps the matches up to date as components are added and
+    /// removed, and resolves the storages of component types registered later.
+    ///
+    class RawQuery {
+    public:
+        RawQuery(RawQuery const&) = delete;
+        RawQuery& operator=(RawQuery const&) = delete;
+
+        [[nodiscard]] bool isRegistered() const noexcept { return _entities != nullptr; }
+
+        /// Number of Entities that currently match the query.
+        [[nodiscard]] size_t size() const noexcept { return _matches.size(); }
+
+        [[nodiscard]] span<ComponentId const> componentIds() const noexcept { return _componentIds; }
+
+    protected:
+        UP_GAME_API explicit RawQuery(span<ComponentId const> componentIds);
+        UP_GAME_API ~RawQuery();
+
+        /// Blocks structural changes to the EntityManager while matches are visited.
+        class SelectScope {
+        public:
+            explicit SelectScope(RawQuery& query) noexcept : _entities(*query._entities) {
+                ++_entities._structureLocks;
+            }
+            ~SelectScope() { --_entities._structureLocks; }
+
+            SelectScope(SelectScope const&) = delete;
+            SelectScope& operator=(SelectScope const&) = delete;
+
+        private:
+            EntityManager& _entities;
+        };
+
+        [[nodiscard]] span<uint32 const> _matchedSlots() const noexcept { return _matches; }
+
+        [[nodiscard]] EntityId _entityAt(uint32 slot) const noexcept {
+            return EntityManager::_makeEntityId(slot, _entities->_records[slot].generation);
+        }
+
+        [[nodiscard]] void* _componentAt(uint32 slot, size_t index) const noexcept {
+            uint32 const location = _entities->_locations[slot * _entities->_components.size() + _columns[index]];
+            return _storages[index]->getUnsafe(location);
+        }
+
+    private:
+        static constexpr uint32 noMatch = ~uint32{0};
+
+        [[nodiscard]] bool _isMatched(uint32 slot) const noexcept {
+            return slot < _matchIndex.size() && _matchIndex[slot] != noMatch;
+        }
+        void _addMatch(uint32 slot);
+        void _removeMatch(uint32 slot) noexcept;
+        void _reset() noexcept;
+
+        EntityManager* _entities = nullptr;
+        vector<ComponentId> _componentIds;
+        /// Storage of each Component, or null if its type is not registered yet.
+        vector<ComponentStorage*> _storages;
+        /// Column of each Component in the EntityManager's location records.
+        vector<uint32> _columns;
+        /// Slots of the matching Entities, in no particular order.
+        vector<uint32> _matches;
+        /// Position in _matches of each Entity slot, or noMatch.
+        vector<uint32> _matchIndex;
+
+        friend EntityManager;
+    };
+
+    /// Persistent, pre-matched alternative to EntityManager::select.
+    ///
+    /// Systems typically own their queries, registering them in start() and
+    /// unregistering them in stop().
+    ///
+    template <typename... Components>
+    class Query final : public RawQuery {
+    public:
+        static_assert(sizeof...(Components) != 0);
+
+        Query() : RawQuery(_ids) { }
+
+        /// Invokes callback for every matching Entity.
+        ///
+        /// The callback must not create or destroy entities or add or remove components.
+        template <typename Callback>
+            requires is_invocable_v<Callback, EntityId, Components&...>
+        void select(Callback&& callback) {
+            _select(callback, std::make_index_sequence<sizeof...(Components)>{});
+        }
+
+    private:
+        template <typename Callback, size_t... Indices>
+        void _select(Callback& callback, std::index_sequence<Indices...>);
+
+        static constexpr ComponentId _ids[] = {makeComponentId<Components>()...};
+    };
+
+    template <typename... Components>
+    template <typename Callback, size_t... Indices>
+    void Query<Components...>::_select(Callback& callback, std::index_sequence<Indices...>) {
+        UP_GUARD_VOID(isRegistered());
+
+        SelectScope scope(*this);
+        for (uint32 const slot : _matchedSlots()) {
+            callback(_entityAt(slot), *static_cast<Components*>(_componentAt(slot, Indices))...);
+        }
+    }
+} // namespace up
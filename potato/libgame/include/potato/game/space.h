@@ -3,9 +3,11 @@
 #pragma once
 
 #include "_export.h"
+#include "entity_command_buffer.h"
 #include "entity_manager.h"
 #include "system.h"
 
+#include "potato/spud/arena.h"
 #include "potato/spud/box.h"
 #include "potato/spud/vector.h"
 
@@ -21,6 +23,26 @@ namespace up {
         UP_GAME_API virtual void update(float deltaTime);
         UP_GAME_API virtual void render(class RenderContext& ctx);
 
+        /// Advances the simulation by frameTime seconds, calling update once per
+        /// fixed tick of tickDuration() seconds.
+        ///
+        /// Time left over is carried into the next call. At most maxCatchUpTicks
+        /// ticks run per call; time beyond that is dropped, so that slow frames
+        /// slow the simulation down instead of making the following frames slower
+        /// still. Returns the number of ticks run.
+        UP_GAME_API uint32 advance(float frameTime);
+
+        /// Sets the rate of the ticks run by advance.
+        UP_GAME_API void setTickRate(float ticksPerSecond, uint32 maxCatchUpTicks = defaultMaxCatchUpTicks);
+
+        float tickDuration() const noexcept { return _tickDuration; }
+        uint32 maxCatchUpTicks() const noexcept { return _maxCatchUpTicks; }
+
+        /// Fraction of a tick by which advance has run ahead of the last tick.
+        /// Renders blend the previous and the last tick by this; it is 1 after a
+        /// direct call to update.
+        float interpolationAlpha() const noexcept { return _interpolationAlpha; }
+
         // FIXME: find a better place for this...
         static UP_GAME_API void addDemoSystem(Space& space, class AudioEngine& audio);
 
@@ -32,11 +54,49 @@ namespace up {
 
         EntityManager& entities() noexcept { return _entities; }
 
+        /// Systems in the order they update.
+        view<box<System>> systems() const noexcept { return _systems; }
+
+        /// Seconds spent in each system during the last update, including the
+        /// playback of the commands it recorded; indexed like systems(). Only
+        /// measured while profiling is enabled.
+        view<double> systemUpdateSeconds() const noexcept { return _systemUpdateSeconds; }
+        void setProfiling(bool enabled) noexcept { _profiling = enabled; }
+
+        /// Structural changes recorded here, from any thread, are played back
+        /// after each system's update.
+        EntityCommandBuffer& commands() noexcept { return _commands; }
+
+        /// Allocator for data that only needs to live until the end of the next frame,
+        /// such as per-frame render lists. Recycled once per frame: by each call to
+        /// advance, however many ticks it runs, or by a direct call to update.
+        memory_resource* frameResource() noexcept { return _frameArena.resource(); }
+
+        /// Queue serviced by worker threads that systems may use for parallelSelect.
+        /// Without a bound queue, parallel work runs on the updating thread.
+        void bindTaskQueue(TaskQueue* queue) noexcept { _taskQueue = queue; }
+        TaskQueue* taskQueue() const noexcept { return _taskQueue; }
+
+        static constexpr float defaultTickRate = 60.f;
+        static constexpr uint32 defaultMaxCatchUpTicks = 4;
+
     private:
         enum class State { New, Starting, Started, Stopped };
 
+        /// Runs every system once, without beginning a new frame.
+        void _tick(float deltaTime);
+
         EntityManager _entities;
+        EntityCommandBuffer _commands;
         vector<box<System>> _systems;
+        vector<double> _systemUpdateSeconds;
+        frame_arena _frameArena;
+        TaskQueue* _taskQueue = nullptr;
+        float _tickDuration = 1.f / defaultTickRate;
+        float _accumulator = 0.f;
+        float _interpolationAlpha = 1.f;
+        uint32 _maxCatchUpTicks = defaultMaxCatchUpTicks;
         State _state = State::New;
+        bool _profiling = false;
     };
 } // namespace up
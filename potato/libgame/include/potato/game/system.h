@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include "potato/spud/int_types.h"
+#include "potato/spud/zstring_view.h"
+
 namespace up {
     class RenderContext;
     class Space;
@@ -17,10 +20,20 @@ namespace up {
         virtual void update(float deltaTime) = 0;
         virtual void render(RenderContext&) { }
 
+        /// Name under which the system appears in profiling reports.
+        virtual zstring_view name() const noexcept { return "system"_zsv; }
+
     protected:
         Space& space() noexcept { return m_space; }
 
+        /// Change tick at the end of this system's previous update; pass to
+        /// EntityManager::selectChanged to visit only Components changed since.
+        uint32 lastUpdateTick() const noexcept { return m_lastUpdateTick; }
+
     private:
         Space& m_space;
+        uint32 m_lastUpdateTick = 0;
+
+        friend Space;
     };
 } // namespace up
@@ -0,0 +1,42 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "_export.h"
+
+#include "potato/spud/platform.h"
+#include "potato/spud/span.h"
+
+#include <glm/gtx/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+namespace up {
+    struct TransformComponent;
+
+    /// Computes translate(position) * mat4_cast(rotation) * scale(scale).
+    ///
+    /// The rotation is expected to be a unit quaternion.
+    [[nodiscard]] UP_GAME_API glm::mat4x4 UP_VECTORCALL
+    composeMatrix(glm::vec3 position, glm::quat rotation, glm::vec3 scale) noexcept;
+
+    /// Computes composeMatrix() for every element of the input spans, several
+    /// transforms at a time using SSE or AVX lanes where available.
+    ///
+    /// All spans must have the same size.
+    UP_GAME_API void composeMatrices(
+        span<glm::vec3 const> positions,
+        span<glm::quat const> rotations,
+        span<glm::vec3 const> scales,
+        span<glm::mat4x4> matrices) noexcept;
+
+    /// Reference implementation of composeMatrices() that computes one matrix at a time.
+    UP_GAME_API void composeMatricesScalar(
+        span<glm::vec3 const> positions,
+        span<glm::quat const> rotations,
+        span<glm::vec3 const> scales,
+        span<glm::mat4x4> matrices) noexcept;
+
+    /// Stores the local matrix of each transform in its TransformComponent::matrix.
+    UP_GAME_API void composeLocalMatrices(span<TransformComponent* const> transforms) noexcept;
+} // namespace up
@@ -4,6 +4,7 @@
 #include "potato/game/components/camera_controllers.h"
 #include "potato/game/components/demo_components.h"
 #include "potato/game/components/mesh_component.h"
+#include "potato/game/components/parent_component.h"
 #include "potato/game/components/rigidbody_component.h"
 #include "potato/game/components/transform_component.h"
 #include "potato/game/entity_manager.h"
@@ -15,6 +16,7 @@ namespace up {
         space.entities().registerComponent<CameraComponent>();
         space.entities().registerComponent<FlyCameraComponent>();
         space.entities().registerComponent<MeshComponent>();
+        space.entities().registerComponent<ParentComponent>();
         space.entities().registerComponent<RigidBodyComponent>();
         space.entities().registerComponent<DemoWaveComponent>();
         space.entities().registerComponent<DemoSpinComponent>();
@@ -0,0 +1,48 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/game/entity_command_buffer.h"
+
+namespace up {
+    EntityCommandBuffer::~EntityCommandBuffer() { _clearUnlocked(); }
+
+    EntityId EntityCommandBuffer::createEntity() {
+        std::lock_guard lock(_lock);
+        // placeholders are numbered from 1 so that none equals EntityId::None
+        return EntityId{++_placeholderCount};
+    }
+
+    void EntityCommandBuffer::destroyEntity(EntityId entityId) {
+        _record({.entityId = entityId, .type = CommandType::Destroy});
+    }
+
+    void EntityCommandBuffer::removeComponent(EntityId entityId, ComponentId componentId) {
+        _record({.entityId = entityId, .componentId = componentId, .type = CommandType::Remove});
+    }
+
+    bool EntityCommandBuffer::empty() const noexcept {
+        std::lock_guard lock(_lock);
+        return _commands.empty() && _placeholderCount == 0;
+    }
+
+    void EntityCommandBuffer::clear() noexcept {
+        std::lock_guard lock(_lock);
+        _clearUnlocked();
+    }
+
+    void EntityCommandBuffer::_record(Command command) {
+        std::lock_guard lock(_lock);
+        command.sequence = static_cast<uint32>(_commands.size());
+        _commands.push_back(command);
+    }
+
+    void EntityCommandBuffer::_clearUnlocked() noexcept {
+        for (Command const& command : _commands) {
+            if (command.destroy != nullptr) {
+                command.destroy(command.component);
+            }
+        }
+        _commands.clear();
+        _payloads.reset();
+        _placeholderCount = 0;
+    }
+} // namespace up
@@ -1,45 +1,356 @@
 // Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
 
 #include "potato/game/entity_manager.h"
+#include "potato/game/entity_command_buffer.h"
+#include "potato/game/query.h"
 
 #include "potato/runtime/assertion.h"
+#include "potato/runtime/stream.h"
+#include "potato/spud/arena.h"
 #include "potato/spud/erase.h"
 #include "potato/spud/find.h"
 #include "potato/spud/sequence.h"
+#include "potato/spud/sort.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <thread>
 
 namespace up {
+    namespace {
+        /// Batches of a parallelFor, shared between the caller and helper tasks.
+        ///
+        /// Helper tasks may be dequeued after the caller has returned; such late
+        /// helpers find no batches left to claim and never touch the callback.
+        struct ParallelRangeState : shared<ParallelRangeState> {
+            ParallelRangeState(uint32 count, uint32 batchSize, delegate_ref<void(uint32, uint32)> process)
+                : count(count)
+                , batchSize(batchSize)
+                , batchCount((count + batchSize - 1) / batchSize)
+                , process(process) { }
+
+            /// Claims and processes batches until none remain.
+            void run() {
+                for (;;) {
+                    uint32 const batch = next.fetch_add(1, std::memory_order_relaxed);
+                    if (batch >= batchCount) {
+                        return;
+                    }
+
+                    uint32 const first = batch * batchSize;
+                    process(first, std::min(first + batchSize, count));
+
+                    if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == batchCount) {
+                        done.notify_all();
+                    }
+                }
+            }
+
+            void wait() {
+                for (uint32 completed = done.load(std::memory_order_acquire); completed != batchCount;
+                     completed = done.load(std::memory_order_acquire)) {
+                    done.wait(completed, std::memory_order_acquire);
+                }
+            }
+
+            uint32 const count = 0;
+            uint32 const batchSize = 0;
+            uint32 const batchCount = 0;
+            delegate_ref<void(uint32, uint32)> const process;
+            std::atomic<uint32> next = 0;
+            std::atomic<uint32> done = 0;
+        };
+
+        constexpr uint32 snapshotMagic = 0x5345'5055; // "UPES"
+        constexpr uint32 snapshotVersion = 1;
+
+        struct SnapshotHeader {
+            uint32 magic = snapshotMagic;
+            uint32 version = snapshotVersion;
+            uint32 recordCount = 0;
+            uint32 freeCount = 0;
+            uint32 storageCount = 0;
+            uint32 reserved = 0;
+        };
+
+        /// Describes one storage block; the table of these follows the header.
+        struct SnapshotStorage {
+            uint64 componentId = 0;
+            uint64 payloadSize = 0;
+            uint32 slotCount = 0;
+            uint32 componentSize = 0;
+            uint8 encoding = 0;
+            uint8 layout = 0;
+            uint8 reserved[6] = {};
+        };
+
+        IOResult writeBytes(Stream& stream, span<byte const> bytes) {
+            return bytes.empty() ? IOResult::Success : stream.write(bytes);
+        }
+
+        constexpr uint32 deltaMagic = 0x4445'5055; // "UPED"
+        constexpr uint32 deltaVersion = 1;
+
+        struct DeltaHeader {
+            uint32 magic = deltaMagic;
+            uint32 version = deltaVersion;
+            uint32 baselineRecordCount = 0;
+            uint32 recordCount = 0;
+            uint64 payloadSize = 0;
+        };
+
+        /// Operation on a component, stored in the low two bits of each slot delta.
+        enum class DeltaOp : uint8 { Add, Remove, Change, End };
+
+        void writeVarint(vector<byte>& out, uint64 value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<byte>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<byte>(value));
+        }
+
+        [[nodiscard]] bool readVarint(view<byte>& in, uint64& value) noexcept {
+            value = 0;
+            for (uint32 shift = 0; shift < 64 && !in.empty(); shift += 7) {
+                auto const next = static_cast<uint64>(in.front());
+                in.pop_front();
+                value |= (next & 0x7f) << shift;
+                if ((next & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void appendBytes(vector<byte>& out, void const* data, size_t size) {
+            auto const* const first = static_cast<byte const*>(data);
+            out.insert(out.end(), first, first + size);
+        }
+
+        [[nodiscard]] bool takeBytes(view<byte>& in, uint64 size, view<byte>& out) noexcept {
+            if (size > in.size()) {
+                return false;
+            }
+            out = in.first(size);
+            in = in.subspan(size);
+            return true;
+        }
+
+        [[nodiscard]] bool takeEncoded(view<byte>& in, view<char>& out) noexcept {
+            uint64 length = 0;
+            view<byte> bytes;
+            if (!readVarint(in, length) || !takeBytes(in, length, bytes)) {
+                return false;
+            }
+            out = {reinterpret_cast<char const*>(bytes.data()), bytes.size()};
+            return true;
+        }
+
+        /// Appends current ^ baseline as alternating runs of unchanged and changed bytes.
+        void writeXorRuns(vector<byte>& out, byte const* current, byte const* baseline, size_t size) {
+            size_t index = 0;
+            while (index != size) {
+                size_t const unchanged = index;
+                while (index != size && current[index] == baseline[index]) {
+                    ++index;
+                }
+
+                // a single unchanged byte is cheaper to keep in the literal than to end it
+                size_t const changed = index;
+                while (index != size &&
+                       (current[index] != baseline[index] ||
+                        (index + 1 != size && current[index + 1] != baseline[index + 1]))) {
+                    ++index;
+                }
+
+                writeVarint(out, changed - unchanged);
+                writeVarint(out, index - changed);
+                for (size_t at = changed; at != index; ++at) {
+                    out.push_back(current[at] ^ baseline[at]);
+                }
+            }
+        }
+
+        [[nodiscard]] bool applyXorRuns(view<byte>& in, byte* data, size_t size) noexcept {
+            size_t index = 0;
+            while (index != size) {
+                uint64 unchanged = 0;
+                uint64 changed = 0;
+                view<byte> bytes;
+                if (!readVarint(in, unchanged) || !readVarint(in, changed) || unchanged + changed == 0 ||
+                    unchanged > size - index || changed > size - index - unchanged || !takeBytes(in, changed, bytes)) {
+                    return false;
+                }
+                index += unchanged;
+                for (byte const mask : bytes) {
+                    data[index++] ^= mask;
+                }
+            }
+            return true;
+        }
+    } // namespace
+
     EntityManager::EntityManager() = default;
-    EntityManager::~EntityManager() = default;
+    EntityManager::~EntityManager() {
+        for (RawQuery* query : _queries) {
+            query->_reset();
+        }
+    }
 
     void* EntityManager::getComponentUnsafe(EntityId entityId, ComponentId componentId) noexcept {
         ComponentStorage* const component = _getComponent(componentId);
-        if (component != nullptr) {
-            return component->getUnsafe(entityId);
+        if (component == nullptr || !isAlive(entityId)) {
+            return nullptr;
         }
-        return nullptr;
+
+        uint32 const location = _locationOf(entityId, *component);
+        return location != ComponentStorage::InvalidIndex ? component->getUnsafe(location) : nullptr;
     }
 
     auto EntityManager::createEntity() -> EntityId {
-        EntityId const id{_nextEntityId++};
-        _entities.insert(id);
-        return id;
+        UP_ASSERT(_structureLocks == 0);
+
+        uint32 slot = 0;
+        if (!_freeSlots.empty()) {
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        else {
+            slot = static_cast<uint32>(_records.size());
+            _records.emplace_back();
+            _locations.resize(_locations.size() + _components.size(), ComponentStorage::InvalidIndex);
+        }
+
+        EntityRecord& record = _records[slot];
+        record.alive = true;
+        return _makeEntityId(slot, record.generation);
     }
 
     bool EntityManager::destroyEntity(EntityId entityId) noexcept {
-        if (!_entities.erase(entityId)) {
+        UP_ASSERT(_structureLocks == 0);
+        if (!isAlive(entityId)) {
             return false;
         }
 
-        for (box<ComponentStorage>& comp : _components) {
-            comp->remove(entityId);
-        }
+        _removeComponents(entityId);
+        _releaseEntity(entityId);
         return true;
     }
 
+    void EntityManager::playback(EntityCommandBuffer& commands) {
+        using Command = EntityCommandBuffer::Command;
+        using CommandType = EntityCommandBuffer::CommandType;
+
+        UP_ASSERT(_structureLocks == 0);
+
+        std::lock_guard lock(commands._lock);
+        if (commands._commands.empty() && commands._placeholderCount == 0) {
+            return;
+        }
+
+        scratch_scope scratch;
+        vector<EntityId> created(scratch.resource());
+        created.reserve(commands._placeholderCount);
+        for (uint32 index = 0; index != commands._placeholderCount; ++index) {
+            created.push_back(createEntity());
+        }
+
+        for (Command& command : commands._commands) {
+            if (EntityCommandBuffer::isPlaceholder(command.entityId)) {
+                auto const placeholder = static_cast<uint32>(to_underlying(command.entityId)) - 1;
+                UP_ASSERT(placeholder < created.size());
+                command.entityId = created[placeholder];
+            }
+        }
+
+        // group each Entity's commands together, in the order they were recorded
+        sort(commands._commands, [](Command const& lhs, Command const& rhs) {
+            return lhs.entityId != rhs.entityId ? lhs.entityId < rhs.entityId : lhs.sequence < rhs.sequence;
+        });
+
+        vector<EntityId> destroyed(scratch.resource());
+        Command const* const end = commands._commands.end();
+        for (Command const* command = commands._commands.begin(); command != end;) {
+            EntityId const entityId = command->entityId;
+
+            // commands for an Entity that is already gone, or that follow its
+            // destruction, are dropped just as they would fail if applied directly
+            bool alive = isAlive(entityId);
+            for (; command != end && command->entityId == entityId; ++command) {
+                if (!alive) {
+                    continue;
+                }
+                switch (command->type) {
+                    case CommandType::Add:
+                        _addComponentRaw(entityId, command->componentId, command->component);
+                        break;
+                    case CommandType::Remove:
+                        removeComponent(entityId, command->componentId);
+                        break;
+                    case CommandType::Destroy:
+                        destroyed.push_back(entityId);
+                        alive = false;
+                        break;
+                }
+            }
+        }
+
+        // removals are batched by storage, visiting only the storages that hold
+        // a component of each destroyed Entity
+        struct Removal {
+            uint32 column = 0;
+            EntityId entityId = EntityId::None;
+        };
+        vector<Removal> removals(scratch.resource());
+        size_t const columns = _components.size();
+        for (EntityId const entityId : destroyed) {
+            uint32 const slot = _slotOf(entityId);
+            uint32 remaining = _records[slot].componentCount;
+            for (uint32 column = 0; remaining != 0 && column != columns; ++column) {
+                if (_locations[slot * columns + column] != ComponentStorage::InvalidIndex) {
+                    removals.push_back({column, entityId});
+                    --remaining;
+                }
+            }
+        }
+        sort(removals, {}, &Removal::column);
+
+        // observers may have removed components already, so locations are re-read
+        for (Removal const& removal : removals) {
+            ComponentStorage& storage = *_components[removal.column];
+            uint32 const location = _locationOf(removal.entityId, storage);
+            if (location != ComponentStorage::InvalidIndex) {
+                _removeComponentAt(removal.entityId, storage, location);
+            }
+        }
+
+        for (EntityId const entityId : destroyed) {
+            // catches any component an observer added while the batch was removed
+            _removeComponents(entityId);
+            _releaseEntity(entityId);
+        }
+
+        commands._clearUnlocked();
+    }
+
     bool EntityManager::removeComponent(EntityId entityId, ComponentId componentId) noexcept {
+        UP_ASSERT(_structureLocks == 0);
         ComponentStorage* const component = _getComponent(componentId);
         UP_GUARD(component != nullptr, false);
-        return component->remove(entityId);
+        if (!isAlive(entityId)) {
+            return false;
+        }
+
+        uint32 const location = _locationOf(entityId, *component);
+        if (location == ComponentStorage::InvalidIndex) {
+            return false;
+        }
+
+        _removeComponentAt(entityId, *component, location);
+        return true;
     }
 
     void EntityManager::observe(RawComponentObserver& observer) {
@@ -54,23 +365,743 @@ namespace up {
         component->unobserve(&observer);
     }
 
+    void EntityManager::registerQuery(RawQuery& query) {
+        UP_ASSERT(_structureLocks == 0);
+        UP_GUARD_VOID(query._entities == nullptr);
+
+        query._entities = this;
+        _queries.push_back(&query);
+
+        for (size_t index = 0; index != query._componentIds.size(); ++index) {
+            if (ComponentStorage* const storage = _getComponent(query._componentIds[index]); storage != nullptr) {
+                query._storages[index] = storage;
+                query._columns[index] = storage->_column;
+                _columnQueries[storage->_column].push_back(&query);
+            }
+        }
+
+        _populateQuery(query);
+    }
+
+    void EntityManager::unregisterQuery(RawQuery& query) noexcept {
+        UP_ASSERT(_structureLocks == 0);
+        UP_GUARD_VOID(query._entities == this);
+
+        for (uint32 const column : query._columns) {
+            if (column != ComponentStorage::InvalidIndex) {
+                erase(_columnQueries[column], &query);
+            }
+        }
+        erase(_queries, &query);
+        query._reset();
+    }
+
+    IOResult EntityManager::writeSnapshot(Stream& stream) {
+        UP_ASSERT(_structureLocks == 0);
+
+        vector<ComponentStorage*> storages;
+        vector<SnapshotStorage> table;
+        vector<vector<char>> encoded;
+        for (box<ComponentStorage>& storage : _components) {
+            if (storage->encoding() == ComponentEncoding::None) {
+                continue;
+            }
+
+            SnapshotStorage& info = table.push_back({
+                .componentId = to_underlying(storage->componentId()),
+                .slotCount = storage->slotCount(),
+                .componentSize = storage->componentSize(),
+                .encoding = to_underlying(storage->encoding()),
+                .layout = to_underlying(storage->layout())});
+            storages.push_back(storage.get());
+
+            // schema-encoded components are length-prefixed, so that each can be decoded on its own
+            vector<char>& payload = encoded.emplace_back();
+            if (storage->encoding() == ComponentEncoding::Schema) {
+                for (uint32 index = 0; index != info.slotCount; ++index) {
+                    size_t const prefix = payload.size();
+                    payload.resize(prefix + sizeof(uint32));
+                    if (!storage->encodeComponent(index, payload)) {
+                        return IOResult::InvalidArgument;
+                    }
+                    auto const length = static_cast<uint32>(payload.size() - prefix - sizeof(uint32));
+                    std::memcpy(payload.data() + prefix, &length, sizeof(length));
+                }
+                info.payloadSize = payload.size();
+            }
+            else {
+                info.payloadSize = storage->rawComponents().size();
+            }
+        }
+
+        vector<uint32> generations;
+        generations.reserve(_records.size());
+        for (EntityRecord const& record : _records) {
+            generations.push_back(record.generation);
+        }
+
+        SnapshotHeader const header{
+            .recordCount = static_cast<uint32>(_records.size()),
+            .freeCount = static_cast<uint32>(_freeSlots.size()),
+            .storageCount = static_cast<uint32>(storages.size())};
+
+        IOResult rs = writeBytes(stream, span<SnapshotHeader const>{&header, 1}.as_bytes());
+        for (auto const block :
+             {span<SnapshotStorage const>(table).as_bytes(),
+              span<uint32 const>(generations).as_bytes(),
+              span<uint32 const>(_freeSlots).as_bytes()}) {
+            if (rs == IOResult::Success) {
+                rs = writeBytes(stream, block);
+            }
+        }
+
+        for (size_t index = 0; index != storages.size() && rs == IOResult::Success; ++index) {
+            ComponentStorage& storage = *storages[index];
+            rs = writeBytes(stream, span<EntityId const>(storage._entities).as_bytes());
+            if (rs == IOResult::Success) {
+                rs = writeBytes(
+                    stream,
+                    storage.encoding() == ComponentEncoding::Raw ? span<byte const>(storage.rawComponents())
+                                                                : encoded[index].as_bytes());
+            }
+        }
+        return rs;
+    }
+
+    IOResult EntityManager::readSnapshot(Stream& stream) {
+        UP_ASSERT(_structureLocks == 0);
+
+        SnapshotHeader header;
+        if (IOResult const rs = readExact(stream, span<SnapshotHeader>{&header, 1}.as_bytes());
+            rs != IOResult::Success) {
+            return rs;
+        }
+        if (header.magic != snapshotMagic || header.version != snapshotVersion) {
+            return IOResult::Malformed;
+        }
+
+        vector<SnapshotStorage> table(header.storageCount);
+        vector<uint32> generations(header.recordCount);
+        vector<uint32> freeSlots(header.freeCount);
+        for (auto const block :
+             {span<SnapshotStorage>(table).as_bytes(),
+              span<uint32>(generations).as_bytes(),
+              span<uint32>(freeSlots).as_bytes()}) {
+            if (IOResult const rs = readExact(stream, block); rs != IOResult::Success) {
+                return rs;
+            }
+        }
+
+        // everything that can be validated up front is, so that a mismatched
+        // snapshot leaves the current world untouched
+        vector<ComponentStorage*> storages;
+        for (SnapshotStorage const& info : table) {
+            ComponentStorage* const storage = _getComponent(ComponentId{info.componentId});
+            if (storage == nullptr || contains(storages, storage) ||
+                info.encoding != to_underlying(storage->encoding()) ||
+                info.layout != to_underlying(storage->layout()) || info.componentSize != storage->componentSize() ||
+                (storage->encoding() == ComponentEncoding::Raw &&
+                 info.payloadSize != uint64{info.slotCount} * info.componentSize)) {
+                return IOResult::Malformed;
+            }
+            storages.push_back(storage);
+        }
+        vector<bool> alive(header.recordCount, true);
+        for (uint32 const slot : freeSlots) {
+            if (slot >= header.recordCount || !alive[slot]) {
+                return IOResult::Malformed;
+            }
+            alive[slot] = false;
+        }
+        for (uint32 const generation : generations) {
+            if (generation == 0) {
+                return IOResult::Malformed;
+            }
+        }
+
+        _clear(true);
+
+        _records.resize(header.recordCount);
+        for (uint32 slot = 0; slot != header.recordCount; ++slot) {
+            _records[slot] = {.generation = generations[slot], .alive = alive[slot]};
+        }
+        _freeSlots = std::move(freeSlots);
+        _locations.resize(_records.size() * _components.size(), ComponentStorage::InvalidIndex);
+
+        for (size_t index = 0; index != storages.size(); ++index) {
+            SnapshotStorage const& info = table[index];
+            if (IOResult const rs = _readSnapshotStorage(stream, *storages[index], info.slotCount, info.payloadSize);
+                rs != IOResult::Success) {
+                // the partially loaded world was never announced to observers
+                _clear(false);
+                return rs;
+            }
+        }
+
+        for (RawQuery* const query : _queries) {
+            _populateQuery(*query);
+        }
+
+        for (ComponentStorage* const storage : storages) {
+            for (ComponentCursor cursor = storage->enumerateUnsafe(); cursor.next();) {
+                for (RawComponentObserver* const observer : storage->_observers) {
+                    observer->onAdd(cursor.entityId(), cursor.componentData());
+                }
+            }
+        }
+        return IOResult::Success;
+    }
+
+    IOResult EntityManager::writeDelta(EntityManager& baseline, Stream& stream) {
+        UP_ASSERT(_structureLocks == 0);
+
+        vector<byte> delta;
+
+        // runs of entity records that differ from the baseline; records the
+        // baseline doesn't have always differ
+        auto const recordChanged = [this, &baseline](uint32 slot) {
+            return slot >= baseline._records.size() ||
+                _records[slot].generation != baseline._records[slot].generation ||
+                _records[slot].alive != baseline._records[slot].alive;
+        };
+        vector<uint32> runs;
+        for (uint32 slot = 0; slot != _records.size(); ++slot) {
+            if (recordChanged(slot)) {
+                uint32 const first = slot;
+                while (slot + 1 != _records.size() && recordChanged(slot + 1)) {
+                    ++slot;
+                }
+                runs.push_back(first);
+                runs.push_back(slot + 1);
+            }
+        }
+        writeVarint(delta, runs.size() / 2);
+        uint32 end = 0;
+        for (size_t run = 0; run != runs.size(); run += 2) {
+            writeVarint(delta, runs[run] - end);
+            writeVarint(delta, runs[run + 1] - runs[run]);
+            for (uint32 slot = runs[run]; slot != runs[run + 1]; ++slot) {
+                writeVarint(delta, (uint64{_records[slot].generation} << 1) | (_records[slot].alive ? 1 : 0));
+            }
+            end = runs[run + 1];
+        }
+
+        // free slots are used as a stack, so usually only the top differs
+        size_t keep = 0;
+        while (keep != _freeSlots.size() && keep != baseline._freeSlots.size() &&
+               _freeSlots[keep] == baseline._freeSlots[keep]) {
+            ++keep;
+        }
+        writeVarint(delta, keep);
+        writeVarint(delta, _freeSlots.size() - keep);
+        for (size_t index = keep; index != _freeSlots.size(); ++index) {
+            writeVarint(delta, _freeSlots[index]);
+        }
+
+        vector<byte> sections;
+        uint32 sectionCount = 0;
+        vector<char> encoded;
+        vector<char> baselineEncoded;
+        for (box<ComponentStorage>& storage : _components) {
+            ComponentEncoding const encoding = storage->encoding();
+            if (encoding == ComponentEncoding::None) {
+                continue;
+            }
+
+            uint32 const size = storage->componentSize();
+            ComponentStorage* const base = baseline._getComponent(storage->componentId());
+            if (base != nullptr && (base->encoding() != encoding || base->componentSize() != size)) {
+                return IOResult::InvalidArgument;
+            }
+
+            size_t const sectionStart = sections.size();
+            auto const componentId = to_underlying(storage->componentId());
+            appendBytes(sections, &componentId, sizeof(componentId));
+            sections.push_back(static_cast<byte>(encoding));
+            writeVarint(sections, size);
+            size_t const opsStart = sections.size();
+
+            uint32 previous = 0;
+            auto const writeOp = [&sections, &previous](uint32 slot, DeltaOp op) {
+                writeVarint(sections, (uint64{slot - previous} << 2) | to_underlying(op));
+                previous = slot;
+            };
+            auto const writeEncoded = [&sections](vector<char> const& bytes) {
+                writeVarint(sections, bytes.size());
+                appendBytes(sections, bytes.data(), bytes.size());
+            };
+
+            for (uint32 slot = 0; slot != _records.size(); ++slot) {
+                if (!_records[slot].alive) {
+                    continue;
+                }
+                EntityId const entityId = _makeEntityId(slot, _records[slot].generation);
+                uint32 const location = _locationOf(entityId, *storage);
+                uint32 const baseLocation = base != nullptr && baseline.isAlive(entityId)
+                    ? baseline._locationOf(entityId, *base)
+                    : ComponentStorage::InvalidIndex;
+
+                if (location == ComponentStorage::InvalidIndex) {
+                    if (baseLocation != ComponentStorage::InvalidIndex) {
+                        writeOp(slot, DeltaOp::Remove);
+                    }
+                    continue;
+                }
+
+                if (encoding == ComponentEncoding::Raw) {
+                    auto const* const data = static_cast<byte const*>(storage->getUnsafe(location));
+                    if (baseLocation == ComponentStorage::InvalidIndex) {
+                        writeOp(slot, DeltaOp::Add);
+                        appendBytes(sections, data, size);
+                    }
+                    else if (auto const* const old = static_cast<byte const*>(base->getUnsafe(baseLocation));
+                             std::memcmp(data, old, size) != 0) {
+                        writeOp(slot, DeltaOp::Change);
+                        writeXorRuns(sections, data, old, size);
+                    }
+                    continue;
+                }
+
+                encoded.clear();
+                if (!storage->encodeComponent(location, encoded)) {
+                    return IOResult::InvalidArgument;
+                }
+                if (baseLocation == ComponentStorage::InvalidIndex) {
+                    writeOp(slot, DeltaOp::Add);
+                    writeEncoded(encoded);
+                    continue;
+                }
+                baselineEncoded.clear();
+                if (!base->encodeComponent(baseLocation, baselineEncoded)) {
+                    return IOResult::InvalidArgument;
+                }
+                if (encoded.size() != baselineEncoded.size() ||
+                    std::memcmp(encoded.data(), baselineEncoded.data(), encoded.size()) != 0) {
+                    writeOp(slot, DeltaOp::Change);
+                    writeEncoded(encoded);
+                }
+            }
+
+            if (sections.size() == opsStart) {
+                sections.resize(sectionStart);
+                continue;
+            }
+            writeVarint(sections, to_underlying(DeltaOp::End));
+            ++sectionCount;
+        }
+        writeVarint(delta, sectionCount);
+        delta.insert(delta.end(), sections.begin(), sections.end());
+
+        DeltaHeader const header{
+            .baselineRecordCount = static_cast<uint32>(baseline._records.size()),
+            .recordCount = static_cast<uint32>(_records.size()),
+            .payloadSize = delta.size()};
+        IOResult const rs = writeBytes(stream, span<DeltaHeader const>{&header, 1}.as_bytes());
+        return rs == IOResult::Success ? writeBytes(stream, delta) : rs;
+    }
+
+    IOResult EntityManager::applyDelta(Stream& stream) {
+        UP_ASSERT(_structureLocks == 0);
+
+        DeltaHeader header;
+        if (IOResult const rs = readExact(stream, span<DeltaHeader>{&header, 1}.as_bytes()); rs != IOResult::Success) {
+            return rs;
+        }
+        if (header.magic != deltaMagic || header.version != deltaVersion ||
+            header.baselineRecordCount != _records.size()) {
+            return IOResult::Malformed;
+        }
+
+        vector<byte> payload(header.payloadSize);
+        if (IOResult const rs = readExact(stream, payload); rs != IOResult::Success) {
+            return rs;
+        }
+
+        view<byte> delta = payload;
+        if (!_applyDeltaRecords(delta, header.recordCount)) {
+            return IOResult::Malformed;
+        }
+
+        uint64 sectionCount = 0;
+        if (!readVarint(delta, sectionCount)) {
+            return IOResult::Malformed;
+        }
+        for (uint64 section = 0; section != sectionCount; ++section) {
+            if (!_applyDeltaStorage(delta)) {
+                return IOResult::Malformed;
+            }
+        }
+        return delta.empty() ? IOResult::Success : IOResult::Malformed;
+    }
+
+    bool EntityManager::_applyDeltaRecords(view<byte>& delta, uint32 recordCount) {
+        // records past the new end belong to entities that no longer exist
+        for (uint32 slot = recordCount; slot < _records.size(); ++slot) {
+            if (_records[slot].alive) {
+                _removeComponents(_makeEntityId(slot, _records[slot].generation));
+            }
+        }
+        _records.resize(recordCount);
+        _locations.resize(_records.size() * _components.size(), ComponentStorage::InvalidIndex);
+
+        uint64 runCount = 0;
+        if (!readVarint(delta, runCount)) {
+            return false;
+        }
+        uint64 slot = 0;
+        for (uint64 run = 0; run != runCount; ++run) {
+            uint64 gap = 0;
+            uint64 length = 0;
+            if (!readVarint(delta, gap) || !readVarint(delta, length) || gap > recordCount - slot ||
+                length > recordCount - slot - gap) {
+                return false;
+            }
+            slot += gap;
+            for (uint64 const end = slot + length; slot != end; ++slot) {
+                uint64 state = 0;
+                if (!readVarint(delta, state) || (state >> 1) == 0 || (state >> 1) > ~uint32{0}) {
+                    return false;
+                }
+                // a changed record means the Entity that had the slot, if any, is gone
+                if (_records[slot].alive) {
+                    _removeComponents(_makeEntityId(static_cast<uint32>(slot), _records[slot].generation));
+                }
+                _records[slot].generation = static_cast<uint32>(state >> 1);
+                _records[slot].alive = (state & 1) != 0;
+            }
+        }
+
+        uint64 keep = 0;
+        uint64 tail = 0;
+        if (!readVarint(delta, keep) || keep > _freeSlots.size() || !readVarint(delta, tail) || tail > recordCount) {
+            return false;
+        }
+        _freeSlots.resize(keep);
+        for (uint64 index = 0; index != tail; ++index) {
+            uint64 free = 0;
+            if (!readVarint(delta, free) || free >= recordCount || _records[free].alive) {
+                return false;
+            }
+            _freeSlots.push_back(static_cast<uint32>(free));
+        }
+        return true;
+    }
+
+    bool EntityManager::_applyDeltaStorage(view<byte>& delta) {
+        uint64 componentId = 0;
+        view<byte> idBytes;
+        view<byte> encodingByte;
+        uint64 size = 0;
+        if (!takeBytes(delta, sizeof(componentId), idBytes) || !takeBytes(delta, 1, encodingByte) ||
+            !readVarint(delta, size)) {
+            return false;
+        }
+        std::memcpy(&componentId, idBytes.data(), sizeof(componentId));
+
+        ComponentStorage* const storage = _getComponent(ComponentId{componentId});
+        if (storage == nullptr || encodingByte[0] != static_cast<byte>(storage->encoding()) ||
+            size != storage->componentSize()) {
+            return false;
+        }
+        bool const raw = storage->encoding() == ComponentEncoding::Raw;
+
+        // added components are copied from aligned memory rather than from the delta itself
+        vector<std::max_align_t> scratch((size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
+
+        uint64 slot = 0;
+        for (;;) {
+            uint64 code = 0;
+            if (!readVarint(delta, code)) {
+                return false;
+            }
+            auto const op = static_cast<DeltaOp>(code & 3);
+            if (op == DeltaOp::End) {
+                return true;
+            }
+            if ((code >> 2) >= _records.size() - slot) {
+                return false;
+            }
+            slot += code >> 2;
+            if (!_records[slot].alive) {
+                return false;
+            }
+
+            EntityId const entityId = _makeEntityId(static_cast<uint32>(slot), _records[slot].generation);
+            uint32 location = _locationOf(entityId, *storage);
+            view<byte> bytes;
+            view<char> encoded;
+            switch (op) {
+                case DeltaOp::Add:
+                    if (location != ComponentStorage::InvalidIndex) {
+                        return false;
+                    }
+                    if (raw) {
+                        if (!takeBytes(delta, size, bytes)) {
+                            return false;
+                        }
+                        void const* source = nullptr;
+                        if (size != 0) {
+                            std::memcpy(scratch.data(), bytes.data(), bytes.size());
+                            source = scratch.data();
+                        }
+                        _addComponentRaw(entityId, storage->componentId(), source);
+                    }
+                    else {
+                        if (!takeEncoded(delta, encoded)) {
+                            return false;
+                        }
+                        _addComponentRaw(entityId, storage->componentId(), nullptr);
+                        if (!storage->decodeComponent(_locationOf(entityId, *storage), encoded)) {
+                            return false;
+                        }
+                    }
+                    break;
+                case DeltaOp::Remove:
+                    if (location == ComponentStorage::InvalidIndex) {
+                        return false;
+                    }
+                    _removeComponentAt(entityId, *storage, location);
+                    break;
+                case DeltaOp::Change:
+                    if (location == ComponentStorage::InvalidIndex) {
+                        return false;
+                    }
+                    if (raw ? !applyXorRuns(delta, static_cast<byte*>(storage->getUnsafe(location)), size)
+                            : !takeEncoded(delta, encoded) || !storage->decodeComponent(location, encoded)) {
+                        return false;
+                    }
+                    storage->markChanged(location, _changeTick);
+                    break;
+                case DeltaOp::End:
+                    break;
+            }
+        }
+    }
+
+    IOResult EntityManager::_readSnapshotStorage(
+        Stream& stream,
+        ComponentStorage& storage,
+        uint32 slotCount,
+        uint64 payloadSize) {
+        storage._entities.resize(slotCount);
+        if (IOResult const rs = readExact(stream, span<EntityId>(storage._entities).as_bytes());
+            rs != IOResult::Success) {
+            return rs;
+        }
+        storage._changeTicks.resize(slotCount, _changeTick);
+        storage.resetComponents(slotCount);
+
+        for (uint32 index = 0; index != slotCount; ++index) {
+            EntityId const entityId = storage._entities[index];
+            if (entityId == EntityId::None) {
+                if (storage._layout != ComponentLayout::Sparse) {
+                    return IOResult::Malformed;
+                }
+                storage._free.push_back(index);
+                continue;
+            }
+            if (!isAlive(entityId) || _locationOf(entityId, storage) != ComponentStorage::InvalidIndex) {
+                return IOResult::Malformed;
+            }
+            _locationOf(entityId, storage) = index;
+            ++_records[_slotOf(entityId)].componentCount;
+            ++storage._size;
+        }
+
+        if (storage.encoding() == ComponentEncoding::Raw) {
+            return readExact(stream, storage.rawComponents());
+        }
+
+        vector<char> payload(payloadSize);
+        if (IOResult const rs = readExact(stream, span<char>(payload).as_bytes()); rs != IOResult::Success) {
+            return rs;
+        }
+        view<char> remaining = payload;
+        for (uint32 index = 0; index != slotCount; ++index) {
+            uint32 length = 0;
+            if (remaining.size() < sizeof(length)) {
+                return IOResult::Malformed;
+            }
+            std::memcpy(&length, remaining.data(), sizeof(length));
+            remaining = remaining.subspan(sizeof(length));
+            if (remaining.size() < length || !storage.decodeComponent(index, remaining.first(length))) {
+                return IOResult::Malformed;
+            }
+            remaining = remaining.subspan(length);
+        }
+        return remaining.empty() ? IOResult::Success : IOResult::Malformed;
+    }
+
+    void EntityManager::_removeComponentAt(EntityId entityId, ComponentStorage& storage, uint32 location) {
+        storage.remove(location, [this, &storage](EntityId moved, uint32 index) {
+            _locationOf(moved, storage) = index;
+        });
+        _locationOf(entityId, storage) = ComponentStorage::InvalidIndex;
+        --_records[_slotOf(entityId)].componentCount;
+        _unmatchQueries(entityId, storage);
+    }
+
+    void EntityManager::_removeComponents(EntityId entityId) {
+        uint32 const slot = _slotOf(entityId);
+
+        // only storages holding one of the entity's components need visiting; observers
+        // may remove other components of the entity, so locations are re-read after each
+        // removal
+        for (size_t column = 0; column != _components.size() && _records[slot].componentCount != 0; ++column) {
+            ComponentStorage& storage = *_components[column];
+            uint32 const location = _locationOf(entityId, storage);
+            if (location != ComponentStorage::InvalidIndex) {
+                _removeComponentAt(entityId, storage, location);
+            }
+        }
+    }
+
+    void EntityManager::_releaseEntity(EntityId entityId) noexcept {
+        uint32 const slot = _slotOf(entityId);
+        EntityRecord& record = _records[slot];
+        record.alive = false;
+        // generation 0 is never handed out, so that no live EntityId equals EntityId::None
+        if (++record.generation == 0) {
+            record.generation = 1;
+        }
+        _freeSlots.push_back(slot);
+    }
+
+    void EntityManager::_matchQueries(EntityId entityId, ComponentStorage const& storage) {
+        uint32 const slot = _slotOf(entityId);
+        for (RawQuery* const query : _columnQueries[storage._column]) {
+            if (!query->_isMatched(slot) && _matchesQuery(slot, *query)) {
+                query->_addMatch(slot);
+            }
+        }
+    }
+
+    void EntityManager::_unmatchQueries(EntityId entityId, ComponentStorage const& storage) noexcept {
+        uint32 const slot = _slotOf(entityId);
+        for (RawQuery* const query : _columnQueries[storage._column]) {
+            if (query->_isMatched(slot)) {
+                query->_removeMatch(slot);
+            }
+        }
+    }
+
+    void EntityManager::_populateQuery(RawQuery& query) {
+        query._matches.clear();
+        query._matchIndex.clear();
+
+        // every match has a component in the first storage
+        ComponentStorage* const first = query._storages[0];
+        if (first == nullptr) {
+            return;
+        }
+        for (ComponentCursor cursor = first->enumerateUnsafe(); cursor.next();) {
+            uint32 const slot = _slotOf(cursor.entityId());
+            if (_matchesQuery(slot, query)) {
+                query._addMatch(slot);
+            }
+        }
+    }
+
+    void EntityManager::_clear(bool notifyObservers) {
+        // entities with observed components are removed one at a time, so that
+        // observers may make structural changes of their own, such as removing
+        // the components they derived; everything else is emptied wholesale
+        if (notifyObservers) {
+            for (uint32 slot = 0; slot != _records.size(); ++slot) {
+                if (!_records[slot].alive) {
+                    continue;
+                }
+                EntityId const entityId = _makeEntityId(slot, _records[slot].generation);
+                for (box<ComponentStorage>& storage : _components) {
+                    if (!storage->_observers.empty() &&
+                        _locationOf(entityId, *storage) != ComponentStorage::InvalidIndex) {
+                        _removeComponents(entityId);
+                        break;
+                    }
+                }
+            }
+        }
+
+        _records.clear();
+        _freeSlots.clear();
+        _locations.clear();
+        for (box<ComponentStorage>& storage : _components) {
+            storage->_entities.clear();
+            storage->_changeTicks.clear();
+            storage->_free.clear();
+            storage->_size = 0;
+            storage->resetComponents(0);
+        }
+        for (RawQuery* const query : _queries) {
+            query->_matches.clear();
+            query->_matchIndex.clear();
+        }
+    }
+
+    bool EntityManager::_matchesQuery(uint32 slot, RawQuery const& query) const noexcept {
+        size_t const columns = _components.size();
+        for (uint32 const column : query._columns) {
+            if (column == ComponentStorage::InvalidIndex ||
+                _locations[slot * columns + column] == ComponentStorage::InvalidIndex) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     ComponentStorage& EntityManager::_registerComponent(box<ComponentStorage> storage) {
         UP_ASSERT(storage != nullptr);
+        UP_ASSERT(_structureLocks == 0);
 
         ComponentId const componentId = storage->componentId();
         UP_ASSERT(!_componentMap.contains(componentId));
 
+        // widen every entity's row of locations by one column for the new storage
+        size_t const columns = _components.size();
+        if (!_records.empty()) {
+            vector<uint32> locations(_records.size() * (columns + 1), ComponentStorage::InvalidIndex);
+            for (size_t slot = 0; slot != _records.size(); ++slot) {
+                for (size_t column = 0; column != columns; ++column) {
+                    locations[slot * (columns + 1) + column] = _locations[slot * columns + column];
+                }
+            }
+            _locations = std::move(locations);
+        }
+
         ComponentStorage* const result = storage.get();
+        result->_column = static_cast<uint32>(columns);
         _components.push_back(std::move(storage));
         _componentMap.insert(componentId, result);
+
+        // queries waiting on this component type can now follow its storage; it is
+        // empty, so no Entity starts matching
+        auto& columnQueries = _columnQueries.emplace_back();
+        for (RawQuery* const query : _queries) {
+            for (size_t index = 0; index != query->_componentIds.size(); ++index) {
+                if (query->_componentIds[index] == componentId) {
+                    query->_storages[index] = result;
+                    query->_columns[index] = result->_column;
+                    columnQueries.push_back(query);
+                }
+            }
+        }
         return *result;
     }
 
     void* EntityManager::_addComponentRaw(EntityId entityId, ComponentId componentId, void const* source) {
-        UP_GUARD(_entities.contains(entityId), nullptr);
+        UP_ASSERT(_structureLocks == 0);
+        UP_GUARD(isAlive(entityId), nullptr);
         ComponentStorage* const component = _getComponent(componentId);
         UP_GUARD(component != nullptr, nullptr);
-        return component->add(entityId, source);
+
+        uint32& location = _locationOf(entityId, *component);
+        if (location != ComponentStorage::InvalidIndex) {
+            return component->getUnsafe(location);
+        }
+        ++_records[_slotOf(entityId)].componentCount;
+        void* const data = component->add(entityId, source, _changeTick, location);
+        _matchQueries(entityId, *component);
+        return data;
     }
 
     ComponentStorage* EntityManager::_getComponent(ComponentId componentId) noexcept {
@@ -78,4 +1109,56 @@ namespace up {
         return rs ? rs->value : nullptr;
     }
 
+    void* EntityManager::_getMutUnsafe(EntityId entityId, ComponentId componentId) noexcept {
+        ComponentStorage* const component = _getComponent(componentId);
+        if (component == nullptr || !isAlive(entityId)) {
+            return nullptr;
+        }
+
+        uint32 const location = _locationOf(entityId, *component);
+        if (location == ComponentStorage::InvalidIndex) {
+            return nullptr;
+        }
+
+        component->markChanged(location, _changeTick);
+        return component->getUnsafe(location);
+    }
+
+    void EntityManager::_parallelFor(
+        TaskQueue* queue,
+        uint32 count,
+        uint32 minBatch,
+        delegate_ref<void(uint32 first, uint32 last)> process) {
+        if (count == 0) {
+            return;
+        }
+
+        ++_structureLocks;
+
+        // aim for a few batches per hardware thread so that uneven batches balance
+        // out, but never split the work finer than the caller allows
+        uint32 const threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        uint32 const batchTarget = (count + threadCount * 4 - 1) / (threadCount * 4);
+        uint32 const batchSize = std::max({batchTarget, minBatch, 1u});
+
+        if (queue == nullptr || batchSize >= count) {
+            process(0, count);
+        }
+        else {
+            auto state = new_shared<ParallelRangeState>(count, batchSize, process);
+
+            uint32 const helperCount = std::min(state->batchCount, threadCount) - 1;
+            for (uint32 helper = 0; helper != helperCount; ++helper) {
+                if (!queue->tryEnque([state] { state->run(); })) {
+                    break;
+                }
+            }
+
+            state->run();
+            state->wait();
+        }
+
+        --_structureLocks;
+    }
+
 } // namespace up
@@ -0,0 +1,43 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/game/query.h"
+
+namespace up {
+    RawQuery::RawQuery(span<ComponentId const> componentIds)
+        : _componentIds(componentIds)
+        , _storages(componentIds.size(), nullptr)
+        , _columns(componentIds.size(), ComponentStorage::InvalidIndex) { }
+
+    RawQuery::~RawQuery() {
+        if (_entities != nullptr) {
+            _entities->unregisterQuery(*this);
+        }
+    }
+
+    void RawQuery::_addMatch(uint32 slot) {
+        if (slot >= _matchIndex.size()) {
+            _matchIndex.resize(slot + 1, noMatch);
+        }
+        _matchIndex[slot] = static_cast<uint32>(_matches.size());
+        _matches.push_back(slot);
+    }
+
+    void RawQuery::_removeMatch(uint32 slot) noexcept {
+        uint32 const index = _matchIndex[slot];
+        uint32 const last = _matches.back();
+        _matches[index] = last;
+        _matchIndex[last] = index;
+        _matches.pop_back();
+        _matchIndex[slot] = noMatch;
+    }
+
+    void RawQuery::_reset() noexcept {
+        _entities = nullptr;
+        for (size_t index = 0; index != _storages.size(); ++index) {
+            _storages[index] = nullptr;
+            _columns[index] = ComponentStorage::InvalidIndex;
+        }
+        _matches.clear();
+        _matchIndex.clear();
+    }
+} // namespace up
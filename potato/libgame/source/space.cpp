@@ -2,6 +2,9 @@
 
 #include "potato/game/space.h"
 
+#include <chrono>
+#include <cmath>
+
 namespace up {
     extern void registerCameraSystem(Space& space);
     extern void registerDemoSystem(Space& space, AudioEngine& audioEngine);
@@ -23,6 +26,8 @@ namespace up {
         UP_GUARD_VOID(_state == State::New);
         _state = State::Starting;
 
+        _systemUpdateSeconds.resize(_systems.size(), 0.0);
+
         for (auto& system : _systems) {
             system->start();
         }
@@ -42,11 +47,74 @@ namespace up {
 
     void Space::update(float deltaTime) {
         UP_GUARD_VOID(_state == State::Started);
-        for (auto& system : _systems) {
+
+        _interpolationAlpha = 1.f;
+
+        // a direct update is a whole frame
+        _frameArena.flip();
+        _tick(deltaTime);
+    }
+
+    void Space::_tick(float deltaTime) {
+        // commands recorded since the last tick
+        _entities.playback(_commands);
+
+        for (size_t index = 0; index != _systems.size(); ++index) {
+            auto& system = _systems[index];
+            std::chrono::steady_clock::time_point startTime;
+            if (_profiling) {
+                startTime = std::chrono::steady_clock::now();
+            }
+
             system->update(deltaTime);
+            _entities.playback(_commands);
+
+            if (_profiling) {
+                std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - startTime;
+                _systemUpdateSeconds[index] = elapsed.count();
+            }
+
+            // changes made by later systems, or between frames, are newer than
+            // anything this system has seen
+            system->m_lastUpdateTick = _entities.changeTick();
+            _entities.advanceChangeTick();
         }
     }
 
+    uint32 Space::advance(float frameTime) {
+        UP_GUARD(_state == State::Started, 0);
+
+        _accumulator += frameTime;
+
+        // the ticks of one frame share it, so that frame data outlives the next
+        // frame however many ticks either of them runs
+        _frameArena.flip();
+
+        uint32 ticks = 0;
+        while (_accumulator >= _tickDuration && ticks != _maxCatchUpTicks) {
+            _tick(_tickDuration);
+            _accumulator -= _tickDuration;
+            ++ticks;
+        }
+
+        // whole ticks that didn't fit in the budget are dropped
+        if (_accumulator >= _tickDuration) {
+            _accumulator = std::fmod(_accumulator, _tickDuration);
+        }
+
+        _interpolationAlpha = _accumulator / _tickDuration;
+        return ticks;
+    }
+
+    void Space::setTickRate(float ticksPerSecond, uint32 maxCatchUpTicks) {
+        UP_GUARD_VOID(ticksPerSecond > 0.f);
+        UP_GUARD_VOID(maxCatchUpTicks != 0);
+
+        _tickDuration = 1.f / ticksPerSecond;
+        _maxCatchUpTicks = maxCatchUpTicks;
+        _accumulator = 0.f;
+    }
+
     void Space::render(RenderContext& ctx) {
         UP_GUARD_VOID(_state == State::Started);
         for (auto& system : _systems) {
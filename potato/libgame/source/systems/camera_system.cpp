@@ -3,6 +3,7 @@
 #include "potato/game/components/camera_controllers.h"
 #include "potato/game/components/transform_component.h"
 #include "potato/game/entity_manager.h"
+#include "potato/game/query.h"
 #include "potato/game/space.h"
 #include "potato/game/system.h"
 
@@ -16,15 +17,21 @@ namespace up {
         public:
             using System::System;
 
+            void start() override { space().entities().registerQuery(_cameras); }
+            void stop() override { space().entities().unregisterQuery(_cameras); }
             void update(float) override;
+            zstring_view name() const noexcept override { return "camera"_zsv; }
+
+        private:
+            Query<TransformComponent, FlyCameraComponent> _cameras;
         };
     } // namespace
 
     void registerCameraSystem(Space& space) { space.addSystem<CameraSystem>(); }
 
     void CameraSystem::update(float frameTime) {
-        space().entities().select<TransformComponent, FlyCameraComponent>(
-            [frameTime](EntityId, TransformComponent& transform, FlyCameraComponent& flyCam) {
+        _cameras.select(
+            [this, frameTime](EntityId entityId, TransformComponent& transform, FlyCameraComponent& flyCam) {
                 // apply movement to transform
                 glm::vec3 moveScale = glm::vec3{1, 1, -1} * flyCam.moveMetersPerSec * frameTime;
                 transform.position += glm::rotate(transform.rotation, flyCam.relativeMovement * moveScale);
@@ -41,6 +48,7 @@ namespace up {
                     -glm::half_pi<float>(),
                     glm::half_pi<float>());
                 transform.rotation = glm::quat({flyCam.pitch, flyCam.yaw, 0});
+                space().entities().markChanged<TransformComponent>(entityId);
 
                 // update movement speed from wheel
                 flyCam.moveMetersPerSec = glm::clamp(flyCam.moveMetersPerSec + flyCam.relativeMotion.z, 0.1f, 200.f);
@@ -16,6 +16,7 @@ namespace up {
             DemoSystem(Space& space, AudioEngine& audioEngine);
 
             void update(float) override;
+            zstring_view name() const noexcept override { return "demo"_zsv; }
 
         private:
             AudioEngine& _audioEngine;
@@ -27,20 +28,26 @@ namespace up {
     DemoSystem::DemoSystem(Space& space, AudioEngine& audioEngine) : System(space), _audioEngine(audioEngine) { }
 
     void DemoSystem::update(float deltaTime) {
-        space().entities().select<TransformComponent, DemoWaveComponent>(
-            [&](EntityId, TransformComponent& trans, DemoWaveComponent& wave) {
+        space().entities().parallelSelect<TransformComponent, DemoWaveComponent>(
+            space().taskQueue(),
+            [&](EntityId entityId, TransformComponent& trans, DemoWaveComponent& wave) {
                 wave.offset += deltaTime * .2f;
                 trans.position.y = 1 + 5 * glm::sin(wave.offset * 10);
+                space().entities().markChanged<TransformComponent>(entityId);
             });
 
-        space().entities().select<TransformComponent, DemoWaveComponent>(
-            [&](EntityId, TransformComponent& trans, DemoWaveComponent&) {
+        space().entities().parallelSelect<TransformComponent, DemoWaveComponent>(
+            space().taskQueue(),
+            [&](EntityId entityId, TransformComponent& trans, DemoWaveComponent&) {
                 trans.position = glm::rotateY(trans.position, deltaTime);
+                space().entities().markChanged<TransformComponent>(entityId);
             });
 
-        space().entities().select<TransformComponent, DemoSpinComponent const>(
-            [&](EntityId, TransformComponent& trans, DemoSpinComponent const& spin) {
+        space().entities().parallelSelect<TransformComponent, DemoSpinComponent const>(
+            space().taskQueue(),
+            [&](EntityId entityId, TransformComponent& trans, DemoSpinComponent const& spin) {
                 trans.rotation = glm::angleAxis(spin.radians * deltaTime, glm::vec3(0.f, 1.f, 0.f)) * trans.rotation;
+                space().entities().markChanged<TransformComponent>(entityId);
             });
 
         space().entities().select<DemoDingComponent>([&, this](EntityId, DemoDingComponent& ding) {
@@ -22,7 +22,6 @@ namespace up {
             btSequentialImpulseConstraintSolver solver;
             btDiscreteDynamicsWorld world;
             btRigidBody* ground = nullptr;
-            float tickRate = 1.f / 60.f;
         };
 
         class RigidBodyObserver final : public ComponentObserver<RigidBodyComponent> {
@@ -46,6 +45,7 @@ namespace up {
             explicit PhysicsSystem(Space& space) : System(space), _bodyObserver(space.entities(), _world) { }
 
             void update(float) override;
+            zstring_view name() const noexcept override { return "physics"_zsv; }
             void start() override;
             void stop() override;
 
@@ -78,12 +78,14 @@ namespace up {
     }
 
     void PhysicsSystem::update(float deltaTime) {
-        _world.world.stepSimulation(deltaTime, 12, _world.tickRate);
+        // Space::advance provides fixed ticks, so each update is exactly one step;
+        // letting Bullet substep to catch up would only compound slow frames
+        _world.world.stepSimulation(deltaTime, 1, deltaTime);
 
         // Apply physics motion to transforms
         //  TODO: be smarter/faster about this (btMotionState?)
         space().entities().select<TransformComponent, RigidBodyComponent, BulletBody const>(
-            [&](EntityId, TransformComponent& trans, RigidBodyComponent& body, BulletBody const& bulletBody) {
+            [&](EntityId entityId, TransformComponent& trans, RigidBodyComponent& body, BulletBody const& bulletBody) {
                 UP_GUARD_VOID(bulletBody.body != nullptr);
 
                 btTransform const& worldTrans = bulletBody.body->getWorldTransform();
@@ -92,6 +94,7 @@ namespace up {
 
                 btQuaternion const& rot = worldTrans.getRotation();
                 trans.rotation = {rot.x(), rot.y(), rot.z(), rot.w()};
+                space().entities().markChanged<TransformComponent>(entityId);
             });
     }
 
@@ -100,7 +103,8 @@ namespace up {
         _world.ground = new btRigidBody(0.f, nullptr, &groundPlane);
         _world.world.addRigidBody(_world.ground);
 
-        space().entities().registerComponent<BulletBody>();
+        // bodies are recreated by the observer, so they never appear in snapshots or deltas
+        space().entities().registerComponent<BulletBody>(ComponentLayout::Packed, ComponentPersistence::Transient);
         space().entities().observe(_bodyObserver);
 
         space().entities().select<RigidBodyComponent>([&](EntityId entityId, RigidBodyComponent& body) {
@@ -4,6 +4,7 @@
 #include "potato/game/components/mesh_component.h"
 #include "potato/game/components/transform_component.h"
 #include "potato/game/entity_manager.h"
+#include "potato/game/query.h"
 #include "potato/game/space.h"
 #include "potato/game/system.h"
 #include "potato/render/context.h"
@@ -14,26 +15,51 @@ namespace up {
         public:
             using System::System;
 
+            void start() override;
+            void stop() override;
             void update(float deltaTime) override;
+            zstring_view name() const noexcept override { return "render"_zsv; }
             void render(RenderContext& ctx) override;
+
+        private:
+            Query<CameraComponent, TransformComponent const> _cameras;
+            Query<MeshComponent, TransformComponent const> _meshes;
         };
     } // namespace
 
     void registerRenderSystem(Space& space) { space.addSystem<RenderSystem>(); }
 
+    void RenderSystem::start() {
+        space().entities().registerQuery(_cameras);
+        space().entities().registerQuery(_meshes);
+    }
+
+    void RenderSystem::stop() {
+        space().entities().unregisterQuery(_meshes);
+        space().entities().unregisterQuery(_cameras);
+    }
+
     void RenderSystem::update(float) { }
 
     void RenderSystem::render(RenderContext& ctx) {
-        space().entities().select<CameraComponent, TransformComponent const>(
-            [&](EntityId, CameraComponent& camera, TransformComponent const& trans) {
-                ctx.applyCameraPerspective(trans.position, trans.forward(), trans.up());
-            });
-
-        space().entities().select<MeshComponent, TransformComponent const>(
-            [&](EntityId, MeshComponent& mesh, TransformComponent const& trans) {
-                if (mesh.mesh.ready() && mesh.material.ready()) {
-                    mesh.mesh.asset()->render(ctx, mesh.material.asset(), trans.matrix);
-                }
-            });
+        // everything is drawn between the last two ticks when the space runs ahead of them;
+        // the camera is blended the same way, or it would judder against the meshes
+        float const alpha = space().interpolationAlpha();
+        _cameras.select([&](EntityId, CameraComponent& camera, TransformComponent const& trans) {
+            glm::mat4x4 const matrix = alpha < 1.f ? trans.interpolatedMatrix(alpha) : trans.matrix;
+            ctx.applyCameraPerspective(
+                glm::vec3{matrix[3]},
+                glm::normalize(glm::vec3{matrix * glm::vec4{0.f, 0.f, -1.f, 0.f}}),
+                glm::normalize(glm::vec3{matrix * glm::vec4{0.f, 1.f, 0.f, 0.f}}));
+        });
+
+        _meshes.select([&](EntityId, MeshComponent& mesh, TransformComponent const& trans) {
+            if (mesh.mesh.ready() && mesh.material.ready()) {
+                mesh.mesh.asset()->render(
+                    ctx,
+                    mesh.material.asset(),
+                    alpha < 1.f ? trans.interpolatedMatrix(alpha) : trans.matrix);
+            }
+        });
     }
 } // namespace up
@@ -1,27 +1,291 @@
 // Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
 
+#include "potato/game/components/parent_component.h"
 #include "potato/game/components/transform_component.h"
 #include "potato/game/entity_manager.h"
 #include "potato/game/space.h"
 #include "potato/game/system.h"
+#include "potato/game/transform_batch.h"
+#include "potato/spud/arena.h"
+#include "potato/spud/hash_map.h"
+#include "potato/spud/hash_set.h"
+#include "potato/spud/sort.h"
+#include "potato/spud/vector.h"
 
-#include <glm/gtx/rotate_vector.hpp>
+#include <algorithm>
 
 namespace up {
     namespace {
+        class TransformSystem;
+
+        /// Flags the hierarchy for a rebuild when Entities are attached, detached or destroyed.
+        class ParentObserver final : public ComponentObserver<ParentComponent> {
+        public:
+            explicit ParentObserver(TransformSystem& system) noexcept : _system(system) { }
+
+            void onAdd(EntityId, ParentComponent&) override;
+            void onRemove(EntityId, ParentComponent&) override;
+
+        private:
+            TransformSystem& _system;
+        };
+
+        class TransformObserver final : public ComponentObserver<TransformComponent> {
+        public:
+            explicit TransformObserver(TransformSystem& system) noexcept : _system(system) { }
+
+            void onAdd(EntityId entityId, TransformComponent&) override;
+            void onRemove(EntityId entityId, TransformComponent&) override;
+
+        private:
+            TransformSystem& _system;
+        };
+
+        /// Computes local-to-world matrices for every TransformComponent.
+        ///
+        /// Entities linked by a ParentComponent are kept in a cached pre-order
+        /// walk of the hierarchy, so every parent precedes its children and each
+        /// subtree is a contiguous range. Only the subtrees below transforms that
+        /// changed since the last update are recomputed.
+        ///
+        /// The matrices recomputed by one update become the previous matrices at
+        /// the next, so every previousMatrix trails its matrix by one tick.
         class TransformSystem final : public System {
         public:
             using System::System;
 
+            void start() override;
+            void stop() override;
             void update(float) override;
+            zstring_view name() const noexcept override { return "transform"_zsv; }
+
+            void invalidateHierarchy() noexcept { _hierarchyDirty = true; }
+            void transformAdded(EntityId entityId) { _added.push_back(entityId); }
+            bool inHierarchy(EntityId entityId) const noexcept { return _orderIndex.contains(entityId); }
+
+        private:
+            static constexpr uint32 noParent = ~uint32{0};
+
+            struct Node {
+                EntityId entity = EntityId::None;
+                uint32 parentIndex = noParent;
+                /// One past the last node of this node's subtree.
+                uint32 subtreeEnd = 0;
+            };
+
+            void _rebuildHierarchy();
+            void _updateSubtrees(uint32 first, uint32 last);
+
+            vector<Node> _order;
+            hash_map<EntityId, uint32> _orderIndex;
+            /// Entities whose matrix was recomputed by the last update.
+            vector<EntityId> _moved;
+            /// Entities given a transform since the last update, which have no
+            /// previous matrix to interpolate from.
+            vector<EntityId> _added;
+            ParentObserver _parentObserver{*this};
+            TransformObserver _transformObserver{*this};
+            bool _hierarchyDirty = true;
         };
+
+        glm::mat4x4 localMatrix(TransformComponent const& trans) noexcept {
+            return composeMatrix(trans.position, trans.rotation, glm::vec3(trans.scale));
+        }
     } // namespace
 
     void registerTransformSystem(Space& space) { space.addSystem<TransformSystem>(); }
 
+    void ParentObserver::onAdd(EntityId, ParentComponent&) { _system.invalidateHierarchy(); }
+
+    void ParentObserver::onRemove(EntityId, ParentComponent&) { _system.invalidateHierarchy(); }
+
+    void TransformObserver::onAdd(EntityId entityId, TransformComponent&) {
+        _system.transformAdded(entityId);
+        if (_system.inHierarchy(entityId)) {
+            _system.invalidateHierarchy();
+        }
+    }
+
+    void TransformObserver::onRemove(EntityId entityId, TransformComponent&) {
+        if (_system.inHierarchy(entityId)) {
+            _system.invalidateHierarchy();
+        }
+    }
+
+    void TransformSystem::start() {
+        space().entities().observe(_parentObserver);
+        space().entities().observe(_transformObserver);
+
+        space().entities().select<TransformComponent>([this](EntityId entityId, TransformComponent&) {
+            _added.push_back(entityId);
+        });
+    }
+
+    void TransformSystem::stop() {
+        space().entities().unobserve(_transformObserver);
+        space().entities().unobserve(_parentObserver);
+    }
+
     void TransformSystem::update(float) {
-        space().entities().select<TransformComponent>([&](EntityId, TransformComponent& trans) {
-            trans.matrix = glm::translate(trans.position) * glm::mat4_cast(trans.rotation);
+        EntityManager& entities = space().entities();
+
+        // transforms that stopped changing catch up with their previous matrix
+        for (EntityId const entityId : _moved) {
+            if (auto* const trans = entities.getComponentSlow<TransformComponent>(entityId); trans != nullptr) {
+                trans->previousMatrix = trans->matrix;
+            }
+        }
+        _moved.clear();
+
+        // re-parenting through getMut changes the shape of the hierarchy
+        entities.selectChanged<ParentComponent>(lastUpdateTick(), [this](EntityId, ParentComponent&) {
+            _hierarchyDirty = true;
         });
+
+        bool const rebuilt = _hierarchyDirty;
+        if (_hierarchyDirty) {
+            _rebuildHierarchy();
+        }
+
+        // changed transforms outside of any hierarchy only need their local
+        // matrix, which is computed for all of them in one batch; changed
+        // hierarchy nodes are finished below
+        scratch_scope scratch;
+        vector<uint32> dirty(scratch.resource());
+        vector<TransformComponent*> independent(scratch.resource());
+        entities.selectChanged<TransformComponent>(
+            lastUpdateTick(),
+            [&, this](EntityId entityId, TransformComponent& trans) {
+                if (auto const index = _orderIndex.find(entityId); index) {
+                    dirty.push_back(index->value);
+                }
+                else {
+                    independent.push_back(&trans);
+                    _moved.push_back(entityId);
+                }
+            });
+        composeLocalMatrices(independent);
+
+        if (rebuilt) {
+            _updateSubtrees(0, static_cast<uint32>(_order.size()));
+        }
+        else {
+            // nodes are visited in hierarchy order, so a subtree nested inside one
+            // that was already updated is skipped
+            sort(dirty);
+            uint32 updatedEnd = 0;
+            for (uint32 const index : dirty) {
+                if (index >= updatedEnd) {
+                    updatedEnd = _order[index].subtreeEnd;
+                    _updateSubtrees(index, updatedEnd);
+                }
+            }
+        }
+
+        // new transforms start out at rest rather than moving in from the origin
+        for (EntityId const entityId : _added) {
+            if (auto* const trans = entities.getComponentSlow<TransformComponent>(entityId); trans != nullptr) {
+                trans->previousMatrix = trans->matrix;
+            }
+        }
+        _added.clear();
+    }
+
+    void TransformSystem::_updateSubtrees(uint32 first, uint32 last) {
+        EntityManager& entities = space().entities();
+
+        for (uint32 index = first; index != last; ++index) {
+            Node const& node = _order[index];
+            auto* const trans = entities.getComponentSlow<TransformComponent>(node.entity);
+            if (trans == nullptr) {
+                continue;
+            }
+
+            // an ancestor without a transform contributes nothing to its children
+            auto const* const parent = node.parentIndex != noParent
+                ? entities.getComponentSlow<TransformComponent>(_order[node.parentIndex].entity)
+                : nullptr;
+            trans->matrix = parent != nullptr ? parent->matrix * localMatrix(*trans) : localMatrix(*trans);
+            _moved.push_back(node.entity);
+        }
+    }
+
+    void TransformSystem::_rebuildHierarchy() {
+        EntityManager& entities = space().entities();
+
+        _hierarchyDirty = false;
+        vector<Node> previous = std::move(_order);
+        _order.clear();
+        _orderIndex.clear();
+
+        struct Link {
+            EntityId parent = EntityId::None;
+            EntityId child = EntityId::None;
+        };
+
+        scratch_scope scratch;
+        vector<Link> links(scratch.resource());
+        hash_set<EntityId> children(scratch.resource());
+        entities.select<ParentComponent>([&](EntityId entityId, ParentComponent& parent) {
+            if (parent.parent != entityId && entities.isAlive(parent.parent)) {
+                links.push_back({parent.parent, entityId});
+                children.insert(entityId);
+            }
+        });
+
+        // group each parent's children together
+        sort(links, {}, &Link::parent);
+
+        vector<Node> stack(scratch.resource());
+        for (Link const& root : links) {
+            if (children.contains(root.parent) || _orderIndex.contains(root.parent)) {
+                continue;
+            }
+
+            stack.push_back({.entity = root.parent});
+            while (!stack.empty()) {
+                Node node = stack.back();
+                stack.pop_back();
+
+                // guards against an Entity reachable through more than one path
+                if (_orderIndex.contains(node.entity)) {
+                    continue;
+                }
+
+                auto const index = static_cast<uint32>(_order.size());
+                node.subtreeEnd = index + 1;
+                _order.push_back(node);
+                _orderIndex.insert(node.entity, index);
+
+                auto const first = std::lower_bound(
+                    links.begin(),
+                    links.end(),
+                    node.entity,
+                    [](Link const& link, EntityId parent) { return link.parent < parent; });
+                for (auto it = first; it != links.end() && it->parent == node.entity; ++it) {
+                    stack.push_back({.entity = it->child, .parentIndex = index});
+                }
+            }
+        }
+
+        // children follow their parents, so subtree extents accumulate backwards
+        for (auto index = _order.size(); index != 0; --index) {
+            Node const& node = _order[index - 1];
+            if (node.parentIndex != noParent) {
+                Node& parent = _order[node.parentIndex];
+                parent.subtreeEnd = std::max(parent.subtreeEnd, node.subtreeEnd);
+            }
+        }
+
+        // Entities detached from the hierarchy, such as the children of a
+        // destroyed parent, fall back to their local transform
+        for (Node const& node : previous) {
+            if (!_orderIndex.contains(node.entity)) {
+                if (auto* const trans = entities.getComponentSlow<TransformComponent>(node.entity); trans != nullptr) {
+                    trans->matrix = localMatrix(*trans);
+                    _moved.push_back(node.entity);
+                }
+            }
+        }
     }
 } // namespace up
@@ -0,0 +1,293 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/game/transform_batch.h"
+#include "potato/game/components/transform_component.h"
+#include "potato/runtime/assertion.h"
+
+#if UP_ARCH_INTEL
+#    include <emmintrin.h>
+#    if defined(__AVX__)
+#        include <immintrin.h>
+#    endif
+#endif
+
+namespace up {
+    namespace {
+        struct TransformInput {
+            glm::vec3 position;
+            glm::quat rotation;
+            glm::vec3 scale;
+        };
+
+        /// Inputs of a block of transforms, one lane per transform.
+        template <typename Float>
+        struct TransformLanes {
+            Float px, py, pz;
+            Float qx, qy, qz, qw;
+            Float sx, sy, sz;
+        };
+
+        /// Upper three rows of a block of composed matrices, indexed by [column][row].
+        /// The bottom row is always (0, 0, 0, 1).
+        template <typename Float>
+        struct MatrixLanes {
+            Float m[4][3];
+        };
+
+        /// The expansion of glm::mat3_cast, with each rotation column multiplied
+        /// by the matching scale and the translation as the last column.
+        template <typename Float>
+        MatrixLanes<Float> composeLanes(TransformLanes<Float> const& in) noexcept {
+            Float const one(1.f);
+            Float const two(2.f);
+
+            Float const qxx = in.qx * in.qx;
+            Float const qyy = in.qy * in.qy;
+            Float const qzz = in.qz * in.qz;
+            Float const qxz = in.qx * in.qz;
+            Float const qxy = in.qx * in.qy;
+            Float const qyz = in.qy * in.qz;
+            Float const qwx = in.qw * in.qx;
+            Float const qwy = in.qw * in.qy;
+            Float const qwz = in.qw * in.qz;
+
+            MatrixLanes<Float> out;
+            out.m[0][0] = (one - two * (qyy + qzz)) * in.sx;
+            out.m[0][1] = two * (qxy + qwz) * in.sx;
+            out.m[0][2] = two * (qxz - qwy) * in.sx;
+            out.m[1][0] = two * (qxy - qwz) * in.sy;
+            out.m[1][1] = (one - two * (qxx + qzz)) * in.sy;
+            out.m[1][2] = two * (qyz + qwx) * in.sy;
+            out.m[2][0] = two * (qxz + qwy) * in.sz;
+            out.m[2][1] = two * (qyz - qwx) * in.sz;
+            out.m[2][2] = (one - two * (qxx + qyy)) * in.sz;
+            out.m[3][0] = in.px;
+            out.m[3][1] = in.py;
+            out.m[3][2] = in.pz;
+            return out;
+        }
+
+        template <typename Float>
+        struct Lanes;
+
+        template <>
+        struct Lanes<float> {
+            static constexpr size_t width = 1;
+
+            static float load(float const* values) noexcept { return *values; }
+
+            static void store(MatrixLanes<float> const& lanes, float* const* targets) noexcept {
+                float* const target = targets[0];
+                for (int column = 0; column != 4; ++column) {
+                    target[column * 4 + 0] = lanes.m[column][0];
+                    target[column * 4 + 1] = lanes.m[column][1];
+                    target[column * 4 + 2] = lanes.m[column][2];
+                    target[column * 4 + 3] = column == 3 ? 1.f : 0.f;
+                }
+            }
+        };
+
+#if UP_ARCH_INTEL
+        /// Stores column `column` of four matrices, given as one register per row.
+        void storeColumns(__m128 x, __m128 y, __m128 z, __m128 w, float* const* targets, int column) noexcept {
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(targets[0] + column * 4, x);
+            _mm_storeu_ps(targets[1] + column * 4, y);
+            _mm_storeu_ps(targets[2] + column * 4, z);
+            _mm_storeu_ps(targets[3] + column * 4, w);
+        }
+
+        struct F32x4 {
+            F32x4() = default;
+            /*implicit*/ F32x4(float value) noexcept : v(_mm_set1_ps(value)) { }
+            explicit F32x4(__m128 value) noexcept : v(value) { }
+
+            friend F32x4 operator+(F32x4 lhs, F32x4 rhs) noexcept { return F32x4{_mm_add_ps(lhs.v, rhs.v)}; }
+            friend F32x4 operator-(F32x4 lhs, F32x4 rhs) noexcept { return F32x4{_mm_sub_ps(lhs.v, rhs.v)}; }
+            friend F32x4 operator*(F32x4 lhs, F32x4 rhs) noexcept { return F32x4{_mm_mul_ps(lhs.v, rhs.v)}; }
+
+            __m128 v;
+        };
+
+        template <>
+        struct Lanes<F32x4> {
+            static constexpr size_t width = 4;
+
+            static F32x4 load(float const* values) noexcept { return F32x4{_mm_load_ps(values)}; }
+
+            static void store(MatrixLanes<F32x4> const& lanes, float* const* targets) noexcept {
+                __m128 const zero = _mm_setzero_ps();
+                for (int column = 0; column != 4; ++column) {
+                    storeColumns(
+                        lanes.m[column][0].v,
+                        lanes.m[column][1].v,
+                        lanes.m[column][2].v,
+                        column == 3 ? _mm_set1_ps(1.f) : zero,
+                        targets,
+                        column);
+                }
+            }
+        };
+#endif
+
+#if UP_ARCH_INTEL && defined(__AVX__)
+        struct F32x8 {
+            F32x8() = default;
+            /*implicit*/ F32x8(float value) noexcept : v(_mm256_set1_ps(value)) { }
+            explicit F32x8(__m256 value) noexcept : v(value) { }
+
+            friend F32x8 operator+(F32x8 lhs, F32x8 rhs) noexcept { return F32x8{_mm256_add_ps(lhs.v, rhs.v)}; }
+            friend F32x8 operator-(F32x8 lhs, F32x8 rhs) noexcept { return F32x8{_mm256_sub_ps(lhs.v, rhs.v)}; }
+            friend F32x8 operator*(F32x8 lhs, F32x8 rhs) noexcept { return F32x8{_mm256_mul_ps(lhs.v, rhs.v)}; }
+
+            __m256 v;
+        };
+
+        template <>
+        struct Lanes<F32x8> {
+            static constexpr size_t width = 8;
+
+            static F32x8 load(float const* values) noexcept { return F32x8{_mm256_load_ps(values)}; }
+
+            static void store(MatrixLanes<F32x8> const& lanes, float* const* targets) noexcept {
+                __m128 const zero = _mm_setzero_ps();
+                for (int column = 0; column != 4; ++column) {
+                    __m128 const w = column == 3 ? _mm_set1_ps(1.f) : zero;
+                    __m256 const x = lanes.m[column][0].v;
+                    __m256 const y = lanes.m[column][1].v;
+                    __m256 const z = lanes.m[column][2].v;
+
+                    storeColumns(
+                        _mm256_castps256_ps128(x),
+                        _mm256_castps256_ps128(y),
+                        _mm256_castps256_ps128(z),
+                        w,
+                        targets,
+                        column);
+                    storeColumns(
+                        _mm256_extractf128_ps(x, 1),
+                        _mm256_extractf128_ps(y, 1),
+                        _mm256_extractf128_ps(z, 1),
+                        w,
+                        targets + 4,
+                        column);
+                }
+            }
+        };
+
+        using BatchFloat = F32x8;
+#elif UP_ARCH_INTEL
+        using BatchFloat = F32x4;
+#else
+        using BatchFloat = float;
+#endif
+
+        /// Composes count matrices, Lanes<Float>::width at a time.
+        ///
+        /// Inputs are gathered into one array per scalar so that each
+        /// component fills a register with a single load; the trailing
+        /// transforms that do not fill a block are composed one at a time.
+        template <typename Float, typename SourceT, typename TargetT>
+        void composeBlocks(size_t count, SourceT const& source, TargetT const& target) noexcept {
+            constexpr size_t width = Lanes<Float>::width;
+
+            size_t index = 0;
+            for (; index + width <= count; index += width) {
+                alignas(32) float gathered[10][width];
+                float* targets[width];
+                for (size_t lane = 0; lane != width; ++lane) {
+                    TransformInput const in = source(index + lane);
+                    gathered[0][lane] = in.position.x;
+                    gathered[1][lane] = in.position.y;
+                    gathered[2][lane] = in.position.z;
+                    gathered[3][lane] = in.rotation.x;
+                    gathered[4][lane] = in.rotation.y;
+                    gathered[5][lane] = in.rotation.z;
+                    gathered[6][lane] = in.rotation.w;
+                    gathered[7][lane] = in.scale.x;
+                    gathered[8][lane] = in.scale.y;
+                    gathered[9][lane] = in.scale.z;
+                    targets[lane] = &target(index + lane)[0][0];
+                }
+
+                TransformLanes<Float> const lanes{
+                    .px = Lanes<Float>::load(gathered[0]),
+                    .py = Lanes<Float>::load(gathered[1]),
+                    .pz = Lanes<Float>::load(gathered[2]),
+                    .qx = Lanes<Float>::load(gathered[3]),
+                    .qy = Lanes<Float>::load(gathered[4]),
+                    .qz = Lanes<Float>::load(gathered[5]),
+                    .qw = Lanes<Float>::load(gathered[6]),
+                    .sx = Lanes<Float>::load(gathered[7]),
+                    .sy = Lanes<Float>::load(gathered[8]),
+                    .sz = Lanes<Float>::load(gathered[9])};
+                Lanes<Float>::store(composeLanes(lanes), targets);
+            }
+
+            for (; index != count; ++index) {
+                TransformInput const in = source(index);
+                target(index) = composeMatrix(in.position, in.rotation, in.scale);
+            }
+        }
+    } // namespace
+
+    glm::mat4x4 UP_VECTORCALL composeMatrix(glm::vec3 position, glm::quat rotation, glm::vec3 scale) noexcept {
+        TransformLanes<float> const lanes{
+            .px = position.x,
+            .py = position.y,
+            .pz = position.z,
+            .qx = rotation.x,
+            .qy = rotation.y,
+            .qz = rotation.z,
+            .qw = rotation.w,
+            .sx = scale.x,
+            .sy = scale.y,
+            .sz = scale.z};
+
+        glm::mat4x4 result;
+        float* const target = &result[0][0];
+        Lanes<float>::store(composeLanes(lanes), &target);
+        return result;
+    }
+
+    void composeMatrices(
+        span<glm::vec3 const> positions,
+        span<glm::quat const> rotations,
+        span<glm::vec3 const> scales,
+        span<glm::mat4x4> matrices) noexcept {
+        UP_ASSERT(positions.size() == matrices.size());
+        UP_ASSERT(rotations.size() == matrices.size());
+        UP_ASSERT(scales.size() == matrices.size());
+
+        composeBlocks<BatchFloat>(
+            matrices.size(),
+            [&](size_t index) {
+                return TransformInput{positions[index], rotations[index], scales[index]};
+            },
+            [&](size_t index) -> glm::mat4x4& { return matrices[index]; });
+    }
+
+    void composeMatricesScalar(
+        span<glm::vec3 const> positions,
+        span<glm::quat const> rotations,
+        span<glm::vec3 const> scales,
+        span<glm::mat4x4> matrices) noexcept {
+        UP_ASSERT(positions.size() == matrices.size());
+        UP_ASSERT(rotations.size() == matrices.size());
+        UP_ASSERT(scales.size() == matrices.size());
+
+        for (size_t index = 0; index != matrices.size(); ++index) {
+            matrices[index] = composeMatrix(positions[index], rotations[index], scales[index]);
+        }
+    }
+
+    void composeLocalMatrices(span<TransformComponent* const> transforms) noexcept {
+        composeBlocks<BatchFloat>(
+            transforms.size(),
+            [&](size_t index) {
+                TransformComponent const& trans = *transforms[index];
+                return TransformInput{trans.position, trans.rotation, glm::vec3(trans.scale)};
+            },
+            [&](size_t index) -> glm::mat4x4& { return transforms[index]->matrix; });
+    }
+} // namespace up
@@ -1,8 +1,15 @@
 // Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
 
+#include "potato/game/entity_command_buffer.h"
 #include "potato/game/entity_manager.h"
+#include "potato/runtime/task_worker.h"
+#include "potato/spud/box.h"
+#include "potato/spud/vector.h"
 
 #include <catch2/catch.hpp>
+#include <atomic>
+#include <random>
+#include <thread>
 
 CATCH_REGISTER_ENUM(up::EntityId);
 
@@ -24,6 +31,22 @@ namespace components {
     struct Counter {
         int value;
     };
+
+    struct CounterObserver final : up::ComponentObserver<Counter> {
+        void onAdd(up::EntityId, Counter&) override { ++added; }
+        void onRemove(up::EntityId, Counter&) override { ++removed; }
+        void onMove(up::EntityId entityId, Counter& counter) override {
+            ++moved;
+            lastMoved = entityId;
+            lastMovedValue = counter.value;
+        }
+
+        int added = 0;
+        int removed = 0;
+        int moved = 0;
+        up::EntityId lastMoved = up::EntityId::None;
+        int lastMovedValue = 0;
+    };
 } // namespace components
 
 TEST_CASE("potato.ecs.EntityManager", "[potato][ecs]") {
@@ -125,4 +148,368 @@ TEST_CASE("potato.ecs.EntityManager", "[potato][ecs]") {
         entities.select<Test1>([&found](EntityId, Test1&) { found = true; });
         CHECK(found);
     }
+
+    SECTION("recycle entities") {
+        EntityManager entities;
+        entities.registerComponent<Test1>();
+
+        EntityId const first = entities.createEntity(Test1{'a'});
+        CHECK(entities.isAlive(first));
+        CHECK(entities.destroyEntity(first));
+        CHECK_FALSE(entities.isAlive(first));
+
+        // the slot is reused, but the stale id does not alias the new entity
+        EntityId const second = entities.createEntity(Test1{'b'});
+        CHECK(second != first);
+        CHECK(entities.isAlive(second));
+        CHECK_FALSE(entities.isAlive(first));
+        CHECK_FALSE(entities.isAlive(EntityId::None));
+
+        CHECK(entities.getComponentSlow<Test1>(first) == nullptr);
+        CHECK_FALSE(entities.destroyEntity(first));
+        CHECK_FALSE(entities.removeComponent<Test1>(first));
+
+        auto* const test = entities.getComponentSlow<Test1>(second);
+        REQUIRE(test != nullptr);
+        CHECK(test->a == 'b');
+    }
+
+    SECTION("register after create") {
+        EntityManager entities;
+        entities.registerComponent<Test1>();
+
+        EntityId const id = entities.createEntity(Test1{'r'});
+        entities.registerComponent<Counter>();
+        entities.addComponent<Counter>(id, Counter{5});
+
+        auto* const test = entities.getComponentSlow<Test1>(id);
+        auto* const counter = entities.getComponentSlow<Counter>(id);
+        REQUIRE(test != nullptr);
+        REQUIRE(counter != nullptr);
+        CHECK(test->a == 'r');
+        CHECK(counter->value == 5);
+    }
+
+    SECTION("packed removal") {
+        EntityManager entities;
+        entities.registerComponent<Counter>();
+        entities.registerComponent<Test1>(ComponentLayout::Sparse);
+
+        CounterObserver observer;
+        entities.observe(observer);
+
+        vector<EntityId> ids;
+        for (int index = 0; index != 5; ++index) {
+            ids.push_back(entities.createEntity(Counter{index}, Test1{static_cast<char>('a' + index)}));
+        }
+        CHECK(observer.added == 5);
+
+        // the last counter fills the hole left by the removed one
+        CHECK(entities.removeComponent<Counter>(ids[1]));
+        CHECK(observer.removed == 1);
+        CHECK(observer.moved == 1);
+        CHECK(observer.lastMoved == ids[4]);
+        CHECK(observer.lastMovedValue == 4);
+
+        CHECK(entities.destroyEntity(ids[0]));
+        CHECK(observer.removed == 2);
+        CHECK(observer.moved == 2);
+        CHECK(observer.lastMoved == ids[3]);
+
+        // removing the last component moves nothing
+        CHECK(entities.destroyEntity(ids[2]));
+        CHECK(observer.moved == 2);
+
+        int visited = 0;
+        entities.select<Counter, Test1>([&](EntityId id, Counter& counter, Test1& test) {
+            ++visited;
+            CHECK(id == ids[counter.value]);
+            CHECK(test.a == 'a' + counter.value);
+        });
+        CHECK(visited == 2);
+
+        CHECK(entities.getComponentSlow<Counter>(ids[4])->value == 4);
+        CHECK(entities.getComponentSlow<Counter>(ids[3])->value == 3);
+        CHECK(entities.getComponentSlow<Counter>(ids[1]) == nullptr);
+        CHECK(entities.getComponentSlow<Test1>(ids[1])->a == 'b');
+
+        entities.unobserve(observer);
+    }
+
+    SECTION("change ticks") {
+        EntityManager entities;
+        entities.registerComponent<Counter>();
+        entities.registerComponent<Test1>();
+
+        uint32 const created = entities.changeTick();
+        vector<EntityId> ids;
+        for (int index = 0; index != 4; ++index) {
+            ids.push_back(entities.createEntity(Counter{index}, Test1{'c'}));
+        }
+
+        auto const changed = [&](uint32 since) {
+            int visited = 0;
+            entities.selectChanged<Counter, Test1>(since, [&visited](EntityId, Counter&, Test1&) { ++visited; });
+            return visited;
+        };
+
+        // newly added components count as changed
+        CHECK(changed(created - 1) == 4);
+        CHECK(changed(created) == 0);
+
+        entities.advanceChangeTick();
+        uint32 const since = entities.changeTick() - 1;
+        CHECK(changed(since) == 0);
+
+        CHECK(entities.markChanged<Counter>(ids[1]));
+        Counter* const counter = entities.getMut<Counter>(ids[3]);
+        REQUIRE(counter != nullptr);
+        CHECK(counter->value == 3);
+        CHECK(changed(since) == 2);
+
+        // only the first component is filtered on
+        CHECK(entities.markChanged<Test1>(ids[0]));
+        CHECK(changed(since) == 2);
+
+        // ticks follow components moved by a packed removal
+        CHECK(entities.destroyEntity(ids[1]));
+        int visited = 0;
+        entities.selectChanged<Counter>(since, [&](EntityId id, Counter&) {
+            ++visited;
+            CHECK(id == ids[3]);
+        });
+        CHECK(visited == 1);
+
+        CHECK_FALSE(entities.markChanged<Counter>(ids[1]));
+        CHECK(entities.getMut<Counter>(ids[1]) == nullptr);
+    }
+
+    SECTION("parallel select") {
+        constexpr int entityCount = 10000;
+
+        EntityManager entities;
+        entities.registerComponent<Test1>();
+        entities.registerComponent<Counter>();
+
+        vector<EntityId> ids;
+        for (int index = 0; index != entityCount; ++index) {
+            EntityId const id = entities.createEntity(Counter{0});
+            if (index % 3 == 0) {
+                entities.addComponent<Test1>(id, Test1{'p'});
+            }
+            ids.push_back(id);
+        }
+        // leave holes in the storage for the batches to skip over
+        for (int index = 0; index < entityCount; index += 7) {
+            entities.destroyEntity(ids[index]);
+        }
+
+        int expected = 0;
+        int expectedBoth = 0;
+        entities.select<Counter>([&](EntityId, Counter&) { ++expected; });
+        entities.select<Counter, Test1>([&](EntityId, Counter&, Test1&) { ++expectedBoth; });
+
+        TaskQueue queue;
+        vector<box<TaskWorker>> workers;
+        for (int index = 0; index != 3; ++index) {
+            workers.push_back(new_box<TaskWorker>(queue, "Select"));
+        }
+
+        std::atomic<int> visited = 0;
+        entities.parallelSelect<Counter>(
+            &queue,
+            [&visited](EntityId, Counter& counter) {
+                ++counter.value;
+                ++visited;
+            },
+            64);
+        CHECK(visited == expected);
+
+        std::atomic<int> visitedBoth = 0;
+        entities.parallelSelect<Counter, Test1>(
+            &queue,
+            [&visitedBoth](EntityId, Counter& counter, Test1&) {
+                ++counter.value;
+                ++visitedBoth;
+            },
+            64);
+        CHECK(visitedBoth == expectedBoth);
+
+        // without a queue the work runs on the calling thread
+        int serial = 0;
+        entities.parallelSelect<Test1>(nullptr, [&serial](EntityId, Test1&) { ++serial; });
+        CHECK(serial == expectedBoth);
+
+        queue.close();
+        for (auto& worker : workers) {
+            worker->join();
+        }
+
+        // each entity was visited exactly once per select
+        bool once = true;
+        entities.select<Counter>([&](EntityId id, Counter& counter) {
+            once = once && counter.value == (entities.getComponentSlow<Test1>(id) != nullptr ? 2 : 1);
+        });
+        CHECK(once);
+    }
+
+    SECTION("command buffer") {
+        EntityManager entities;
+        entities.registerComponent<Test1>();
+        entities.registerComponent<Second>();
+        entities.registerComponent<Counter>();
+
+        CounterObserver observer;
+        entities.observe(observer);
+
+        EntityId const existing = entities.createEntity(Test1{'e'}, Counter{1});
+        EntityId const doomed = entities.createEntity(Test1{'d'}, Second{1.f, 'd'}, Counter{2});
+
+        EntityCommandBuffer commands;
+        CHECK(commands.empty());
+
+        EntityId const placeholder = commands.createEntity(Counter{3});
+        CHECK(EntityCommandBuffer::isPlaceholder(placeholder));
+        CHECK_FALSE(EntityCommandBuffer::isPlaceholder(existing));
+        commands.addComponent<Test1>(placeholder, Test1{'p'});
+
+        commands.addComponent<Second>(existing, Second{2.f, 'e'});
+        commands.removeComponent<Test1>(existing);
+        commands.destroyEntity(doomed);
+        // commands following a destroy are dropped
+        commands.addComponent<Test1>(doomed, Test1{'x'});
+
+        // a created and destroyed placeholder leaves nothing behind
+        EntityId const transient = commands.createEntity(Counter{4});
+        commands.destroyEntity(transient);
+        CHECK_FALSE(commands.empty());
+
+        // nothing is applied until playback
+        CHECK(entities.getComponentSlow<Test1>(existing) != nullptr);
+        CHECK(entities.isAlive(doomed));
+        CHECK(observer.added == 2);
+
+        entities.playback(commands);
+        CHECK(commands.empty());
+
+        CHECK(entities.getComponentSlow<Test1>(existing) == nullptr);
+        REQUIRE(entities.getComponentSlow<Second>(existing) != nullptr);
+        CHECK(entities.getComponentSlow<Second>(existing)->a == 'e');
+        CHECK_FALSE(entities.isAlive(doomed));
+
+        int counters = 0;
+        int created = 0;
+        entities.select<Counter>([&](EntityId id, Counter& counter) {
+            ++counters;
+            if (counter.value == 3) {
+                ++created;
+                CHECK(entities.getComponentSlow<Test1>(id) != nullptr);
+            }
+        });
+        CHECK(counters == 2);
+        CHECK(created == 1);
+        CHECK(observer.added == 4);
+        CHECK(observer.removed == 2);
+
+        entities.unobserve(observer);
+    }
+
+    SECTION("command buffer from threads") {
+        constexpr int threadCount = 4;
+        constexpr int perThread = 1000;
+
+        EntityManager entities;
+        entities.registerComponent<Test1>();
+        entities.registerComponent<Counter>();
+
+        vector<EntityId> ids;
+        for (int index = 0; index != threadCount * perThread; ++index) {
+            ids.push_back(entities.createEntity(Counter{index}));
+        }
+
+        // each thread destroys a quarter of the existing entities and spawns replacements
+        EntityCommandBuffer commands;
+        vector<std::thread> threads;
+        for (int thread = 0; thread != threadCount; ++thread) {
+            threads.emplace_back([&commands, &ids, thread] {
+                for (int index = thread * perThread; index != (thread + 1) * perThread; ++index) {
+                    if (index % 2 == 0) {
+                        commands.destroyEntity(ids[index]);
+                        commands.createEntity(Counter{-1}, Test1{'t'});
+                    }
+                    else {
+                        commands.addComponent<Test1>(ids[index], Test1{'a'});
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        entities.playback(commands);
+
+        int spawned = 0;
+        int kept = 0;
+        bool valid = true;
+        entities.select<Counter, Test1>([&](EntityId, Counter& counter, Test1& test) {
+            if (counter.value == -1) {
+                ++spawned;
+                valid = valid && test.a == 't';
+            }
+            else {
+                ++kept;
+                valid = valid && counter.value % 2 == 1 && test.a == 'a';
+            }
+        });
+        CHECK(spawned == threadCount * perThread / 2);
+        CHECK(kept == threadCount * perThread / 2);
+        CHECK(valid);
+    }
+}
+
+TEST_CASE("potato.ecs.EntityManager.benchmark", "[.][benchmark]") {
+    using namespace up;
+    using namespace components;
+
+    constexpr int initialCount = 200'000;
+    constexpr int churnCount = 1'000'000;
+
+    // a million random adds and removes that shrink the population by about
+    // half; sparse storages are left riddled with holes, packed ones stay dense
+    auto const churn = [](EntityManager& entities) {
+        std::mt19937 random(1234);
+        vector<EntityId> live;
+        for (int index = 0; index != initialCount; ++index) {
+            live.push_back(entities.createEntity(Counter{index}));
+        }
+        for (int index = 0; index != churnCount; ++index) {
+            if (live.empty() || random() % 20 < 9) {
+                live.push_back(entities.createEntity(Counter{index}));
+                continue;
+            }
+
+            auto const victim = std::uniform_int_distribution<size_t>(0, live.size() - 1)(random);
+            entities.destroyEntity(live[victim]);
+            live[victim] = live.back();
+            live.pop_back();
+        }
+    };
+
+    EntityManager packed;
+    packed.registerComponent<Counter>(ComponentLayout::Packed);
+    churn(packed);
+
+    EntityManager sparse;
+    sparse.registerComponent<Counter>(ComponentLayout::Sparse);
+    churn(sparse);
+
+    auto const sum = [](EntityManager& entities) {
+        int64 total = 0;
+        entities.select<Counter>([&total](EntityId, Counter& counter) { total += counter.value; });
+        return total;
+    };
+
+    BENCHMARK("packed select after churn") { return sum(packed); };
+    BENCHMARK("sparse select after churn") { return sum(sparse); };
 }
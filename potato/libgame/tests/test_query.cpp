@@ -0,0 +1,167 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/game/entity_command_buffer.h"
+#include "potato/game/entity_manager.h"
+#include "potato/game/query.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+
+namespace {
+    struct Position {
+        float x = 0.f;
+    };
+
+    struct Velocity {
+        float dx = 0.f;
+    };
+
+    struct Tag { };
+
+    template <typename... Components>
+    int countMatches(up::Query<Components...>& query) {
+        int count = 0;
+        query.select([&count](up::EntityId, Components&...) { ++count; });
+        return count;
+    }
+} // namespace
+
+TEST_CASE("potato.ecs.Query", "[potato][ecs]") {
+    using namespace up;
+
+    SECTION("matches existing entities") {
+        EntityManager entities;
+        entities.registerComponent<Position>();
+        entities.registerComponent<Velocity>();
+
+        EntityId const moving = entities.createEntity(Position{1.f}, Velocity{2.f});
+        entities.createEntity(Position{3.f});
+        entities.createEntity(Velocity{4.f});
+
+        Query<Position, Velocity const> query;
+        CHECK_FALSE(query.isRegistered());
+        entities.registerQuery(query);
+        CHECK(query.isRegistered());
+        REQUIRE(query.size() == 1);
+
+        query.select([&](EntityId entityId, Position& position, Velocity const& velocity) {
+            CHECK(entityId == moving);
+            position.x += velocity.dx;
+        });
+        CHECK(entities.getComponentSlow<Position>(moving)->x == 3.f);
+
+        entities.unregisterQuery(query);
+        CHECK_FALSE(query.isRegistered());
+        CHECK(query.size() == 0);
+    }
+
+    SECTION("follows structural changes") {
+        EntityManager entities;
+        entities.registerComponent<Position>();
+        entities.registerComponent<Velocity>();
+
+        Query<Position, Velocity> query;
+        entities.registerQuery(query);
+
+        vector<EntityId> ids;
+        for (int index = 0; index != 10; ++index) {
+            ids.push_back(entities.createEntity(Position{static_cast<float>(index)}));
+        }
+        CHECK(query.size() == 0);
+
+        for (int index = 0; index != 10; index += 2) {
+            entities.addComponent<Velocity>(ids[index], Velocity{1.f});
+        }
+        CHECK(query.size() == 5);
+        CHECK(countMatches(query) == 5);
+
+        entities.removeComponent<Position>(ids[0]);
+        entities.destroyEntity(ids[2]);
+        entities.destroyEntity(ids[3]);
+        CHECK(query.size() == 3);
+
+        // components that are moved by packed removals are still found
+        float sum = 0.f;
+        query.select([&sum](EntityId, Position& position, Velocity&) { sum += position.x; });
+        CHECK(sum == 4.f + 6.f + 8.f);
+
+        EntityCommandBuffer commands;
+        commands.createEntity(Position{20.f}, Velocity{1.f});
+        commands.removeComponent<Velocity>(ids[4]);
+        entities.playback(commands);
+        CHECK(query.size() == 3);
+
+        int selected = 0;
+        entities.select<Position, Velocity>([&selected](EntityId, Position&, Velocity&) { ++selected; });
+        CHECK(countMatches(query) == selected);
+    }
+
+    SECTION("components registered later") {
+        EntityManager entities;
+        entities.registerComponent<Position>();
+
+        Query<Position, Tag> query;
+        entities.registerQuery(query);
+
+        EntityId const first = entities.createEntity(Position{1.f});
+        CHECK(query.size() == 0);
+
+        entities.registerComponent<Tag>();
+        CHECK(query.size() == 0);
+
+        entities.addComponent<Tag>(first);
+        entities.createEntity(Position{2.f}, Tag{});
+        CHECK(query.size() == 2);
+        CHECK(countMatches(query) == 2);
+    }
+
+    SECTION("outlives its EntityManager") {
+        Query<Position> query;
+        {
+            EntityManager entities;
+            entities.registerComponent<Position>();
+            entities.createEntity(Position{1.f});
+            entities.registerQuery(query);
+            CHECK(query.size() == 1);
+        }
+        CHECK_FALSE(query.isRegistered());
+        CHECK(query.size() == 0);
+    }
+}
+
+TEST_CASE("potato.ecs.Query.benchmark", "[.][benchmark]") {
+    using namespace up;
+
+    constexpr int entityCount = 200'000;
+
+    EntityManager entities;
+    entities.registerComponent<Position>();
+    entities.registerComponent<Velocity>();
+    entities.registerComponent<Tag>();
+
+    // a quarter of the entities match, so select has to skip over the rest
+    for (int index = 0; index != entityCount; ++index) {
+        EntityId const entityId = entities.createEntity(Position{static_cast<float>(index)});
+        if (index % 2 == 0) {
+            entities.addComponent<Velocity>(entityId, Velocity{1.f});
+        }
+        if (index % 4 == 0) {
+            entities.addComponent<Tag>(entityId);
+        }
+    }
+
+    Query<Position, Velocity, Tag> query;
+    entities.registerQuery(query);
+
+    BENCHMARK("select") {
+        float sum = 0.f;
+        entities.select<Position, Velocity, Tag>(
+            [&sum](EntityId, Position& position, Velocity& velocity, Tag&) { sum += position.x * velocity.dx; });
+        return sum;
+    };
+    BENCHMARK("query") {
+        float sum = 0.f;
+        query.select([&sum](EntityId, Position& position, Velocity& velocity, Tag&) { sum += position.x * velocity.dx; });
+        return sum;
+    };
+}
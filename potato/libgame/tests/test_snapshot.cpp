@@ -0,0 +1,482 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/game/entity_manager.h"
+#include "potato/game/query.h"
+#include "potato/runtime/stream.h"
+#include "potato/spud/string.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <random>
+
+namespace {
+    struct Position {
+        float x = 0.f;
+        float y = 0.f;
+    };
+
+    struct Health {
+        int value = 0;
+    };
+
+    struct Tag { };
+
+    /// Neither trivially copyable nor described by a schema, so left out of snapshots.
+    struct Name {
+        up::string value;
+    };
+
+    struct LabelCounter final : up::ComponentObserver<up::string> {
+        void onAdd(up::EntityId, up::string&) override { ++added; }
+        void onRemove(up::EntityId, up::string&) override { ++removed; }
+
+        int added = 0;
+        int removed = 0;
+    };
+
+    /// Runtime-only state derived from Health, like a physics body derived from a RigidBody.
+    struct Body {
+        int* handle = nullptr;
+    };
+
+    /// Keeps a Body alongside every Health, the way the physics system keeps its bodies.
+    struct BodyObserver final : up::ComponentObserver<Health> {
+        explicit BodyObserver(up::EntityManager& world) noexcept : world(world) { }
+
+        void onAdd(up::EntityId entityId, Health&) override {
+            world.addComponent<Body>(entityId, Body{&live});
+            ++live;
+        }
+        void onRemove(up::EntityId entityId, Health&) override {
+            world.removeComponent<Body>(entityId);
+            --live;
+        }
+
+        up::EntityManager& world;
+        int live = 0;
+    };
+
+    void registerWorld(up::EntityManager& world) {
+        world.registerComponent<Position>();
+        world.registerComponent<Health>(up::ComponentLayout::Sparse);
+        world.registerComponent<Tag>();
+        world.registerComponent<up::string>();
+    }
+
+    void registerBodies(up::EntityManager& world) {
+        registerWorld(world);
+        world.registerComponent<Body>(up::ComponentLayout::Packed, up::ComponentPersistence::Transient);
+    }
+
+    /// Makes the kind of changes a simulation tick would, driven only by random.
+    void simulate(up::EntityManager& world, up::vector<up::EntityId>& ids, std::mt19937& random) {
+        for (up::EntityId& entityId : ids) {
+            uint32_t const roll = random() % 100;
+            if (!world.isAlive(entityId)) {
+                if (roll < 20) {
+                    entityId = world.createEntity(Position{static_cast<float>(roll), 0.f}, up::string("respawned"));
+                }
+                continue;
+            }
+
+            if (roll < 30) {
+                world.getMut<Position>(entityId)->x += 0.25f;
+            }
+            else if (roll < 40) {
+                if (Health* const health = world.getMut<Health>(entityId); health != nullptr) {
+                    health->value -= 1;
+                }
+                else {
+                    world.addComponent<Health>(entityId, Health{100});
+                }
+            }
+            else if (roll < 45) {
+                world.removeComponent<Health>(entityId);
+            }
+            else if (roll < 48) {
+                world.addComponent<Tag>(entityId);
+            }
+            else if (roll < 52) {
+                world.destroyEntity(entityId);
+            }
+        }
+    }
+
+    up::vector<up::byte> deltaOf(up::EntityManager& current, up::EntityManager& baseline) {
+        up::vector<up::byte> bytes;
+        up::Stream stream = up::openMemory(bytes);
+        REQUIRE(current.writeDelta(baseline, stream) == up::IOResult::Success);
+        return bytes;
+    }
+
+    up::IOResult applyDelta(up::EntityManager& world, up::vector<up::byte>& bytes) {
+        up::Stream stream = up::openMemory(bytes);
+        return world.applyDelta(stream);
+    }
+} // namespace
+
+TEST_CASE("potato.ecs.Snapshot", "[potato][ecs]") {
+    using namespace up;
+
+    SECTION("round trip") {
+        vector<byte> bytes;
+        vector<EntityId> ids;
+        {
+            EntityManager entities;
+            entities.registerComponent<Position>();
+            entities.registerComponent<Health>(ComponentLayout::Sparse);
+            entities.registerComponent<Tag>();
+            entities.registerComponent<string>();
+            entities.registerComponent<Name>();
+
+            for (int index = 0; index != 8; ++index) {
+                ids.push_back(entities.createEntity(Position{static_cast<float>(index), 1.f}));
+            }
+            for (int index = 0; index != 8; index += 2) {
+                entities.addComponent<Health>(ids[index], Health{index * 10});
+                entities.addComponent<string>(ids[index], string("entity"));
+                entities.addComponent<Name>(ids[index], Name{string("name")});
+            }
+            entities.addComponent<Tag>(ids[1]);
+
+            // leave a hole in the sparse storage, a recycled slot and a free slot
+            entities.removeComponent<Health>(ids[2]);
+            entities.destroyEntity(ids[5]);
+            ids[5] = entities.createEntity(Position{50.f, 0.f});
+            entities.destroyEntity(ids[7]);
+
+            Stream stream = openMemory(bytes);
+            REQUIRE(entities.writeSnapshot(stream) == IOResult::Success);
+        }
+
+        EntityManager loaded;
+        loaded.registerComponent<Position>();
+        loaded.registerComponent<Health>(ComponentLayout::Sparse);
+        loaded.registerComponent<Tag>();
+        loaded.registerComponent<string>();
+        loaded.registerComponent<Name>();
+
+        Query<Position, Health> query;
+        loaded.registerQuery(query);
+        LabelCounter labels;
+        loaded.observe(labels);
+
+        Stream stream = openMemory(bytes);
+        REQUIRE(loaded.readSnapshot(stream) == IOResult::Success);
+
+        CHECK_FALSE(loaded.isAlive(ids[7]));
+        for (int index = 0; index != 7; ++index) {
+            CHECK(loaded.isAlive(ids[index]));
+            Position const* const position = loaded.getComponentSlow<Position>(ids[index]);
+            REQUIRE(position != nullptr);
+            CHECK(position->x == (index == 5 ? 50.f : static_cast<float>(index)));
+        }
+        CHECK(loaded.getComponentSlow<Health>(ids[2]) == nullptr);
+        CHECK(loaded.getComponentSlow<Health>(ids[4])->value == 40);
+        CHECK(loaded.getComponentSlow<Tag>(ids[1]) != nullptr);
+        CHECK(loaded.getComponentSlow<Tag>(ids[0]) == nullptr);
+        CHECK(*loaded.getComponentSlow<string>(ids[6]) == "entity");
+        CHECK(loaded.getComponentSlow<Name>(ids[6]) == nullptr);
+        CHECK(query.size() == 3);
+        CHECK(labels.added == 4);
+
+        // the free slot is reused with a newer generation
+        EntityId const created = loaded.createEntity();
+        CHECK(created != ids[7]);
+        CHECK(loaded.isAlive(created));
+        CHECK_FALSE(loaded.isAlive(ids[7]));
+
+        // loading again replaces the world rather than adding to it
+        Stream again = openMemory(bytes);
+        REQUIRE(loaded.readSnapshot(again) == IOResult::Success);
+        CHECK_FALSE(loaded.isAlive(created));
+        CHECK(labels.removed == 4);
+        CHECK(labels.added == 8);
+        CHECK(query.size() == 3);
+    }
+
+    SECTION("rejects mismatched snapshots") {
+        vector<byte> bytes;
+        EntityId entityId = EntityId::None;
+        {
+            EntityManager entities;
+            entities.registerComponent<Health>();
+            entityId = entities.createEntity(Health{7});
+
+            Stream stream = openMemory(bytes);
+            REQUIRE(entities.writeSnapshot(stream) == IOResult::Success);
+        }
+
+        // the current world is untouched when the table doesn't match
+        EntityManager other;
+        other.registerComponent<Position>();
+        EntityId const existing = other.createEntity(Position{1.f, 2.f});
+        Stream unregistered = openMemory(bytes);
+        CHECK(other.readSnapshot(unregistered) == IOResult::Malformed);
+        CHECK(other.isAlive(existing));
+
+        EntityManager sparse;
+        sparse.registerComponent<Health>(ComponentLayout::Sparse);
+        Stream layout = openMemory(bytes);
+        CHECK(sparse.readSnapshot(layout) == IOResult::Malformed);
+
+        EntityManager truncated;
+        truncated.registerComponent<Health>();
+        vector<byte> partial(bytes.begin(), bytes.end() - 1);
+        Stream shortStream = openMemory(partial);
+        CHECK(truncated.readSnapshot(shortStream) == IOResult::Malformed);
+        CHECK_FALSE(truncated.isAlive(entityId));
+
+        bytes[0] = byte{0};
+        EntityManager badMagic;
+        badMagic.registerComponent<Health>();
+        Stream magic = openMemory(bytes);
+        CHECK(badMagic.readSnapshot(magic) == IOResult::Malformed);
+    }
+
+    SECTION("transient components are recreated by observers") {
+        vector<byte> bytes;
+        EntityId entityId = EntityId::None;
+        {
+            EntityManager entities;
+            registerBodies(entities);
+            BodyObserver bodies(entities);
+            entities.observe(bodies);
+            entityId = entities.createEntity(Position{1.f, 2.f}, Health{5});
+            REQUIRE(entities.getComponentSlow<Body>(entityId) != nullptr);
+
+            Stream stream = openMemory(bytes);
+            REQUIRE(entities.writeSnapshot(stream) == IOResult::Success);
+        }
+
+        // readers that never registered the transient component accept the snapshot
+        EntityManager plain;
+        registerWorld(plain);
+        Stream plainStream = openMemory(bytes);
+        CHECK(plain.readSnapshot(plainStream) == IOResult::Success);
+
+        // observers may remove derived components while the current world is cleared
+        EntityManager loaded;
+        registerBodies(loaded);
+        BodyObserver bodies(loaded);
+        loaded.observe(bodies);
+        loaded.createEntity(Health{1});
+        EntityId const existing = loaded.createEntity(Health{2});
+        CHECK(bodies.live == 2);
+
+        Stream stream = openMemory(bytes);
+        REQUIRE(loaded.readSnapshot(stream) == IOResult::Success);
+        CHECK_FALSE(loaded.isAlive(existing));
+        CHECK(bodies.live == 1);
+        Body const* const body = loaded.getComponentSlow<Body>(entityId);
+        REQUIRE(body != nullptr);
+        CHECK(body->handle == &bodies.live);
+    }
+}
+
+TEST_CASE("potato.ecs.Delta", "[potato][ecs]") {
+    using namespace up;
+
+    SECTION("replicates a simulation") {
+        EntityManager server;
+        EntityManager baseline;
+        EntityManager replica;
+        registerWorld(server);
+        registerWorld(baseline);
+        registerWorld(replica);
+
+        std::mt19937 random(1234);
+        vector<EntityId> ids;
+        for (int index = 0; index != 500; ++index) {
+            ids.push_back(server.createEntity(Position{static_cast<float>(index), 0.f}, Health{100}));
+        }
+
+        // replicas start from a full snapshot and follow with deltas
+        vector<byte> snapshot;
+        Stream written = openMemory(snapshot);
+        REQUIRE(server.writeSnapshot(written) == IOResult::Success);
+        Stream toBaseline = openMemory(snapshot);
+        REQUIRE(baseline.readSnapshot(toBaseline) == IOResult::Success);
+        Stream toReplica = openMemory(snapshot);
+        REQUIRE(replica.readSnapshot(toReplica) == IOResult::Success);
+
+        size_t const identicalSize = deltaOf(server, server).size();
+        for (int tick = 0; tick != 20; ++tick) {
+            simulate(server, ids, random);
+
+            vector<byte> delta = deltaOf(server, baseline);
+            CHECK(delta.size() < snapshot.size());
+            REQUIRE(applyDelta(baseline, delta) == IOResult::Success);
+            REQUIRE(applyDelta(replica, delta) == IOResult::Success);
+
+            CHECK(deltaOf(server, replica).size() == identicalSize);
+            for (EntityId const entityId : ids) {
+                REQUIRE(replica.isAlive(entityId) == server.isAlive(entityId));
+                if (server.isAlive(entityId)) {
+                    Health const* const health = server.getComponentSlow<Health>(entityId);
+                    Health const* const replicated = replica.getComponentSlow<Health>(entityId);
+                    REQUIRE((health == nullptr) == (replicated == nullptr));
+                    CHECK((health == nullptr || health->value == replicated->value));
+                    CHECK(
+                        std::memcmp(
+                            server.getComponentSlow<Position>(entityId),
+                            replica.getComponentSlow<Position>(entityId),
+                            sizeof(Position)) == 0);
+                    string const* const label = server.getComponentSlow<string>(entityId);
+                    string const* const replicatedLabel = replica.getComponentSlow<string>(entityId);
+                    REQUIRE((label == nullptr) == (replicatedLabel == nullptr));
+                    CHECK((label == nullptr || *label == *replicatedLabel));
+                }
+            }
+        }
+
+        // the free slots match too, so both hand out the same EntityIds
+        CHECK(replica.createEntity() == server.createEntity());
+    }
+
+    SECTION("unchanged components are not written") {
+        EntityManager server;
+        EntityManager baseline;
+        registerWorld(server);
+        registerWorld(baseline);
+
+        for (int index = 0; index != 1000; ++index) {
+            server.createEntity(Position{static_cast<float>(index), 0.f}, Health{100});
+        }
+        vector<byte> initial = deltaOf(server, baseline);
+        REQUIRE(applyDelta(baseline, initial) == IOResult::Success);
+
+        server.select<Position>([](EntityId entityId, Position& position) {
+            if (to_underlying(entityId) % 100 == 0) {
+                position.y = 1.f;
+            }
+        });
+        vector<byte> const delta = deltaOf(server, baseline);
+        CHECK(delta.size() < initial.size() / 100);
+    }
+
+    SECTION("rejects deltas for another baseline") {
+        EntityManager server;
+        EntityManager baseline;
+        registerWorld(server);
+        registerWorld(baseline);
+
+        server.createEntity(Position{1.f, 2.f});
+        vector<byte> delta = deltaOf(server, baseline);
+
+        EntityManager other;
+        registerWorld(other);
+        other.createEntity();
+        CHECK(applyDelta(other, delta) == IOResult::Malformed);
+
+        vector<byte> truncated(delta.begin(), delta.end() - 1);
+        CHECK(applyDelta(baseline, truncated) == IOResult::Malformed);
+
+        EntityManager unregistered;
+        unregistered.registerComponent<Health>();
+        CHECK(applyDelta(unregistered, delta) == IOResult::Malformed);
+    }
+
+    SECTION("transient components are left out") {
+        EntityManager server;
+        EntityManager baseline;
+        EntityManager replica;
+        registerBodies(server);
+        registerBodies(baseline);
+        registerBodies(replica);
+        BodyObserver serverBodies(server);
+        BodyObserver replicaBodies(replica);
+        server.observe(serverBodies);
+        replica.observe(replicaBodies);
+
+        EntityId const entityId = server.createEntity(Position{1.f, 2.f}, Health{5});
+        EntityId const other = server.createEntity(Health{7});
+
+        // the replica's observer adds the Body, so the delta must not add it again
+        vector<byte> delta = deltaOf(server, baseline);
+        REQUIRE(applyDelta(baseline, delta) == IOResult::Success);
+        REQUIRE(applyDelta(replica, delta) == IOResult::Success);
+        CHECK(replicaBodies.live == 2);
+        CHECK(replica.getComponentSlow<Body>(entityId) != nullptr);
+        CHECK(baseline.getComponentSlow<Body>(entityId) == nullptr);
+
+        server.removeComponent<Health>(other);
+        vector<byte> removal = deltaOf(server, baseline);
+        REQUIRE(applyDelta(baseline, removal) == IOResult::Success);
+        REQUIRE(applyDelta(replica, removal) == IOResult::Success);
+        CHECK(replicaBodies.live == 1);
+        CHECK(replica.getComponentSlow<Body>(other) == nullptr);
+    }
+}
+
+TEST_CASE("potato.ecs.Snapshot.benchmark", "[.][benchmark]") {
+    using namespace up;
+
+    constexpr int entityCount = 100'000;
+
+    EntityManager entities;
+    entities.registerComponent<Position>();
+    entities.registerComponent<Health>();
+    for (int index = 0; index != entityCount; ++index) {
+        entities.createEntity(Position{static_cast<float>(index), 0.f}, Health{index});
+    }
+
+    vector<byte> bytes;
+    BENCHMARK("write") {
+        bytes.clear();
+        Stream stream = openMemory(bytes);
+        return entities.writeSnapshot(stream);
+    };
+
+    EntityManager loaded;
+    loaded.registerComponent<Position>();
+    loaded.registerComponent<Health>();
+    BENCHMARK("read") {
+        Stream stream = openMemory(bytes);
+        return loaded.readSnapshot(stream);
+    };
+}
+
+TEST_CASE("potato.ecs.Delta.benchmark", "[.][benchmark]") {
+    using namespace up;
+
+    constexpr int entityCount = 100'000;
+
+    EntityManager server;
+    EntityManager baseline;
+    EntityManager replica;
+    registerWorld(server);
+    registerWorld(baseline);
+    registerWorld(replica);
+    for (int index = 0; index != entityCount; ++index) {
+        server.createEntity(Position{static_cast<float>(index), 0.f}, Health{index});
+    }
+    vector<byte> initial = deltaOf(server, baseline);
+    REQUIRE(applyDelta(baseline, initial) == IOResult::Success);
+    REQUIRE(applyDelta(replica, initial) == IOResult::Success);
+
+    // a tenth of the entities move each tick
+    std::mt19937 random(1234);
+    server.select<Position>([&random](EntityId, Position& position) {
+        if (random() % 10 == 0) {
+            position.x += 1.f;
+        }
+    });
+
+    vector<byte> snapshot;
+    Stream written = openMemory(snapshot);
+    REQUIRE(server.writeSnapshot(written) == IOResult::Success);
+    vector<byte> delta = deltaOf(server, baseline);
+    CHECK(delta.size() * 10 < snapshot.size());
+
+    BENCHMARK("snapshot") {
+        vector<byte> bytes;
+        Stream stream = openMemory(bytes);
+        return server.writeSnapshot(stream);
+    };
+    BENCHMARK("write delta") { return deltaOf(server, baseline).size(); };
+
+    // changes are XOR-encoded, so applying the delta again undoes it
+    BENCHMARK("apply delta") { return applyDelta(replica, delta); };
+}
@@ -0,0 +1,470 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/audio/audio_engine.h"
+#include "potato/game/components/camera_controllers.h"
+#include "potato/game/components/demo_components.h"
+#include "potato/game/components/parent_component.h"
+#include "potato/game/components/rigidbody_component.h"
+#include "potato/game/components/transform_component.h"
+#include "potato/game/space.h"
+#include "potato/game/system.h"
+#include "potato/spud/arena.h"
+#include "potato/spud/hash_map.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <chrono>
+#include <cstdlib>
+#include <glm/gtc/constants.hpp>
+#include <new>
+#include <thread>
+
+namespace {
+    // global allocations are counted so tests can assert on steady-state
+    // frames; note that with shared library builds on Windows this only
+    // observes allocations made by the test executable itself
+    int globalAllocations = 0;
+
+    void* countedAllocate(std::size_t size, std::size_t alignment) noexcept {
+        ++globalAllocations;
+
+        // over-allocate to store the original pointer before the aligned block
+        void* const raw = std::malloc(size + alignment + sizeof(void*));
+        if (raw == nullptr) {
+            return nullptr;
+        }
+        auto const address = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+        auto* const aligned = reinterpret_cast<void**>((address + alignment - 1) & ~(alignment - 1));
+        aligned[-1] = raw;
+        return aligned;
+    }
+
+    void* countedAllocateOrThrow(std::size_t size, std::size_t alignment) {
+        void* const memory = countedAllocate(size, alignment);
+        if (memory == nullptr) {
+            throw std::bad_alloc{};
+        }
+        return memory;
+    }
+
+    void countedFree(void* memory) noexcept {
+        if (memory != nullptr) {
+            std::free(static_cast<void**>(memory)[-1]);
+        }
+    }
+
+    /// Stands in for the audio device, which CI machines don't have.
+    class NullAudioEngine final : public up::AudioEngine {
+    public:
+        void registerAssetBackends(up::AssetLoader&) override { }
+        auto play(up::SoundResource const*) -> up::PlayHandle override { return {}; }
+    };
+
+    /// Populates space with the kind of entities the editor's demo scene has, so
+    /// that every demo system has work to do.
+    void createDemoScene(up::Space& space, int count) {
+        up::EntityManager& entities = space.entities();
+
+        entities.createEntity(up::TransformComponent{}, up::FlyCameraComponent{});
+
+        up::EntityId previous = up::EntityId::None;
+        for (int index = 0; index != count; ++index) {
+            float const angle = static_cast<float>(index) / static_cast<float>(count) * glm::two_pi<float>();
+
+            up::TransformComponent trans;
+            trans.position = {glm::sin(angle) * 20.f, 1.f, glm::cos(angle) * 20.f};
+            up::EntityId const entityId = entities.createEntity(
+                std::move(trans),
+                up::DemoWaveComponent{.offset = angle},
+                up::DemoSpinComponent{.radians = 0.1f});
+
+            if (index % 8 == 7) {
+                entities.addComponent<up::ParentComponent>(entityId, up::ParentComponent{.parent = previous});
+            }
+            if (index % 32 == 0) {
+                entities.addComponent<up::RigidBodyComponent>(entityId);
+            }
+            previous = entityId;
+        }
+    }
+
+    // stands in for the per-frame render lists built by gameplay code
+    class FrameListSystem final : public up::System {
+    public:
+        using System::System;
+
+        void update(float) override {
+            up::vector<up::EntityId> spinning(space().frameResource());
+            up::hash_map<up::EntityId, float> angles(space().frameResource());
+
+            space().entities().select<up::TransformComponent, up::DemoSpinComponent>(
+                [&](up::EntityId entityId, up::TransformComponent&, up::DemoSpinComponent& spin) {
+                    spinning.push_back(entityId);
+                    angles.insert(entityId, spin.radians);
+                });
+
+            up::scratch_scope scratch;
+            up::vector<glm::vec3> positions(scratch.resource());
+            for (up::EntityId const entityId : spinning) {
+                positions.push_back(space().entities().getComponentSlow<up::TransformComponent>(entityId)->position);
+            }
+
+            visited = positions.size();
+        }
+
+        size_t visited = 0;
+    };
+
+    // stamps a block of frame memory every tick, and checks that the blocks of
+    // the previous frame are untouched
+    class FrameStampSystem final : public up::System {
+    public:
+        using System::System;
+
+        void update(float) override {
+            for (Stamp const& stamp : previous) {
+                intact = intact && *stamp.memory == stamp.value;
+            }
+
+            auto* const memory = static_cast<int*>(space().frameResource()->allocate(sizeof(int), alignof(int)));
+            *memory = ++stamps;
+            current.push_back({memory, stamps});
+        }
+
+        /// Called between frames.
+        void endFrame() {
+            previous = std::move(current);
+            current.clear();
+        }
+
+        struct Stamp {
+            int* memory = nullptr;
+            int value = 0;
+        };
+
+        up::vector<Stamp> previous;
+        up::vector<Stamp> current;
+        int stamps = 0;
+        bool intact = true;
+    };
+
+    class TickCountSystem final : public up::System {
+    public:
+        using System::System;
+
+        void update(float deltaTime) override {
+            ++ticks;
+            lastDeltaTime = deltaTime;
+            std::this_thread::sleep_for(delay);
+        }
+        up::zstring_view name() const noexcept override { return "tick_count"; }
+
+        int ticks = 0;
+        float lastDeltaTime = 0.f;
+        std::chrono::milliseconds delay{0};
+    };
+} // namespace
+
+// every replaceable form is replaced, so that no block from the default
+// allocator is ever handed to countedFree
+void* operator new(std::size_t size) {
+    return countedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept {
+    return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size) {
+    return countedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept {
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept {
+    return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* memory) noexcept {
+    countedFree(memory);
+}
+void operator delete(void* memory, std::size_t) noexcept {
+    countedFree(memory);
+}
+void operator delete(void* memory, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+void operator delete(void* memory, std::nothrow_t const&) noexcept {
+    countedFree(memory);
+}
+void operator delete(void* memory, std::align_val_t, std::nothrow_t const&) noexcept {
+    countedFree(memory);
+}
+void operator delete[](void* memory) noexcept {
+    countedFree(memory);
+}
+void operator delete[](void* memory, std::size_t) noexcept {
+    countedFree(memory);
+}
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+void operator delete[](void* memory, std::nothrow_t const&) noexcept {
+    countedFree(memory);
+}
+void operator delete[](void* memory, std::align_val_t, std::nothrow_t const&) noexcept {
+    countedFree(memory);
+}
+
+TEST_CASE("potato.game.Space", "[potato][game]") {
+    using namespace up;
+
+    SECTION("steady-state frames do not allocate") {
+        NullAudioEngine audio;
+        Space space;
+        Space::addDemoSystem(space, audio);
+        auto& frameList = static_cast<FrameListSystem&>(space.addSystem<FrameListSystem>());
+
+        createDemoScene(space, 100);
+
+        space.start();
+
+        // the first frames size both halves of the frame arena, the scratch
+        // arena, and the physics world's contact caches
+        for (int frame = 0; frame != 10; ++frame) {
+            space.update(1.f / 60.f);
+        }
+
+        int const before = globalAllocations;
+        for (int frame = 0; frame != 10; ++frame) {
+            space.update(1.f / 60.f);
+        }
+        CHECK(globalAllocations - before == 0);
+        CHECK(frameList.visited == 100);
+
+        space.stop();
+    }
+
+    SECTION("transform matrices follow changes") {
+        Space space;
+
+        TransformComponent initial;
+        initial.position = {1.f, 0.f, 0.f};
+        EntityId const id = space.entities().createEntity(std::move(initial));
+
+        space.start();
+        space.update(1.f / 60.f);
+
+        auto const translationX = [&] {
+            return space.entities().getComponentSlow<TransformComponent>(id)->matrix[3].x;
+        };
+        CHECK(translationX() == 1.f);
+
+        // writes that are not marked changed are not picked up
+        space.entities().getComponentSlow<TransformComponent>(id)->position = {2.f, 0.f, 0.f};
+        space.update(1.f / 60.f);
+        CHECK(translationX() == 1.f);
+
+        space.entities().getMut<TransformComponent>(id)->position = {3.f, 0.f, 0.f};
+        space.update(1.f / 60.f);
+        CHECK(translationX() == 3.f);
+
+        space.stop();
+    }
+
+    SECTION("commands are played back by update") {
+        Space space;
+        space.start();
+
+        TransformComponent initial;
+        initial.position = {5.f, 0.f, 0.f};
+        EntityId const placeholder = space.commands().createEntity(std::move(initial));
+        CHECK(space.entities().getComponentSlow<TransformComponent>(placeholder) == nullptr);
+
+        space.update(1.f / 60.f);
+        CHECK(space.commands().empty());
+
+        int count = 0;
+        space.entities().select<TransformComponent>([&](EntityId, TransformComponent& trans) {
+            ++count;
+            // added before the transform system ran, so its matrix is current
+            CHECK(trans.matrix[3].x == 5.f);
+        });
+        CHECK(count == 1);
+
+        space.stop();
+    }
+
+    SECTION("transform hierarchy") {
+        Space space;
+        EntityManager& entities = space.entities();
+
+        auto const at = [](float x) {
+            TransformComponent trans;
+            trans.position = {x, 0.f, 0.f};
+            return trans;
+        };
+        auto const worldX = [&](EntityId id) {
+            return entities.getComponentSlow<TransformComponent>(id)->matrix[3].x;
+        };
+
+        EntityId const root = entities.createEntity(at(1.f));
+        EntityId const child = entities.createEntity(at(2.f), ParentComponent{root});
+        EntityId const grandchild = entities.createEntity(at(4.f), ParentComponent{child});
+        EntityId const sibling = entities.createEntity(at(8.f), ParentComponent{root});
+        EntityId const loner = entities.createEntity(at(16.f));
+
+        space.start();
+        space.update(1.f / 60.f);
+
+        CHECK(worldX(root) == 1.f);
+        CHECK(worldX(child) == 3.f);
+        CHECK(worldX(grandchild) == 7.f);
+        CHECK(worldX(sibling) == 9.f);
+        CHECK(worldX(loner) == 16.f);
+
+        // moving a node recomputes its subtree, and nothing else
+        entities.getComponentSlow<TransformComponent>(sibling)->matrix = {};
+        entities.getMut<TransformComponent>(child)->position.x = 32.f;
+        space.update(1.f / 60.f);
+
+        CHECK(worldX(child) == 33.f);
+        CHECK(worldX(grandchild) == 37.f);
+        CHECK(worldX(sibling) == 0.f);
+
+        // scale applies to the node and its children
+        entities.getMut<TransformComponent>(root)->scale = 2.f;
+        space.update(1.f / 60.f);
+
+        CHECK(worldX(child) == 65.f);
+        CHECK(worldX(grandchild) == 73.f);
+        CHECK(worldX(sibling) == 17.f);
+
+        // re-parenting and destroying parents reshape the hierarchy
+        entities.getMut<ParentComponent>(grandchild)->parent = loner;
+        space.update(1.f / 60.f);
+        CHECK(worldX(grandchild) == 20.f);
+
+        entities.destroyEntity(loner);
+        space.update(1.f / 60.f);
+        CHECK(worldX(grandchild) == 4.f);
+
+        space.stop();
+    }
+
+    SECTION("frame memory outlives the next frame") {
+        Space space;
+        auto& stamper = static_cast<FrameStampSystem&>(space.addSystem<FrameStampSystem>());
+        space.setTickRate(4.f, 4);
+        space.start();
+
+        // frames of several catch-up ticks, then of one, then of none
+        for (float const frameTime : {0.75f, 1.f, 0.25f, 0.125f, 0.75f, 0.25f}) {
+            space.advance(frameTime);
+            stamper.endFrame();
+        }
+        CHECK(stamper.stamps == 12);
+        CHECK(stamper.intact);
+
+        // direct updates are frames of their own
+        space.update(0.25f);
+        stamper.endFrame();
+        space.update(0.25f);
+        CHECK(stamper.intact);
+
+        space.stop();
+    }
+
+    SECTION("advance runs fixed ticks") {
+        Space space;
+        auto& counter = static_cast<TickCountSystem&>(space.addSystem<TickCountSystem>());
+        space.setTickRate(4.f, 4);
+        space.start();
+
+        CHECK(space.advance(0.625f) == 2);
+        CHECK(counter.ticks == 2);
+        CHECK(counter.lastDeltaTime == 0.25f);
+        CHECK(space.interpolationAlpha() == 0.5f);
+
+        // leftover time carries over into the next advance
+        CHECK(space.advance(0.125f) == 1);
+        CHECK(space.interpolationAlpha() == 0.f);
+
+        // a long frame is capped rather than caught up on later
+        CHECK(space.advance(100.f) == 4);
+        CHECK(space.advance(0.125f) == 0);
+        CHECK(counter.ticks == 7);
+        CHECK(space.interpolationAlpha() == 0.5f);
+
+        space.update(1.f);
+        CHECK(space.interpolationAlpha() == 1.f);
+
+        space.stop();
+    }
+
+    SECTION("profiling times each system") {
+        Space space;
+        auto& counter = static_cast<TickCountSystem&>(space.addSystem<TickCountSystem>());
+        counter.delay = std::chrono::milliseconds{2};
+        space.start();
+
+        REQUIRE(space.systemUpdateSeconds().size() == space.systems().size());
+        CHECK(space.systems().back()->name() == "tick_count"_zsv);
+
+        space.update(1.f / 60.f);
+        CHECK(space.systemUpdateSeconds().back() == 0.0);
+
+        space.setProfiling(true);
+        space.update(1.f / 60.f);
+        CHECK(space.systemUpdateSeconds().back() >= 0.002);
+
+        space.stop();
+    }
+
+    SECTION("previous matrices trail by one tick") {
+        Space space;
+        space.setTickRate(4.f);
+        EntityId const id = space.entities().createEntity(TransformComponent{});
+
+        space.start();
+        space.advance(0.25f);
+
+        auto const interpolatedX = [&] {
+            return space.entities()
+                .getComponentSlow<TransformComponent>(id)
+                ->interpolatedMatrix(space.interpolationAlpha())[3]
+                .x;
+        };
+        CHECK(interpolatedX() == 0.f);
+
+        space.entities().getMut<TransformComponent>(id)->position.x = 4.f;
+        space.advance(0.375f);
+        CHECK(interpolatedX() == 2.f);
+
+        // once the transform stops changing, its previous matrix catches up
+        space.advance(0.25f);
+        CHECK(interpolatedX() == 4.f);
+
+        // new transforms don't move in from the origin
+        TransformComponent placed;
+        placed.position = {8.f, 0.f, 0.f};
+        EntityId const late = space.entities().createEntity(std::move(placed));
+        space.advance(0.25f);
+        CHECK(space.entities().getComponentSlow<TransformComponent>(late)->previousMatrix[3].x == 8.f);
+
+        space.stop();
+    }
+}
@@ -0,0 +1,125 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/game/components/transform_component.h"
+#include "potato/game/transform_batch.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <glm/gtx/transform.hpp>
+#include <random>
+#include <string>
+
+namespace {
+    struct TransformSet {
+        up::vector<glm::vec3> positions;
+        up::vector<glm::quat> rotations;
+        up::vector<glm::vec3> scales;
+    };
+
+    TransformSet makeTransforms(std::size_t count) {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> offset(-100.f, 100.f);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        std::uniform_real_distribution<float> angle(-6.f, 6.f);
+        std::uniform_real_distribution<float> scale(0.1f, 4.f);
+
+        TransformSet set;
+        for (std::size_t index = 0; index != count; ++index) {
+            set.positions.push_back({offset(random), offset(random), offset(random)});
+            set.rotations.push_back(
+                glm::angleAxis(angle(random), glm::normalize(glm::vec3{unit(random), unit(random), 0.5f})));
+            // non-uniform, and mirrored along x for every third transform
+            set.scales.push_back({(index % 3 == 0 ? -1.f : 1.f) * scale(random), scale(random), scale(random)});
+        }
+        return set;
+    }
+
+    glm::mat4x4 glmCompose(glm::vec3 position, glm::quat rotation, glm::vec3 scale) {
+        return glm::translate(position) * glm::mat4_cast(rotation) * glm::scale(scale);
+    }
+
+    bool approxEqual(glm::mat4x4 const& lhs, glm::mat4x4 const& rhs) {
+        for (int column = 0; column != 4; ++column) {
+            for (int row = 0; row != 4; ++row) {
+                if (lhs[column][row] != Approx(rhs[column][row]).margin(1e-4)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+} // namespace
+
+TEST_CASE("potato.game.TransformBatch", "[potato][game]") {
+    using namespace up;
+
+    SECTION("identity") {
+        glm::mat4x4 const matrix = composeMatrix({0, 0, 0}, glm::identity<glm::quat>(), {1, 1, 1});
+        CHECK(approxEqual(matrix, glm::mat4x4(1.f)));
+    }
+
+    SECTION("matches glm") {
+        // odd sizes leave a partial block for the scalar tail
+        for (std::size_t const count : {0, 1, 3, 4, 7, 8, 9, 17, 1000}) {
+            TransformSet const set = makeTransforms(count);
+
+            vector<glm::mat4x4> batch(count);
+            vector<glm::mat4x4> scalar(count);
+            composeMatrices(set.positions, set.rotations, set.scales, batch);
+            composeMatricesScalar(set.positions, set.rotations, set.scales, scalar);
+
+            bool matches = true;
+            for (std::size_t index = 0; index != count; ++index) {
+                glm::mat4x4 const expected = glmCompose(set.positions[index], set.rotations[index], set.scales[index]);
+                matches = matches && approxEqual(batch[index], expected) && approxEqual(scalar[index], expected);
+            }
+            CHECK(matches);
+        }
+    }
+
+    SECTION("components") {
+        TransformSet const set = makeTransforms(11);
+
+        vector<TransformComponent> components(set.positions.size());
+        vector<TransformComponent*> pointers;
+        for (std::size_t index = 0; index != components.size(); ++index) {
+            components[index].position = set.positions[index];
+            components[index].rotation = set.rotations[index];
+            components[index].scale = set.scales[index].y;
+            pointers.push_back(&components[index]);
+        }
+
+        composeLocalMatrices(pointers);
+
+        bool matches = true;
+        for (TransformComponent const& trans : components) {
+            glm::mat4x4 const expected = glmCompose(trans.position, trans.rotation, glm::vec3(trans.scale));
+            matches = matches && approxEqual(trans.matrix, expected);
+        }
+        CHECK(matches);
+    }
+}
+
+TEST_CASE("potato.game.TransformBatch.benchmark", "[.][benchmark]") {
+    using namespace up;
+
+    for (std::size_t const count : {10'000, 100'000, 1'000'000}) {
+        TransformSet const set = makeTransforms(count);
+        vector<glm::mat4x4> matrices(count);
+
+        BENCHMARK("glm " + std::to_string(count)) {
+            for (std::size_t index = 0; index != count; ++index) {
+                matrices[index] = glmCompose(set.positions[index], set.rotations[index], set.scales[index]);
+            }
+            return matrices[0][0][0];
+        };
+        BENCHMARK("scalar " + std::to_string(count)) {
+            composeMatricesScalar(set.positions, set.rotations, set.scales, matrices);
+            return matrices[0][0][0];
+        };
+        BENCHMARK("batch " + std::to_string(count)) {
+            composeMatrices(set.positions, set.rotations, set.scales, matrices);
+            return matrices[0][0][0];
+        };
+    }
+}
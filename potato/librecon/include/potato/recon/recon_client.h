@@ -19,7 +19,7 @@ namespace up {
         void UP_RECON_API stop();
 
     private:
-        IOStream& sink() override { return _sink; }
+        void writeFrame(view<char> frame) override { _sink.write(frame); }
 
         IOProcess _process;
         IOStream _sink;
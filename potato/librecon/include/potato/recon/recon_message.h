@@ -12,6 +12,11 @@ namespace up {
         typename T::type;
     };
 
+    struct ReconHelloMessage {
+        static constexpr string_view name = "HELLO"_sv;
+        using type = schema::ReconHelloMessage;
+    };
+
     struct ReconLogMessage {
         static constexpr string_view name = "LOG"_sv;
         using type = schema::ReconLogMessage;
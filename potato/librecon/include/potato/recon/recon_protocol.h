@@ -7,15 +7,32 @@
 
 #include "potato/reflex/schema.h"
 #include "potato/reflex/serialize.h"
+#include "potato/spud/box.h"
 #include "potato/spud/delegate.h"
-
-#include <nlohmann/json.hpp>
+#include "potato/spud/hash.h"
+#include "potato/spud/hash_map.h"
+#include "potato/spud/utility.h"
+#include "potato/spud/vector.h"
 
 namespace up {
-    class IOStream;
-
+    /// Framed message protocol shared by the recon client and server.
+    ///
+    /// Each frame is a block of `Name: value` headers followed by a blank line
+    /// and a body of `Content-Length` bytes. Bodies are JSON unless a
+    /// `Content-Encoding: binary` header is present, in which case they hold
+    /// the message's fields packed by reflex::encodeToBinary. The binary
+    /// encoding is only sent once both peers have advertised support for it
+    /// via ReconHelloMessage.
     class ReconProtocol {
     public:
+        /// Revision of the packed binary body layout; peers with different
+        /// revisions fall back to JSON.
+        static constexpr int binaryVersion = 1;
+
+        /// Frames declaring a larger body are skipped as they arrive rather than
+        /// buffered.
+        static constexpr size_t maxBodyLength = 16 * 1024 * 1024;
+
         template <ReconMessage MessageT>
         using Callback = delegate<void(typename MessageT::type const&)>;
 
@@ -26,44 +43,63 @@ namespace up {
 
         template <ReconMessage MessageT>
         void on(Callback<MessageT> callback) {
-            _handlers.push_back(new_box<Handler<MessageT>>(move(callback)));
+            _addHandler(MessageT::name, new_box<Handler<MessageT>>(move(callback)));
         }
 
+        /// Whether binary bodies may be negotiated; must be set before the
+        /// hello exchange.
+        void enableBinary(bool enabled) noexcept { _binaryEnabled = enabled; }
+        bool isBinaryActive() const noexcept { return _binaryActive; }
+
     protected:
-        ReconProtocol() = default;
+        UP_RECON_API ReconProtocol();
         ~ReconProtocol() = default;
 
-        virtual IOStream& sink() = 0;
+        ReconProtocol(ReconProtocol const&) = delete;
+        ReconProtocol& operator=(ReconProtocol const&) = delete;
+
+        /// Sends one complete frame to the peer.
+        virtual void writeFrame(view<char> frame) = 0;
 
         UP_RECON_API bool receive(view<char> data);
 
+        /// Advertises this end's supported body encodings to the peer.
+        UP_RECON_API bool sendHello();
+
     private:
         struct HandlerBase;
         template <ReconMessage MessageT>
         struct Handler;
 
-        enum class DecodeState {
-            Ready,
-            Header,
-            Body,
+        enum class BodyEncoding {
+            Json,
+            Binary,
         };
 
         UP_RECON_API bool _send(string_view name, reflex::Schema const& schema, void const* object);
-        bool _handle(string_view message, view<char> body);
+        UP_RECON_API void _addHandler(string_view name, box<HandlerBase> handler);
+        size_t _decode(view<char> bytes, bool& handled);
+        bool _handle(string_view name, BodyEncoding encoding, view<char> body);
+        void _onHello(schema::ReconHelloMessage const& msg);
 
         vector<char> _buffer;
-        DecodeState _state = DecodeState::Ready;
-        char _headerMessageType[32] = {0};
-        size_t _headerContentLength = 0;
+        vector<char> _sendBuffer;
         vector<box<HandlerBase>> _handlers;
+        hash_map<uint64, int, identity> _handlerIndices;
+        size_t _skipLength = 0;
+        bool _binaryEnabled = true;
+        bool _binaryActive = false;
+        bool _helloSent = false;
     };
 
     struct ReconProtocol::HandlerBase {
         virtual ~HandlerBase() = default;
 
         virtual bool match(string_view nm) const noexcept = 0;
-        virtual bool handle(nlohmann::json const& data) = 0;
-        UP_RECON_API bool decode(nlohmann::json const& data, reflex::Schema const& schema, void* object);
+        virtual bool handle(BodyEncoding encoding, view<char> body) = 0;
+        UP_RECON_API bool decode(BodyEncoding encoding, view<char> body, reflex::Schema const& schema, void* object);
+
+        int next = -1;
     };
 
     template <ReconMessage MessageT>
@@ -74,9 +110,9 @@ namespace up {
 
         bool match(string_view name) const noexcept override { return name == MessageT::name; }
 
-        bool handle(nlohmann::json const& data) override {
+        bool handle(BodyEncoding encoding, view<char> body) override {
             typename MessageT::type msg;
-            if (!decode(data, schema, &msg)) {
+            if (!decode(encoding, body, schema, &msg)) {
                 return false;
             }
             callback(msg);
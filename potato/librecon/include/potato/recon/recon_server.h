@@ -23,7 +23,7 @@ namespace up::recon {
         UP_RECON_API void stop();
 
     private:
-        IOStream& sink() override { return _sink; }
+        void writeFrame(view<char> frame) override { _sink.write(frame); }
 
         Logger _logger;
         IOStream _sink;
@@ -38,6 +38,8 @@ bool up::ReconClient::start(IOLoop& loop, zstring_view resourcesPath) {
 
     _source.startRead([this](auto input) { receive(input); });
 
+    sendHello();
+
     s_logger.info("Started recon PID={}", _process.pid());
 
     return true;
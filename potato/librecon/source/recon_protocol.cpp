@@ -2,141 +2,246 @@
 
 #include "potato/recon/recon_protocol.h"
 
-#include "potato/runtime/io_loop.h"
 #include "potato/runtime/json.h"
 #include "potato/spud/find.h"
 
+#include <nanofmt/format.h>
+#include <nlohmann/json.hpp>
 #include <charconv>
+#include <cstring>
 
 static constexpr up::string_view headerMessageType{"Message-Type"};
 static constexpr up::string_view headerContentLength{"Content-Length"};
+static constexpr up::string_view headerContentEncoding{"Content-Encoding"};
+static constexpr up::string_view encodingBinary{"binary"};
+
+bool up::ReconProtocol::HandlerBase::decode(
+    BodyEncoding encoding,
+    view<char> body,
+    reflex::Schema const& schema,
+    void* object) {
+    if (encoding == BodyEncoding::Binary) {
+        return reflex::decodeFromBinaryRaw(body, schema, object);
+    }
+
+    nlohmann::json doc = nlohmann::json::parse(body, nullptr, false, true);
+    if (!doc.is_object()) {
+        return false;
+    }
+    return reflex::decodeFromJsonRaw(doc, schema, object);
+}
 
-bool up::ReconProtocol::HandlerBase::decode(nlohmann::json const& data, reflex::Schema const& schema, void* object) {
-    return reflex::decodeFromJsonRaw(data, schema, object);
+up::ReconProtocol::ReconProtocol() {
+    on<ReconHelloMessage>([this](schema::ReconHelloMessage const& msg) { _onHello(msg); });
 }
 
 bool up::ReconProtocol::receive(view<char> data) {
+    // the rest of an oversized body is dropped as it arrives
+    if (_skipLength != 0) {
+        size_t const skipped = _skipLength < data.size() ? _skipLength : data.size();
+        _skipLength -= skipped;
+        data = data.subspan(skipped);
+    }
+
     if (data.empty()) {
         return false;
     }
 
-    _buffer.insert(_buffer.end(), data.begin(), data.end());
-
-    size_t consumed = 0;
-    bool work = true;
     bool handled = false;
-    while (work && consumed < _buffer.size()) {
-        view<char> const bytes{_buffer.cbegin() + consumed, _buffer.cend()};
-
-        switch (_state) {
-            case DecodeState::Ready:
-                if (bytes.front() == '\n') {
-                    consumed += 1;
-                }
-                else {
-                    _state = DecodeState::Header;
-                }
 
-                break;
+    // complete frames are decoded straight out of the incoming data; only a
+    // trailing partial frame is copied aside until the rest of it arrives
+    if (_buffer.empty()) {
+        size_t const consumed = _decode(data, handled);
+        _buffer.insert(_buffer.end(), data.begin() + consumed, data.end());
+        return handled;
+    }
 
-            case DecodeState::Header:
-                if (bytes.front() == '\n') {
-                    consumed += 1;
-                    if (_headerContentLength > 0) {
-                        _state = DecodeState::Body;
-                    }
-                    else {
-                        _state = DecodeState::Ready;
-                    }
-                    break;
-                }
-
-                if (auto nl = find(bytes, '\n'); nl != bytes.end()) {
-                    consumed += nl - bytes.begin() + 1 /*NL*/;
-
-                    string_view const line{bytes.begin(), nl};
-
-                    auto const sep = line.find(':');
-                    if (sep == string_view::npos) {
-                        continue;
-                    }
-
-                    string_view const headerName{bytes.begin(), sep};
-                    string_view headerData = line.substr(sep + 1);
-                    if (!headerData.empty() && headerData.front() == ' ') {
-                        headerData.pop_front();
-                    }
-
-                    if (headerName == headerMessageType) {
-                        nanofmt::format_to(_headerMessageType, "{}", headerData);
-                    }
-                    else if (headerName == headerContentLength) {
-                        std::from_chars(headerData.data(), headerData.data() + headerData.size(), _headerContentLength);
-                    }
-                }
-                else {
-                    work = false;
-                }
+    _buffer.insert(_buffer.end(), data.begin(), data.end());
 
-                break;
+    size_t const consumed = _decode(_buffer, handled);
+    if (consumed == _buffer.size()) {
+        _buffer.clear();
+    }
+    else if (consumed != 0) {
+        _buffer.erase(_buffer.begin(), _buffer.begin() + consumed);
+    }
 
-            case DecodeState::Body:
-                if (bytes.size() >= _headerContentLength) {
-                    if (_headerMessageType[0] != '\0') {
-                        handled |= _handle(_headerMessageType, {bytes.data(), _headerContentLength});
-                    }
-                    consumed += _headerContentLength;
+    return handled;
+}
 
-                    _headerMessageType[0] = '\0';
-                    _headerContentLength = 0;
+bool up::ReconProtocol::sendHello() {
+    _helloSent = true;
+    _binaryActive = false;
+    return send<ReconHelloMessage>({.version = binaryVersion, .binary = _binaryEnabled});
+}
+
+size_t up::ReconProtocol::_decode(view<char> bytes, bool& handled) {
+    size_t consumed = 0;
+    while (consumed < bytes.size()) {
+        view<char> const frame = bytes.subspan(consumed);
 
-                    _state = DecodeState::Ready;
-                }
-                else {
-                    work = false;
-                }
+        // frames may be separated by blank lines
+        if (frame.front() == '\n') {
+            ++consumed;
+            continue;
+        }
 
+        string_view messageType;
+        size_t contentLength = 0;
+        BodyEncoding encoding = BodyEncoding::Json;
+
+        // headers are parsed in place; nothing is consumed until the whole
+        // frame is available
+        size_t headerLength = 0;
+        for (;;) {
+            view<char> const rest = frame.subspan(headerLength);
+            auto const nl = find(rest, '\n');
+            if (nl == rest.end()) {
+                return consumed;
+            }
+
+            string_view const line{rest.begin(), nl};
+            headerLength += line.size() + 1 /*NL*/;
+            if (line.empty()) {
                 break;
+            }
+
+            auto const sep = line.find(':');
+            if (sep == string_view::npos) {
+                continue;
+            }
+
+            string_view const headerName = line.substr(0, sep);
+            string_view headerData = line.substr(sep + 1);
+            if (!headerData.empty() && headerData.front() == ' ') {
+                headerData.pop_front();
+            }
+
+            if (headerName == headerMessageType) {
+                messageType = headerData;
+            }
+            else if (headerName == headerContentLength) {
+                std::from_chars(headerData.data(), headerData.data() + headerData.size(), contentLength);
+            }
+            else if (headerName == headerContentEncoding) {
+                encoding = headerData == encodingBinary ? BodyEncoding::Binary : BodyEncoding::Json;
+            }
         }
-    }
 
-    _buffer.erase(_buffer.begin(), _buffer.begin() + consumed);
+        if (contentLength > maxBodyLength) {
+            // too large to buffer; skip the body and resume at the frame after it
+            size_t const available = frame.size() - headerLength;
+            size_t const skipped = available < contentLength ? available : contentLength;
+            _skipLength = contentLength - skipped;
+            consumed += headerLength + skipped;
+            continue;
+        }
 
-    return handled;
-}
+        if (frame.size() - headerLength < contentLength) {
+            return consumed;
+        }
 
-bool up::ReconProtocol::_send(string_view name, reflex::Schema const& schema, void const* object) {
-    nlohmann::json doc;
-    if (!reflex::encodeToJsonRaw(doc, schema, object)) {
-        return false;
+        if (!messageType.empty()) {
+            handled |= _handle(messageType, encoding, frame.subspan(headerLength, contentLength));
+        }
+        consumed += headerLength + contentLength;
     }
 
-    auto const str = doc.dump();
+    return consumed;
+}
 
+bool up::ReconProtocol::_send(string_view name, reflex::Schema const& schema, void const* object) {
+    bool const binary = _binaryActive;
+
+    // the body is encoded after a placeholder for the headers, which are then
+    // written into place so the whole frame goes out in a single write
     char headersBuf[128] = {0};
-    char const* const headersEnd =
-        nanofmt::format_to(headersBuf, "{}: {}\n{}: {}\n\n", headerMessageType, name, headerContentLength, str.size());
+    size_t const reserved = sizeof(headersBuf);
 
-    IOStream& ioSink = sink();
+    _sendBuffer.clear();
+    _sendBuffer.resize(reserved);
 
-    ioSink.write({headersBuf, static_cast<size_t>(headersEnd - headersBuf)});
-    ioSink.write({str.data(), str.size()});
-    ioSink.write({"\n", 1});
+    if (binary) {
+        if (!reflex::encodeToBinaryRaw(_sendBuffer, schema, object)) {
+            return false;
+        }
+    }
+    else {
+        nlohmann::json doc;
+        if (!reflex::encodeToJsonRaw(doc, schema, object)) {
+            return false;
+        }
+        auto const str = doc.dump();
+        _sendBuffer.insert(_sendBuffer.end(), str.data(), str.data() + str.size());
+    }
+    _sendBuffer.push_back('\n');
+
+    size_t const bodyLength = _sendBuffer.size() - reserved - 1 /*NL*/;
+
+    char const* const headersEnd = binary ? nanofmt::format_to(
+                                                headersBuf,
+                                                "{}: {}\n{}: {}\n{}: {}\n\n",
+                                                headerMessageType,
+                                                name,
+                                                headerContentEncoding,
+                                                encodingBinary,
+                                                headerContentLength,
+                                                bodyLength)
+                                          : nanofmt::format_to(
+                                                headersBuf,
+                                                "{}: {}\n{}: {}\n\n",
+                                                headerMessageType,
+                                                name,
+                                                headerContentLength,
+                                                bodyLength);
+    auto const headersLength = static_cast<size_t>(headersEnd - headersBuf);
+
+    char* const frame = _sendBuffer.data() + reserved - headersLength;
+    std::memcpy(frame, headersBuf, headersLength);
+
+    writeFrame({frame, headersLength + bodyLength + 1 /*NL*/});
     return true;
 }
 
-bool up::ReconProtocol::_handle(string_view message, view<char> body) {
-    nlohmann::json doc = nlohmann::json::parse(body, nullptr, false, true);
-    if (!doc.is_object()) {
+void up::ReconProtocol::_addHandler(string_view name, box<HandlerBase> handler) {
+    int const index = static_cast<int>(_handlers.size());
+    _handlers.push_back(std::move(handler));
+
+    uint64 const hash = hash_value(name);
+    if (auto const found = _handlerIndices.find(hash)) {
+        int tail = found->value;
+        while (_handlers[tail]->next != -1) {
+            tail = _handlers[tail]->next;
+        }
+        _handlers[tail]->next = index;
+    }
+    else {
+        _handlerIndices.insert(hash, index);
+    }
+}
+
+bool up::ReconProtocol::_handle(string_view name, BodyEncoding encoding, view<char> body) {
+    auto const found = _handlerIndices.find(hash_value(name));
+    if (!found) {
         return false;
     }
 
     bool handled = false;
-    for (auto const& handler : _handlers) {
-        if (handler->match(message)) {
-            handled |= handler->handle(doc);
+    for (int index = found->value; index != -1; index = _handlers[index]->next) {
+        if (_handlers[index]->match(name)) {
+            handled |= _handlers[index]->handle(encoding, body);
         }
     }
 
     return handled;
 }
+
+void up::ReconProtocol::_onHello(schema::ReconHelloMessage const& msg) {
+    // the peer that did not initiate the exchange answers with its own hello
+    if (!_helloSent) {
+        sendHello();
+    }
+
+    _binaryActive = _binaryEnabled && msg.binary && msg.version == binaryVersion;
+}
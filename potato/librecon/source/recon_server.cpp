@@ -17,7 +17,7 @@ bool up::recon::ReconServer::start(IOLoop& loop) {
 
     _source.startRead([this](span<char> input) {
         if (!receive(input)) {
-            _logger.error("Unhandled JSON message");
+            _logger.error("Unhandled message");
         }
     });
 
@@ -0,0 +1,123 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/recon/recon_protocol.h"
+#include "potato/spud/string.h"
+#include "potato/spud/string_writer.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <string_view>
+
+namespace {
+    // collects sent frames instead of writing them to a pipe
+    class TestPeer : public up::ReconProtocol {
+    public:
+        using ReconProtocol::receive;
+        using ReconProtocol::sendHello;
+
+        bool receiveText(up::string_view text) { return receive({text.data(), text.size()}); }
+
+        up::string_view sentText() const noexcept { return {sent.data(), sent.size()}; }
+
+        bool sentBinary() const noexcept {
+            return std::string_view{sent.data(), sent.size()}.find("Content-Encoding: binary") != std::string_view::npos;
+        }
+
+        up::vector<char> sent;
+
+    private:
+        void writeFrame(up::view<char> frame) override { sent.insert(sent.end(), frame.begin(), frame.end()); }
+    };
+} // namespace
+
+TEST_CASE("potato.recon.ReconProtocol", "[potato][recon]") {
+    using namespace up;
+
+    TestPeer sender;
+    TestPeer receiver;
+
+    vector<string> messages;
+    receiver.on<ReconManifestMessage>(
+        [&messages](schema::ReconManifestMessage const& msg) { messages.push_back(msg.path); });
+
+    SECTION("frames split across reads are reassembled") {
+        REQUIRE(sender.send<ReconManifestMessage>({.path = "first"_s}));
+        REQUIRE(sender.send<ReconManifestMessage>({.path = "second"_s}));
+
+        // one byte at a time, then both frames in a single read
+        int handled = 0;
+        for (char const& ch : sender.sent) {
+            handled += receiver.receive({&ch, 1}) ? 1 : 0;
+        }
+        CHECK(handled == 2);
+        CHECK(receiver.receive(sender.sent));
+
+        REQUIRE(messages.size() == 4);
+        CHECK(messages[0] == "first");
+        CHECK(messages[1] == "second");
+        CHECK(messages[3] == "second");
+    }
+
+    SECTION("oversized frames are skipped") {
+        string_writer header;
+        header.format("Message-Type: MANIFEST\nContent-Length: {}\n\n", ReconProtocol::maxBodyLength + 1);
+        CHECK_FALSE(receiver.receiveText(header));
+
+        // the body would decode to a message if it were buffered
+        string_view const body = R"({"path":"oversized"})";
+        CHECK_FALSE(receiver.receiveText(body));
+
+        vector<char> const chunk(64 * 1024, ' ');
+        for (size_t remaining = ReconProtocol::maxBodyLength + 1 - body.size(); remaining != 0;) {
+            size_t const length = remaining < chunk.size() ? remaining : chunk.size();
+            CHECK_FALSE(receiver.receive({chunk.data(), length}));
+            remaining -= length;
+        }
+
+        // the next frame is decoded as usual
+        REQUIRE(sender.send<ReconManifestMessage>({.path = "after"_s}));
+        CHECK(receiver.receive(sender.sent));
+        REQUIRE(messages.size() == 1);
+        CHECK(messages[0] == "after");
+    }
+
+    SECTION("unknown messages are ignored") {
+        CHECK_FALSE(receiver.receiveText("Message-Type: UNKNOWN\nContent-Length: 2\n\n{}\n"));
+
+        REQUIRE(sender.send<ReconManifestMessage>({.path = "known"_s}));
+        string_writer text;
+        text.append("Message-Type: UNKNOWN\nContent-Length: 2\n\n{}\n");
+        text.append(sender.sentText());
+        CHECK(receiver.receiveText(text));
+        REQUIRE(messages.size() == 1);
+        CHECK(messages[0] == "known");
+    }
+
+    SECTION("hello negotiates binary bodies") {
+        REQUIRE(sender.sendHello());
+        CHECK(receiver.receive(sender.sent));
+        CHECK(receiver.isBinaryActive());
+
+        // the receiver answers with its own hello
+        CHECK(sender.receive(receiver.sent));
+        CHECK(sender.isBinaryActive());
+
+        sender.sent.clear();
+        REQUIRE(sender.send<ReconManifestMessage>({.path = "binary"_s}));
+        CHECK(sender.sentBinary());
+        CHECK(receiver.receive(sender.sent));
+        REQUIRE(messages.size() == 1);
+        CHECK(messages[0] == "binary");
+    }
+
+    SECTION("hello with a different binary version falls back to json") {
+        REQUIRE(sender.send<ReconHelloMessage>({.version = ReconProtocol::binaryVersion + 1, .binary = true}));
+        CHECK(receiver.receive(sender.sent));
+        CHECK_FALSE(receiver.isBinaryActive());
+        CHECK_FALSE(receiver.sent.empty());
+
+        receiver.sent.clear();
+        REQUIRE(receiver.send<ReconManifestMessage>({.path = "json"_s}));
+        CHECK_FALSE(receiver.sentBinary());
+    }
+}
@@ -18,6 +18,24 @@ namespace up::reflex {
         return decodeFromJsonRaw(json, getSchema<T>(), &reinterpret_cast<char&>(value));
     }
 
+    template <has_schema T>
+    bool encodeToBinary(vector<char>& out, T const& value) {
+        return encodeToBinaryRaw(out, getSchema<T>(), &reinterpret_cast<char const&>(value));
+    }
+
+    template <has_schema T>
+    bool decodeFromBinary(view<char> data, T& value) {
+        return decodeFromBinaryRaw(data, getSchema<T>(), &reinterpret_cast<char&>(value));
+    }
+
     UP_REFLEX_API bool encodeToJsonRaw(nlohmann::json& json, Schema const& schema, void const* memory);
     UP_REFLEX_API bool decodeFromJsonRaw(nlohmann::json const& json, Schema const& schema, void* memory);
+
+    /// Packed binary encoding.
+    ///
+    /// Fields are written in schema order without names, so both ends must
+    /// agree on the schema. Encoded data is appended to out; decoding fails if
+    /// data is truncated or has trailing bytes.
+    UP_REFLEX_API bool encodeToBinaryRaw(vector<char>& out, Schema const& schema, void const* memory);
+    UP_REFLEX_API bool decodeFromBinaryRaw(view<char> data, Schema const& schema, void* memory);
 } // namespace up::reflex
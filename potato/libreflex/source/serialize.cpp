@@ -12,6 +12,7 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <nlohmann/json.hpp>
+#include <cstring>
 
 namespace up::reflex::_detail {
     static bool encodeObject(nlohmann::json& json, Schema const& schema, void const* obj);
@@ -28,6 +29,20 @@ namespace up::reflex::_detail {
 
     static int64 readInt(Schema const& schema, void const* obj);
     static void writeInt(Schema const& schema, void* obj, int64 value);
+
+    struct BinaryReader {
+        char const* pos = nullptr;
+        char const* end = nullptr;
+
+        bool read(void* dest, size_t size) noexcept;
+        bool readSize(size_t& size) noexcept;
+    };
+
+    static void writeBytes(vector<char>& out, void const* bytes, size_t size);
+    static void writeSize(vector<char>& out, size_t size);
+
+    static bool encodeBinaryValue(vector<char>& out, Schema const& schema, void const* obj);
+    static bool decodeBinaryValue(BinaryReader& in, Schema const& schema, void* obj);
 } // namespace up::reflex::_detail
 
 bool up::reflex::encodeToJsonRaw(nlohmann::json& json, Schema const& schema, void const* memory) {
@@ -40,6 +55,17 @@ bool up::reflex::decodeFromJsonRaw(nlohmann::json const& json, Schema const& sch
     return _detail::decodeValue(json, schema, memory);
 }
 
+bool up::reflex::encodeToBinaryRaw(vector<char>& out, Schema const& schema, void const* memory) {
+    UP_ASSERT(memory != nullptr);
+    return _detail::encodeBinaryValue(out, schema, memory);
+}
+
+bool up::reflex::decodeFromBinaryRaw(view<char> data, Schema const& schema, void* memory) {
+    UP_ASSERT(memory != nullptr);
+    _detail::BinaryReader in{.pos = data.data(), .end = data.data() + data.size()};
+    return _detail::decodeBinaryValue(in, schema, memory) && in.pos == in.end;
+}
+
 bool up::reflex::_detail::encodeObject(nlohmann::json& json, Schema const& schema, void const* obj) {
     UP_ASSERT(schema.primitive == SchemaPrimitive::Object);
 
@@ -407,3 +433,255 @@ void up::reflex::_detail::writeInt(Schema const& schema, void* obj, int64 value)
             break;
     }
 }
+
+bool up::reflex::_detail::BinaryReader::read(void* dest, size_t size) noexcept {
+    if (static_cast<size_t>(end - pos) < size) {
+        return false;
+    }
+    std::memcpy(dest, pos, size);
+    pos += size;
+    return true;
+}
+
+bool up::reflex::_detail::BinaryReader::readSize(size_t& size) noexcept {
+    // LEB128
+    size = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos == end) {
+            return false;
+        }
+        auto const byte = static_cast<uint8>(*pos++);
+        size |= static_cast<size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void up::reflex::_detail::writeBytes(vector<char>& out, void const* bytes, size_t size) {
+    auto const* const first = static_cast<char const*>(bytes);
+    out.insert(out.end(), first, first + size);
+}
+
+void up::reflex::_detail::writeSize(vector<char>& out, size_t size) {
+    // LEB128
+    do {
+        auto byte = static_cast<uint8>(size & 0x7f);
+        size >>= 7;
+        if (size != 0) {
+            byte |= 0x80;
+        }
+        out.push_back(static_cast<char>(byte));
+    } while (size != 0);
+}
+
+template <typename T>
+static void encodeBinarySimple(up::vector<char>& out, void const* obj) {
+    up::reflex::_detail::writeBytes(out, obj, sizeof(T));
+}
+
+template <typename T>
+static bool decodeBinarySimple(up::reflex::_detail::BinaryReader& in, void* obj) {
+    return in.read(obj, sizeof(T));
+}
+
+bool up::reflex::_detail::encodeBinaryValue(vector<char>& out, Schema const& schema, void const* obj) {
+    switch (schema.primitive) {
+        case SchemaPrimitive::Bool:
+            out.push_back(*static_cast<bool const*>(obj) ? 1 : 0);
+            return true;
+        case SchemaPrimitive::Int8:
+        case SchemaPrimitive::UInt8:
+            encodeBinarySimple<uint8>(out, obj);
+            return true;
+        case SchemaPrimitive::Int16:
+        case SchemaPrimitive::UInt16:
+            encodeBinarySimple<uint16>(out, obj);
+            return true;
+        case SchemaPrimitive::Int32:
+        case SchemaPrimitive::UInt32:
+            encodeBinarySimple<uint32>(out, obj);
+            return true;
+        case SchemaPrimitive::Int64:
+        case SchemaPrimitive::UInt64:
+            encodeBinarySimple<uint64>(out, obj);
+            return true;
+        case SchemaPrimitive::Vec3:
+            encodeBinarySimple<glm::vec3>(out, obj);
+            return true;
+        case SchemaPrimitive::Float:
+            encodeBinarySimple<float>(out, obj);
+            return true;
+        case SchemaPrimitive::Double:
+            encodeBinarySimple<double>(out, obj);
+            return true;
+        case SchemaPrimitive::Enum: {
+            int64 const value = readInt(*schema.elementType, obj);
+            writeBytes(out, &value, sizeof(value));
+            return true;
+        }
+        case SchemaPrimitive::String: {
+            auto const& str = *static_cast<string const*>(obj);
+            writeSize(out, str.size());
+            writeBytes(out, str.data(), str.size());
+            return true;
+        }
+        case SchemaPrimitive::Pointer:
+            if (schema.operations->pointerDeref != nullptr) {
+                if (void const* pointee = schema.operations->pointerDeref(obj)) {
+                    out.push_back(1);
+                    return encodeBinaryValue(out, *schema.elementType, pointee);
+                }
+                out.push_back(0);
+                return true;
+            }
+            return false;
+        case SchemaPrimitive::Array: {
+            if (schema.operations->arrayGetSize == nullptr || schema.operations->arrayElementAt == nullptr) {
+                return false;
+            }
+            bool success = true;
+            size_t const size = schema.operations->arrayGetSize(obj);
+            writeSize(out, size);
+            for (size_t index = 0; index != size; ++index) {
+                void const* elem = schema.operations->arrayElementAt(obj, index);
+                success = encodeBinaryValue(out, *schema.elementType, elem) && success;
+            }
+            return success;
+        }
+        case SchemaPrimitive::Object: {
+            bool success = true;
+            for (SchemaField const& field : schema.fields) {
+                success =
+                    encodeBinaryValue(out, *field.schema, static_cast<char const*>(obj) + field.offset) && success;
+            }
+            return success;
+        }
+        case SchemaPrimitive::AssetRef: {
+            AssetKey const& key = static_cast<UntypedAssetHandle const*>(obj)->assetKey();
+            writeBytes(out, key.uuid.bytes(), UUID::octects);
+            writeSize(out, key.logical.size());
+            writeBytes(out, key.logical.data(), key.logical.size());
+            return true;
+        }
+        case SchemaPrimitive::Uuid:
+            writeBytes(out, static_cast<UUID const*>(obj)->bytes(), UUID::octects);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool up::reflex::_detail::decodeBinaryValue(BinaryReader& in, Schema const& schema, void* obj) {
+    switch (schema.primitive) {
+        case SchemaPrimitive::Bool: {
+            uint8 value = 0;
+            if (!in.read(&value, sizeof(value))) {
+                return false;
+            }
+            *static_cast<bool*>(obj) = value != 0;
+            return true;
+        }
+        case SchemaPrimitive::Int8:
+        case SchemaPrimitive::UInt8:
+            return decodeBinarySimple<uint8>(in, obj);
+        case SchemaPrimitive::Int16:
+        case SchemaPrimitive::UInt16:
+            return decodeBinarySimple<uint16>(in, obj);
+        case SchemaPrimitive::Int32:
+        case SchemaPrimitive::UInt32:
+            return decodeBinarySimple<uint32>(in, obj);
+        case SchemaPrimitive::Int64:
+        case SchemaPrimitive::UInt64:
+            return decodeBinarySimple<uint64>(in, obj);
+        case SchemaPrimitive::Vec3:
+            return decodeBinarySimple<glm::vec3>(in, obj);
+        case SchemaPrimitive::Float:
+            return decodeBinarySimple<float>(in, obj);
+        case SchemaPrimitive::Double:
+            return decodeBinarySimple<double>(in, obj);
+        case SchemaPrimitive::Enum: {
+            int64 value = 0;
+            if (!in.read(&value, sizeof(value))) {
+                return false;
+            }
+            writeInt(*schema.elementType, obj, value);
+            return true;
+        }
+        case SchemaPrimitive::String: {
+            size_t size = 0;
+            if (!in.readSize(size) || static_cast<size_t>(in.end - in.pos) < size) {
+                return false;
+            }
+            *static_cast<string*>(obj) = string{in.pos, size};
+            in.pos += size;
+            return true;
+        }
+        case SchemaPrimitive::Pointer: {
+            uint8 present = 0;
+            if (!in.read(&present, sizeof(present))) {
+                return false;
+            }
+            if (present == 0 && schema.operations->pointerAssign != nullptr) {
+                schema.operations->pointerAssign(obj, nullptr);
+                return true;
+            }
+            if (present != 0 && schema.operations->pointerMutableDeref != nullptr) {
+                if (void* pointee = schema.operations->pointerMutableDeref(obj)) {
+                    return decodeBinaryValue(in, *schema.elementType, pointee);
+                }
+            }
+            return false;
+        }
+        case SchemaPrimitive::Array: {
+            if (schema.operations->arrayResize == nullptr || schema.operations->arrayMutableElementAt == nullptr) {
+                return false;
+            }
+            size_t size = 0;
+            // every element occupies at least one byte, which bounds the resize on malformed input
+            if (!in.readSize(size) || static_cast<size_t>(in.end - in.pos) < size) {
+                return false;
+            }
+            schema.operations->arrayResize(obj, size);
+            for (size_t index = 0; index != size; ++index) {
+                void* el = schema.operations->arrayMutableElementAt(obj, index);
+                if (!decodeBinaryValue(in, *schema.elementType, el)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case SchemaPrimitive::Object:
+            for (SchemaField const& field : schema.fields) {
+                if (!decodeBinaryValue(in, *field.schema, static_cast<char*>(obj) + field.offset)) {
+                    return false;
+                }
+            }
+            return true;
+        case SchemaPrimitive::AssetRef: {
+            UUID::Bytes bytes = {};
+            size_t size = 0;
+            if (!in.read(bytes, sizeof(bytes)) || !in.readSize(size) || static_cast<size_t>(in.end - in.pos) < size) {
+                return false;
+            }
+            AssetKey key;
+            key.uuid = UUID{bytes};
+            key.logical = string{in.pos, size};
+            in.pos += size;
+            *static_cast<UntypedAssetHandle*>(obj) =
+                key.uuid.isValid() ? UntypedAssetHandle(std::move(key)) : UntypedAssetHandle();
+            return true;
+        }
+        case SchemaPrimitive::Uuid: {
+            UUID::Bytes bytes = {};
+            if (!in.read(bytes, sizeof(bytes))) {
+                return false;
+            }
+            *static_cast<UUID*>(obj) = UUID{bytes};
+            return true;
+        }
+        default:
+            return false;
+    }
+}
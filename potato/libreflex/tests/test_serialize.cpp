@@ -49,4 +49,39 @@ TEST_CASE("potato.reflex.Serialize", "[potato][reflex]") {
         CHECK(comp.values[2] == 6'000'000'000.f);
         CHECK(comp.test.test == TestEnum::Second);
     }
+
+    SECTION("binary round trip") {
+        TestComplex comp;
+        comp.name = "Frederick"_s;
+        comp.values.push_back(42.f);
+        comp.values.push_back(-7.f);
+        comp.test.test = TestEnum::Third;
+
+        vector<char> data;
+        CHECK(reflex::encodeToBinary(data, comp));
+
+        TestComplex result;
+        CHECK(reflex::decodeFromBinary(data, result));
+
+        CHECK(result.name == "Frederick"_s);
+        REQUIRE(result.values.size() == 2);
+        CHECK(result.values[0] == 42.f);
+        CHECK(result.values[1] == -7.f);
+        CHECK(result.test.test == TestEnum::Third);
+    }
+
+    SECTION("binary decode malformed") {
+        TestComplex comp;
+        comp.name = "Frederick"_s;
+        comp.values.push_back(42.f);
+
+        vector<char> data;
+        CHECK(reflex::encodeToBinary(data, comp));
+
+        TestComplex result;
+        CHECK_FALSE(reflex::decodeFromBinary(view<char>{data.data(), data.size() - 1}, result));
+
+        data.push_back(0);
+        CHECK_FALSE(reflex::decodeFromBinary(data, result));
+    }
 }
@@ -88,6 +88,12 @@ namespace up {
                 return new_shared<Texture>(ctx.key, std::move(tex), std::move(srv));
             }
 
+            uint64 estimateSize(Asset const& asset, [[maybe_unused]] uint64 contentSize) const noexcept override {
+                // images are decoded to four channels, so the compressed content says little
+                glm::ivec3 const size = static_cast<Texture const&>(asset).texture().dimensions();
+                return static_cast<uint64>(size.x) * static_cast<uint64>(size.y) * 4;
+            }
+
         private:
             GpuDevice& _device;
         };
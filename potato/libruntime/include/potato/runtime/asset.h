@@ -3,6 +3,7 @@
 #pragma once
 
 #include "assertion.h"
+#include "block_pool.h"
 #include "uuid.h"
 
 #include "potato/spud/hash.h"
@@ -34,7 +35,10 @@ namespace up {
         constexpr bool operator==(AssetKey const&) const noexcept = default;
     };
 
-    class Asset : public shared<Asset> {
+    /// Base of all loaded assets; instances are allocated from the BlockPool.
+    class Asset
+        : public shared<Asset>
+        , public PoolAllocated {
     public:
         explicit Asset(AssetKey key) noexcept : _key(std::move(key)) { }
 
@@ -49,12 +53,30 @@ namespace up {
         // only rely on this when the asset database is locked
         bool isDoomed() const noexcept { return _refs == 0; }
 
+        /// Estimated bytes of memory held by the asset, as reported by the backend
+        /// that loaded it.
+        uint64 sizeEstimate() const noexcept { return _sizeEstimate; }
+
+        /// The newest version of this asset; this asset itself unless AssetLoader
+        /// has since swapped in a reload of it.
+        Asset* current() noexcept {
+            Asset* asset = this;
+            while (asset->_replacement != nullptr) {
+                asset = asset->_replacement.get();
+            }
+            return asset;
+        }
+
     protected:
         virtual ~Asset() = default;
 
     private:
         mutable std::atomic<int> _refs = 1;
         AssetKey _key{};
+        rc<Asset> _replacement;
+        uint64 _sizeEstimate = 0;
+        /// Set while AssetLoader keeps the unreferenced asset in its retention cache.
+        bool _retained = false;
 
         friend class AssetLoader;
     };
@@ -93,7 +115,9 @@ namespace up {
         template <typename AssetT>
         [[nodiscard]] AssetHandle<AssetT> cast() && noexcept;
 
-        [[nodiscard]] Asset* asset() const noexcept { return _asset.get(); }
+        /// Resolves to the newest version of the asset, so that reloads are seen
+        /// by handles acquired before them.
+        [[nodiscard]] Asset* asset() const noexcept { return _asset != nullptr ? _asset->current() : nullptr; }
         [[nodiscard]] Asset* release() noexcept { return _asset.release(); }
 
     private:
@@ -0,0 +1,77 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "_export.h"
+#include "io_result.h"
+#include "stream.h"
+
+#include "potato/spud/int_types.h"
+#include "potato/spud/string.h"
+#include "potato/spud/vector.h"
+#include "potato/spud/zstring_view.h"
+
+namespace up {
+    /// @brief Single file holding many CAS blobs, for builds that ship without a library
+    ///
+    /// An archive is a header, an index of entries sorted by content hash, and the
+    /// blobs themselves, each starting on an alignment boundary. Blobs are read with
+    /// a seek and a single read, so a lookup costs no file opens.
+    class AssetArchive {
+    public:
+        /// Describes one blob; the index of these follows the header.
+        struct Entry {
+            uint64 hash = 0;
+            uint64 offset = 0;
+            uint64 size = 0;
+            uint32 flags = 0;
+            uint32 reserved = 0;
+        };
+
+        static constexpr uint64 alignment = 4096;
+
+        /// Entry flags understood by this reader; archives using any others are
+        /// rejected by open rather than misread.
+        static constexpr uint32 supportedFlags = 0;
+
+        UP_RUNTIME_API IOResult open(zstring_view path);
+        UP_RUNTIME_API IOResult open(Stream stream);
+        void close() noexcept {
+            _stream.close();
+            _entries.clear();
+        }
+
+        bool isOpen() const noexcept { return _stream.isOpen(); }
+
+        view<Entry> entries() const noexcept { return _entries; }
+        UP_RUNTIME_API Entry const* findEntry(uint64 contentHash) const noexcept;
+
+        /// Reads the blob of an entry; not safe to call from several threads at once.
+        UP_RUNTIME_API IOResult read(Entry const& entry, vector<byte>& out);
+
+    private:
+        Stream _stream;
+        vector<Entry> _entries;
+    };
+
+    /// @brief Builds an AssetArchive from loose CAS files
+    class AssetArchiveWriter {
+    public:
+        /// Adds the file at path as the blob for contentHash; later additions of
+        /// the same hash are ignored.
+        UP_RUNTIME_API void addFile(uint64 contentHash, string path, uint32 flags = 0);
+
+        auto size() const noexcept { return _sources.size(); }
+
+        UP_RUNTIME_API IOResult write(Stream& stream);
+
+    private:
+        struct Source {
+            uint64 hash = 0;
+            string path;
+            uint32 flags = 0;
+        };
+
+        vector<Source> _sources;
+    };
+} // namespace up
@@ -4,7 +4,11 @@
 
 #include "_export.h"
 #include "asset.h"
+#include "asset_archive.h"
 #include "logger.h"
+#include "name.h"
+#include "resource_manifest.h"
+#include "task_worker.h"
 #include "uuid.h"
 
 #include "potato/spud/box.h"
@@ -15,7 +19,6 @@
 namespace up {
     class Stream;
     class AssetLoader;
-    class ResourceManifest;
 
     struct AssetLoadContext {
         AssetKey key;
@@ -29,6 +32,27 @@ namespace up {
 
         virtual zstring_view typeName() const noexcept = 0;
         virtual rc<Asset> loadFromStream(AssetLoadContext const& ctx) = 0;
+
+        /// Estimates the bytes of memory held by an asset that was loaded from
+        /// contentSize bytes; used to budget the AssetLoader's retention cache.
+        virtual uint64 estimateSize([[maybe_unused]] Asset const& asset, uint64 contentSize) const noexcept {
+            return contentSize;
+        }
+    };
+
+    struct AssetCacheStats {
+        /// Assets that were found in the retention cache.
+        uint64 hits = 0;
+        /// Assets that had to be loaded because they were neither in use nor retained.
+        uint64 misses = 0;
+        /// Assets released from the retention cache to stay within its budget.
+        uint64 evictions = 0;
+        /// Estimated bytes held by the assets in the retention cache.
+        uint64 residentBytes = 0;
+
+        double hitRate() const noexcept {
+            return hits + misses != 0 ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+        }
     };
 
     class AssetLoader {
@@ -39,8 +63,16 @@ namespace up {
         ResourceManifest const* manifest() const noexcept { return _manifest.get(); }
         int manifestRevision() const noexcept { return _manifestRevision; }
 
+        /// Replaces the manifest. Loaded assets whose content hash differs in the
+        /// new manifest are reloaded: their content is read on a background
+        /// thread and swapped in by processReloads.
         UP_RUNTIME_API void bindManifest(box<ResourceManifest> manifest, string casPath);
 
+        /// Binds an archive to read content from before falling back to the loose
+        /// CAS files; pass nullptr to unbind it.
+        void bindArchive(box<AssetArchive> archive) noexcept { _archive = std::move(archive); }
+        AssetArchive const* archive() const noexcept { return _archive.get(); }
+
         UP_RUNTIME_API AssetId translate(UUID const& uuid, string_view logicalName = {}) const;
         UP_RUNTIME_API zstring_view debugName(AssetId logicalId) const noexcept;
 
@@ -57,16 +89,53 @@ namespace up {
         // based on load requests and such
         UP_RUNTIME_API void collectDoomedAssets();
 
+        /// Sets the bytes of unreferenced assets that collectDoomedAssets keeps
+        /// alive, so that loading them again is free. The least recently released
+        /// assets are evicted first. A budget of 0, the default, disables retention.
+        UP_RUNTIME_API void setRetentionBudget(uint64 bytes);
+        uint64 retentionBudget() const noexcept { return _retentionBudget; }
+
+        AssetCacheStats const& cacheStats() const noexcept { return _cacheStats; }
+
+        /// Swaps in the reloads whose content has been read. Existing handles see
+        /// the new assets from then on, so this should be called at a frame
+        /// boundary, while no asset is in use.
+        UP_RUNTIME_API void processReloads();
+
+        /// Number of reloads whose content is still being read or waiting to be swapped in.
+        size_t pendingReloadCount() const noexcept { return _reloads.size(); }
+        /// Number of reloads swapped in since the loader was created.
+        uint64 completedReloadCount() const noexcept { return _completedReloadCount; }
+
     private:
+        struct PendingReload;
+
+        void _scheduleReload(Asset& asset, ResourceManifest::Record const& record);
+        void _swapReload(PendingReload& reload);
+        void _release(Asset* asset) noexcept;
+        void _evictRetained();
         Asset* _findAsset(AssetId id) const noexcept;
         string _makeCasPath(uint64 contentHash) const;
-        AssetLoaderBackend* _findBackend(string_view type) const;
+        AssetArchive::Entry const* _findArchiveEntry(uint64 contentHash) const noexcept;
+        AssetLoaderBackend* _findBackend(Name type) const noexcept;
 
         vector<box<AssetLoaderBackend>> _backends;
+        vector<Name> _backendTypes;
         vector<Asset*> _assets;
+        /// Assets replaced by a reload, kept until the handles to them are released.
+        vector<Asset*> _replacedAssets;
+        /// Unreferenced assets kept alive by the retention cache, least recently released first.
+        vector<Asset*> _retainedAssets;
+        vector<box<PendingReload>> _reloads;
         box<ResourceManifest> _manifest;
         string _casPath;
+        box<AssetArchive> _archive;
         Logger _logger;
+        TaskQueue _reloadQueue;
+        box<TaskWorker> _reloadWorker;
+        uint64 _completedReloadCount = 0;
+        uint64 _retentionBudget = 0;
+        AssetCacheStats _cacheStats;
         int _manifestRevision = 0;
     };
 } // namespace up
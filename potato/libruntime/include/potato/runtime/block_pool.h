@@ -0,0 +1,67 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "_export.h"
+
+#include "potato/spud/int_types.h"
+
+#include <new>
+
+namespace up {
+    struct BlockPoolStats {
+        size_t blockSize = 0;
+        /// Blocks carved out of slabs owned by the size class.
+        size_t reserved = 0;
+        /// Blocks currently handed out to callers.
+        size_t inUse = 0;
+        /// Largest value inUse has reached.
+        size_t highWater = 0;
+    };
+
+    /// Thread-safe allocator for small objects, bucketed into fixed size classes.
+    ///
+    /// Each size class carves 64KiB slabs into equal blocks. Threads allocate
+    /// from and free to a private cache, and exchange whole batches of blocks
+    /// with a lock-free global free list per size class. Slabs are never
+    /// returned to the system, so long sessions that load and unload many
+    /// small objects recycle the same memory instead of fragmenting the heap.
+    ///
+    /// Requests larger than maxBlockSize are forwarded to the global heap.
+    class BlockPool {
+    public:
+        static constexpr size_t maxBlockSize = 1024;
+        static constexpr size_t blockAlignment = 16;
+
+        [[nodiscard]] UP_RUNTIME_API static void* allocate(size_t size);
+
+        /// Returns a block; size must match the size passed to allocate().
+        UP_RUNTIME_API static void deallocate(void* block, size_t size) noexcept;
+
+        UP_RUNTIME_API static size_t sizeClassCount() noexcept;
+
+        /// Size class that serves allocations of the given size, or sizeClassCount()
+        /// if the size is served by the global heap.
+        UP_RUNTIME_API static size_t sizeClassOf(size_t size) noexcept;
+
+        UP_RUNTIME_API static BlockPoolStats stats(size_t sizeClass) noexcept;
+    };
+
+    /// Base class that routes new and delete of derived types through the BlockPool.
+    ///
+    /// Deleting through a base pointer requires a virtual destructor, so that the
+    /// size of the most derived type is passed back to the pool. Types with an
+    /// alignment stricter than BlockPool::blockAlignment use the global heap.
+    class PoolAllocated {
+    public:
+        static void* operator new(size_t size) { return BlockPool::allocate(size); }
+        static void operator delete(void* block, size_t size) noexcept { BlockPool::deallocate(block, size); }
+
+        static void* operator new(size_t size, std::align_val_t alignment) {
+            return ::operator new(size, alignment);
+        }
+        static void operator delete(void* memory, size_t size, std::align_val_t alignment) noexcept {
+            ::operator delete(memory, size, alignment);
+        }
+    };
+} // namespace up
@@ -0,0 +1,88 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "_export.h"
+
+#include "potato/spud/hash.h"
+#include "potato/spud/int_types.h"
+#include "potato/spud/string_view.h"
+#include "potato/spud/zstring_view.h"
+
+#include <nanofmt/forward.h>
+#include <type_traits>
+
+namespace up {
+    /// Interned, immutable string.
+    ///
+    /// Every distinct string is stored exactly once in a global table for the
+    /// lifetime of the process, so Names compare by pointer and carry their
+    /// hash with them. Intended for the small, closed sets of identifiers that
+    /// are looked up on hot paths, such as asset type names; never intern
+    /// arbitrary user data.
+    class Name {
+    public:
+        constexpr Name() noexcept = default;
+
+        /// Interns the string, adding it to the table if not already present.
+        UP_RUNTIME_API explicit Name(string_view str);
+
+        /// Finds a previously interned string; returns an empty Name if
+        /// the string has never been interned.
+        UP_RUNTIME_API static Name find(string_view str);
+
+        char const* c_str() const noexcept { return _entry != nullptr ? _entry->chars() : ""; }
+        size_t size() const noexcept { return _entry != nullptr ? _entry->size : 0; }
+        bool empty() const noexcept { return _entry == nullptr; }
+        explicit operator bool() const noexcept { return _entry != nullptr; }
+
+        /*implicit*/ operator string_view() const noexcept { return {c_str(), size()}; }
+        /*implicit*/ operator zstring_view() const noexcept { return zstring_view{c_str()}; }
+
+        friend bool operator==(Name lhs, Name rhs) noexcept { return lhs._entry == rhs._entry; }
+        friend bool operator==(Name lhs, string_view rhs) noexcept { return string_view{lhs} == rhs; }
+
+        template <typename HashAlgorithm = default_hash>
+        friend uint64 hash_value(Name name) noexcept {
+            if constexpr (std::is_same_v<HashAlgorithm, default_hash>) {
+                return name._entry != nullptr ? name._entry->hash : hash_value<HashAlgorithm>(string_view{});
+            }
+            else {
+                return hash_value<HashAlgorithm>(string_view{name});
+            }
+        }
+
+        template <typename HashAlgorithm>
+        friend void hash_append(HashAlgorithm& hasher, Name name) noexcept {
+            hasher.append_bytes(name.c_str(), name.size());
+        }
+
+    private:
+        // the NUL-terminated characters are stored directly after the entry;
+        // the hash matches hash_value of the equivalent string_view
+        struct Entry {
+            uint64 hash = 0;
+            uint32 size = 0;
+
+            char const* chars() const noexcept { return reinterpret_cast<char const*>(this + 1); }
+        };
+
+        class Table;
+
+        explicit Name(Entry const* entry) noexcept : _entry(entry) { }
+
+        Entry const* _entry = nullptr;
+    };
+} // namespace up
+
+namespace nanofmt {
+    template <>
+    struct formatter<up::Name> {
+        constexpr char const* parse(char const* in, char const*) noexcept { return in; }
+
+        template <typename OutputT>
+        void format(up::Name name, OutputT& output) noexcept {
+            output.append(name.c_str(), name.size());
+        }
+    };
+} // namespace nanofmt
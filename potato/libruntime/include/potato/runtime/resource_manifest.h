@@ -3,6 +3,7 @@
 #pragma once
 
 #include "_export.h"
+#include "name.h"
 #include "uuid.h"
 
 #include "potato/spud/int_types.h"
@@ -21,7 +22,7 @@ namespace up {
             uint64 hash = 0;
             string logicalName;
             string filename;
-            string type;
+            Name type;
         };
 
         static constexpr zstring_view columnUuid = "UUID"_zsv;
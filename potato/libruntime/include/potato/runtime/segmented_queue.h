@@ -0,0 +1,377 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+// https://github.com/crossbeam-rs/crossbeam/blob/master/crossbeam-queue/src/seg_queue.rs
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace up {
+    /// Unbounded lock-free multi-producer multi-consumer queue.
+    ///
+    /// Elements live in a linked list of fixed-size segments. Producers and
+    /// consumers claim a slot with a single compare-exchange on the tail or head
+    /// index. The consumer that finishes a segment last retires it, and one
+    /// retired segment is kept for the next time a producer needs a segment.
+    ///
+    /// The blocking operations park the calling thread on a condition variable
+    /// instead of spinning. Enqueuing only touches the lock when a consumer is
+    /// actually parked.
+    template <typename T, std::size_t SegmentSize = 63, std::size_t CacheLineWidth = 64>
+    class SegmentedQueue {
+        static_assert(SegmentSize > 1, "SegmentedQueue segments must hold at least two elements");
+
+    public:
+        SegmentedQueue();
+        ~SegmentedQueue();
+
+        SegmentedQueue(SegmentedQueue const&) = delete;
+        SegmentedQueue& operator=(SegmentedQueue const&) = delete;
+
+        void close();
+        [[nodiscard]] bool isClosed() const noexcept { return _closed.load(std::memory_order_seq_cst); }
+        [[nodiscard]] inline bool empty() const noexcept;
+
+        /// Fails only if the queue has been closed.
+        template <typename InsertT>
+        [[nodiscard]] inline bool tryEnque(InsertT&& value);
+        [[nodiscard]] inline bool tryDeque(T& out);
+
+        /// The queue never fills, so this never blocks; the value is dropped if the queue is closed.
+        template <typename InsertT>
+        void enqueWait(InsertT&& value) {
+            (void)tryEnque(std::forward<InsertT>(value));
+        }
+
+        /// Parks until an element is available; returns false once the queue is closed and drained.
+        [[nodiscard]] bool dequeWait(T& out);
+
+        /// Parks until every enqueued element has been dequeued.
+        void waitUntilEmpty();
+
+    private:
+        // indices count slots in steps of 1 << kShift; each lap of kLap steps
+        // covers one segment plus a step that marks the move to the next one
+        static constexpr std::size_t kLap = SegmentSize + 1;
+        static constexpr std::uint64_t kShift = 1;
+        static constexpr std::uint64_t kStep = std::uint64_t{1} << kShift;
+
+        // set on the head index when the head segment is known to have a successor
+        static constexpr std::uint64_t kHasNext = 1;
+
+        static constexpr std::uint32_t kWrite = 1;
+        static constexpr std::uint32_t kRead = 2;
+        static constexpr std::uint32_t kRetire = 4;
+
+        struct Slot {
+            std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+            std::atomic<std::uint32_t> state = 0;
+        };
+
+        struct Segment {
+            std::atomic<Segment*> next = nullptr;
+            Slot slots[SegmentSize];
+        };
+
+        struct alignas(CacheLineWidth) Position {
+            std::atomic<std::uint64_t> index = 0;
+            std::atomic<Segment*> segment = nullptr;
+        };
+
+        Segment* _acquireSegment();
+        void _recycleSegment(Segment* segment) noexcept;
+        void _retireSegment(Segment* segment, std::size_t start) noexcept;
+        static Segment* _waitNext(Segment* segment) noexcept;
+
+        void _wakeConsumer();
+        void _wakeDrainers();
+
+        Position _head;
+        Position _tail;
+        alignas(CacheLineWidth) std::atomic<Segment*> _spare = nullptr;
+        std::atomic<bool> _closed = false;
+        std::atomic<int> _parkedConsumers = 0;
+        std::atomic<int> _parkedDrainers = 0;
+        std::mutex _parkLock;
+        std::condition_variable _available;
+        std::condition_variable _drained;
+    };
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    SegmentedQueue<T, SegmentSize, CacheLineWidth>::SegmentedQueue() {
+        Segment* const segment = new Segment;
+        _head.segment.store(segment, std::memory_order_relaxed);
+        _tail.segment.store(segment, std::memory_order_relaxed);
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    SegmentedQueue<T, SegmentSize, CacheLineWidth>::~SegmentedQueue() {
+        std::uint64_t head = _head.index.load(std::memory_order_relaxed) & ~kHasNext;
+        std::uint64_t const tail = _tail.index.load(std::memory_order_relaxed);
+        Segment* segment = _head.segment.load(std::memory_order_relaxed);
+
+        // destroy any elements that were never dequeued
+        for (; head != tail; head += kStep) {
+            std::size_t const offset = (head >> kShift) % kLap;
+            if (offset < SegmentSize) {
+                std::launder(reinterpret_cast<T*>(&segment->slots[offset].storage))->~T();
+            }
+            else {
+                Segment* const next = segment->next.load(std::memory_order_relaxed);
+                delete segment;
+                segment = next;
+            }
+        }
+
+        delete segment;
+        delete _spare.load(std::memory_order_relaxed);
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    void SegmentedQueue<T, SegmentSize, CacheLineWidth>::close() {
+        _closed.store(true, std::memory_order_seq_cst);
+
+        std::lock_guard lock(_parkLock);
+        _available.notify_all();
+        _drained.notify_all();
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    bool SegmentedQueue<T, SegmentSize, CacheLineWidth>::empty() const noexcept {
+        std::uint64_t const head = _head.index.load(std::memory_order_seq_cst);
+        std::uint64_t const tail = _tail.index.load(std::memory_order_seq_cst);
+        return (head >> kShift) == (tail >> kShift);
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    template <typename InsertT>
+    bool SegmentedQueue<T, SegmentSize, CacheLineWidth>::tryEnque(InsertT&& value) {
+        if (_closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        std::uint64_t tail = _tail.index.load(std::memory_order_acquire);
+        Segment* segment = _tail.segment.load(std::memory_order_acquire);
+        Segment* next = nullptr;
+
+        for (;;) {
+            std::size_t const offset = (tail >> kShift) % kLap;
+
+            // another producer is linking in the next segment
+            if (offset == SegmentSize) {
+                std::this_thread::yield();
+                tail = _tail.index.load(std::memory_order_acquire);
+                segment = _tail.segment.load(std::memory_order_acquire);
+                continue;
+            }
+
+            // have the next segment ready before claiming the last slot
+            if (offset + 1 == SegmentSize && next == nullptr) {
+                next = _acquireSegment();
+            }
+
+            std::uint64_t const newTail = tail + kStep;
+            if (_tail.index.compare_exchange_weak(
+                    tail,
+                    newTail,
+                    std::memory_order_seq_cst,
+                    std::memory_order_acquire)) {
+                if (offset + 1 == SegmentSize) {
+                    _tail.segment.store(next, std::memory_order_release);
+                    _tail.index.store(newTail + kStep, std::memory_order_seq_cst);
+                    segment->next.store(next, std::memory_order_release);
+                    next = nullptr;
+                }
+
+                Slot& slot = segment->slots[offset];
+                new (&slot.storage) T(std::forward<InsertT>(value));
+                slot.state.fetch_or(kWrite, std::memory_order_release);
+                break;
+            }
+
+            segment = _tail.segment.load(std::memory_order_acquire);
+        }
+
+        // another producer linked in its own segment first
+        if (next != nullptr) {
+            _recycleSegment(next);
+        }
+
+        _wakeConsumer();
+        return true;
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    bool SegmentedQueue<T, SegmentSize, CacheLineWidth>::tryDeque(T& out) {
+        std::uint64_t head = _head.index.load(std::memory_order_acquire);
+        Segment* segment = _head.segment.load(std::memory_order_acquire);
+
+        for (;;) {
+            std::size_t const offset = (head >> kShift) % kLap;
+
+            // another consumer is moving on to the next segment
+            if (offset == SegmentSize) {
+                std::this_thread::yield();
+                head = _head.index.load(std::memory_order_acquire);
+                segment = _head.segment.load(std::memory_order_acquire);
+                continue;
+            }
+
+            std::uint64_t newHead = head + kStep;
+
+            if ((newHead & kHasNext) == 0) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                std::uint64_t const tail = _tail.index.load(std::memory_order_relaxed);
+
+                if ((head >> kShift) == (tail >> kShift)) {
+                    return false;
+                }
+
+                // head and tail are in different segments, so the head segment has a successor
+                if ((head >> kShift) / kLap != (tail >> kShift) / kLap) {
+                    newHead |= kHasNext;
+                }
+            }
+
+            if (_head.index.compare_exchange_weak(
+                    head,
+                    newHead,
+                    std::memory_order_seq_cst,
+                    std::memory_order_acquire)) {
+                if (offset + 1 == SegmentSize) {
+                    Segment* const next = _waitNext(segment);
+                    std::uint64_t nextIndex = (newHead & ~kHasNext) + kStep;
+                    if (next->next.load(std::memory_order_relaxed) != nullptr) {
+                        nextIndex |= kHasNext;
+                    }
+
+                    _head.segment.store(next, std::memory_order_release);
+                    _head.index.store(nextIndex, std::memory_order_seq_cst);
+                }
+
+                // the producer may not have finished writing the slot yet
+                Slot& slot = segment->slots[offset];
+                while ((slot.state.load(std::memory_order_acquire) & kWrite) == 0) {
+                    std::this_thread::yield();
+                }
+
+                T& item = *std::launder(reinterpret_cast<T*>(&slot.storage));
+                out = std::move(item);
+                item.~T();
+
+                if (offset + 1 == SegmentSize) {
+                    _retireSegment(segment, 0);
+                }
+                else if ((slot.state.fetch_or(kRead, std::memory_order_acq_rel) & kRetire) != 0) {
+                    _retireSegment(segment, offset + 1);
+                }
+
+                _wakeDrainers();
+                return true;
+            }
+
+            segment = _head.segment.load(std::memory_order_acquire);
+        }
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    bool SegmentedQueue<T, SegmentSize, CacheLineWidth>::dequeWait(T& out) {
+        for (;;) {
+            if (tryDeque(out)) {
+                return true;
+            }
+
+            std::unique_lock lock(_parkLock);
+
+            // registering before re-checking guarantees a producer either sees
+            // the parked consumer or we see its element
+            _parkedConsumers.fetch_add(1, std::memory_order_seq_cst);
+            _available.wait(lock, [this] { return !empty() || isClosed(); });
+            _parkedConsumers.fetch_sub(1, std::memory_order_relaxed);
+
+            if (isClosed() && empty()) {
+                return false;
+            }
+        }
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    void SegmentedQueue<T, SegmentSize, CacheLineWidth>::waitUntilEmpty() {
+        std::unique_lock lock(_parkLock);
+
+        _parkedDrainers.fetch_add(1, std::memory_order_seq_cst);
+        _drained.wait(lock, [this] { return empty(); });
+        _parkedDrainers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    void SegmentedQueue<T, SegmentSize, CacheLineWidth>::_wakeConsumer() {
+        if (_parkedConsumers.load(std::memory_order_seq_cst) != 0) {
+            std::lock_guard lock(_parkLock);
+            _available.notify_one();
+        }
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    void SegmentedQueue<T, SegmentSize, CacheLineWidth>::_wakeDrainers() {
+        if (_parkedDrainers.load(std::memory_order_seq_cst) != 0 && empty()) {
+            std::lock_guard lock(_parkLock);
+            _drained.notify_all();
+        }
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    auto SegmentedQueue<T, SegmentSize, CacheLineWidth>::_acquireSegment() -> Segment* {
+        Segment* const segment = _spare.exchange(nullptr, std::memory_order_acquire);
+        if (segment == nullptr) {
+            return new Segment;
+        }
+
+        segment->next.store(nullptr, std::memory_order_relaxed);
+        for (Slot& slot : segment->slots) {
+            slot.state.store(0, std::memory_order_relaxed);
+        }
+        return segment;
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    void SegmentedQueue<T, SegmentSize, CacheLineWidth>::_recycleSegment(Segment* segment) noexcept {
+        Segment* expected = nullptr;
+        if (!_spare.compare_exchange_strong(expected, segment, std::memory_order_release, std::memory_order_relaxed)) {
+            delete segment;
+        }
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    void SegmentedQueue<T, SegmentSize, CacheLineWidth>::_retireSegment(Segment* segment, std::size_t start) noexcept {
+        // the consumer of the last slot always starts retirement, so it is never flagged
+        for (std::size_t index = start; index < SegmentSize - 1; ++index) {
+            Slot& slot = segment->slots[index];
+
+            // a consumer still reading this slot will finish retiring the segment
+            if ((slot.state.load(std::memory_order_acquire) & kRead) == 0 &&
+                (slot.state.fetch_or(kRetire, std::memory_order_acq_rel) & kRead) == 0) {
+                return;
+            }
+        }
+
+        _recycleSegment(segment);
+    }
+
+    template <typename T, std::size_t SegmentSize, std::size_t CacheLineWidth>
+    auto SegmentedQueue<T, SegmentSize, CacheLineWidth>::_waitNext(Segment* segment) noexcept -> Segment* {
+        for (;;) {
+            if (Segment* const next = segment->next.load(std::memory_order_acquire); next != nullptr) {
+                return next;
+            }
+            std::this_thread::yield();
+        }
+    }
+} // namespace up
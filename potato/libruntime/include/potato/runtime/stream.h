@@ -83,6 +83,16 @@ namespace up {
         box<Backend> _impl;
     };
 
+    /// Opens a read-only stream over bytes, which must outlive the stream.
+    [[nodiscard]] UP_RUNTIME_API auto openMemoryRead(view<up::byte> bytes) -> Stream;
+    /// Opens a seekable stream over bytes, which must outlive the stream. Writes
+    /// overwrite bytes at the current position and grow it as needed.
+    [[nodiscard]] UP_RUNTIME_API auto openMemory(vector<up::byte>& bytes) -> Stream;
+
+    /// Fills buffer completely; a short read returns IOResult::Malformed, as the data
+    /// being read is truncated.
+    [[nodiscard]] UP_RUNTIME_API auto readExact(Stream& stream, span<up::byte> buffer) -> IOResult;
+
     [[nodiscard]] UP_RUNTIME_API auto readBinary(Stream& stream, vector<up::byte>& out) -> IOResult;
     [[nodiscard]] UP_RUNTIME_API auto readBinary(Stream& stream) -> IOReturn<vector<up::byte>>;
     [[nodiscard]] UP_RUNTIME_API auto readText(Stream& stream, string& out) -> IOResult;
@@ -3,7 +3,7 @@
 #pragma once
 
 #include "_export.h"
-#include "concurrent_queue.h"
+#include "segmented_queue.h"
 #include "thread_util.h"
 
 #include "potato/spud/delegate.h"
@@ -13,7 +13,7 @@
 
 namespace up {
     using Task = delegate<void()>;
-    using TaskQueue = ConcurrentQueue<Task>;
+    using TaskQueue = SegmentedQueue<Task>;
 
     class TaskWorker {
     public:
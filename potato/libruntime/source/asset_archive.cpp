@@ -0,0 +1,178 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/runtime/asset_archive.h"
+
+#include "potato/runtime/filesystem.h"
+#include "potato/spud/sort.h"
+
+#include <algorithm>
+
+namespace up {
+    namespace {
+        constexpr uint32 archiveMagic = 0x4B41'5055; // "UPAK"
+        constexpr uint32 archiveVersion = 1;
+
+        struct ArchiveHeader {
+            uint32 magic = archiveMagic;
+            uint32 version = archiveVersion;
+            uint64 entryCount = 0;
+            uint64 reserved[2] = {};
+        };
+
+        static_assert(sizeof(ArchiveHeader) == 32);
+        static_assert(sizeof(AssetArchive::Entry) == 32);
+
+        constexpr uint64 alignUp(uint64 offset) noexcept {
+            return (offset + AssetArchive::alignment - 1) & ~(AssetArchive::alignment - 1);
+        }
+
+        IOResult writePadding(Stream& stream, uint64 count) {
+            static constexpr byte zeroes[512] = {};
+            while (count != 0) {
+                uint64 const chunk = count < sizeof(zeroes) ? count : sizeof(zeroes);
+                IOResult const rs = stream.write(span{zeroes, static_cast<size_t>(chunk)});
+                if (rs != IOResult::Success) {
+                    return rs;
+                }
+                count -= chunk;
+            }
+            return IOResult::Success;
+        }
+    } // namespace
+} // namespace up
+
+auto up::AssetArchive::open(zstring_view path) -> IOResult {
+    Stream stream = fs::openRead(path);
+    if (!stream) {
+        close();
+        return IOResult::FileNotFound;
+    }
+    return open(std::move(stream));
+}
+
+auto up::AssetArchive::open(Stream stream) -> IOResult {
+    close();
+
+    if (!stream.canRead() || !stream.canSeek()) {
+        return IOResult::InvalidArgument;
+    }
+
+    auto const fileSize = static_cast<uint64>(stream.remaining());
+
+    ArchiveHeader header;
+    if (IOResult const rs = readExact(stream, span{&header, 1}.as_bytes()); rs != IOResult::Success) {
+        return rs;
+    }
+    if (header.magic != archiveMagic || header.version != archiveVersion ||
+        header.entryCount > (fileSize - sizeof(header)) / sizeof(Entry)) {
+        return IOResult::Malformed;
+    }
+
+    vector<Entry> entries(static_cast<size_t>(header.entryCount));
+    if (IOResult const rs = readExact(stream, span{entries.data(), entries.size()}.as_bytes());
+        rs != IOResult::Success) {
+        return rs;
+    }
+
+    // validate the whole index up front, so that lookups and reads can trust it
+    for (size_t index = 0; index != entries.size(); ++index) {
+        Entry const& entry = entries[index];
+        bool const sorted = index == 0 || entries[index - 1].hash < entry.hash;
+        bool const inBounds = entry.offset <= fileSize && entry.size <= fileSize - entry.offset;
+        if (!sorted || !inBounds || entry.offset % alignment != 0 || (entry.flags & ~supportedFlags) != 0) {
+            return IOResult::Malformed;
+        }
+    }
+
+    _stream = std::move(stream);
+    _entries = std::move(entries);
+    return IOResult::Success;
+}
+
+auto up::AssetArchive::findEntry(uint64 contentHash) const noexcept -> Entry const* {
+    auto const it = std::lower_bound(
+        _entries.begin(),
+        _entries.end(),
+        contentHash,
+        [](Entry const& entry, uint64 hash) { return entry.hash < hash; });
+    return it != _entries.end() && it->hash == contentHash ? it : nullptr;
+}
+
+auto up::AssetArchive::read(Entry const& entry, vector<byte>& out) -> IOResult {
+    if (!isOpen()) {
+        return IOResult::InvalidArgument;
+    }
+
+    if (IOResult const rs = _stream.seek(Stream::Seek::Begin, static_cast<Stream::difference_type>(entry.offset));
+        rs != IOResult::Success) {
+        return rs;
+    }
+
+    out.resize(static_cast<size_t>(entry.size));
+    return readExact(_stream, out);
+}
+
+void up::AssetArchiveWriter::addFile(uint64 contentHash, string path, uint32 flags) {
+    _sources.push_back({.hash = contentHash, .path = std::move(path), .flags = flags});
+}
+
+auto up::AssetArchiveWriter::write(Stream& stream) -> IOResult {
+    if (!stream.canWrite()) {
+        return IOResult::InvalidArgument;
+    }
+
+    // CAS blobs are named by their content, so a hash added twice is stored once
+    sort(_sources, [](Source const& lhs, Source const& rhs) { return lhs.hash < rhs.hash; });
+    _sources.erase(
+        std::unique(
+            _sources.begin(),
+            _sources.end(),
+            [](Source const& lhs, Source const& rhs) { return lhs.hash == rhs.hash; }),
+        _sources.end());
+
+    // the whole layout is decided before writing, as output streams can't seek back
+    vector<AssetArchive::Entry> entries;
+    entries.reserve(_sources.size());
+    uint64 offset = alignUp(sizeof(ArchiveHeader) + _sources.size() * sizeof(AssetArchive::Entry));
+    for (Source const& source : _sources) {
+        auto const [rs, stat] = fs::fileStat(source.path);
+        if (rs != IOResult::Success) {
+            return rs;
+        }
+        entries.push_back({.hash = source.hash, .offset = offset, .size = stat.size, .flags = source.flags});
+        offset = alignUp(offset + stat.size);
+    }
+
+    ArchiveHeader const header{.entryCount = entries.size()};
+    if (IOResult const rs = stream.write(span{&header, 1}.as_bytes()); rs != IOResult::Success) {
+        return rs;
+    }
+    if (IOResult const rs = stream.write(span<AssetArchive::Entry const>{entries}.as_bytes());
+        rs != IOResult::Success) {
+        return rs;
+    }
+
+    uint64 position = sizeof(ArchiveHeader) + entries.size() * sizeof(AssetArchive::Entry);
+    vector<byte> content;
+    for (size_t index = 0; index != entries.size(); ++index) {
+        AssetArchive::Entry const& entry = entries[index];
+        if (IOResult const rs = writePadding(stream, entry.offset - position); rs != IOResult::Success) {
+            return rs;
+        }
+
+        content.clear();
+        if (IOResult const rs = fs::readBinary(_sources[index].path, content); rs != IOResult::Success) {
+            return rs;
+        }
+        // a file that changed since it was measured would corrupt every offset after it
+        if (content.size() != entry.size) {
+            return IOResult::Malformed;
+        }
+        if (IOResult const rs = stream.write(content); rs != IOResult::Success) {
+            return rs;
+        }
+        position = entry.offset + entry.size;
+    }
+
+    return stream.flush();
+}
@@ -7,19 +7,66 @@
 #include "potato/runtime/path.h"
 #include "potato/runtime/resource_manifest.h"
 #include "potato/runtime/stream.h"
+#include "potato/spud/find.h"
 #include "potato/spud/hash.h"
 #include "potato/spud/hash_fnv1a.h"
 
 #include <Tracy.hpp>
+#include <atomic>
+#include <chrono>
+
+struct up::AssetLoader::PendingReload {
+    rc<Asset> asset;
+    ResourceManifest::Record record;
+    string filename;
+    std::chrono::steady_clock::time_point scheduled;
+    vector<byte> content;
+    IOResult result = IOResult::Success;
+    std::atomic<bool> read = false;
+    /// Set when a later manifest schedules another reload of the same asset.
+    bool superseded = false;
+};
 
 up::AssetLoader::AssetLoader() : _logger("AssetLoader") { }
 
-up::AssetLoader::~AssetLoader() = default;
+up::AssetLoader::~AssetLoader() {
+    _reloadQueue.close();
+    _reloadWorker.reset();
+    setRetentionBudget(0);
+}
 
 void up::AssetLoader::bindManifest(box<ResourceManifest> manifest, string casPath) {
+    box<ResourceManifest> previous = std::move(_manifest);
     _manifest = std::move(manifest);
     _casPath = std::move(casPath);
     ++_manifestRevision;
+
+    if (previous == nullptr || _manifest == nullptr) {
+        return;
+    }
+
+    auto it = begin(_assets);
+    while (it != end(_assets)) {
+        Asset* const asset = *it;
+        uint64 const logicalId = asset->assetId().value();
+        ResourceManifest::Record const* const record = _manifest->findRecord(logicalId);
+        ResourceManifest::Record const* const previousRecord = previous->findRecord(logicalId);
+        if (record == nullptr || (previousRecord != nullptr && previousRecord->hash == record->hash)) {
+            ++it;
+            continue;
+        }
+
+        // nothing refers to a doomed asset, so rather than reloading it, it's
+        // dropped and loaded anew should it be requested again
+        if (asset->isDoomed()) {
+            _release(asset);
+            it = _assets.erase(it);
+            continue;
+        }
+
+        _scheduleReload(*asset, *record);
+        ++it;
+    }
 }
 
 auto up::AssetLoader::translate(UUID const& uuid, string_view logicalName) const -> AssetId {
@@ -39,6 +86,12 @@ auto up::AssetLoader::loadAssetSync(AssetId id, string_view type) -> UntypedAsse
     ZoneScopedN("Load Asset Synchronous");
 
     if (Asset* asset = _findAsset(id); asset != nullptr) {
+        if (asset->_retained) {
+            asset->_retained = false;
+            _retainedAssets.erase(find(_retainedAssets, asset));
+            _cacheStats.residentBytes -= asset->_sizeEstimate;
+            ++_cacheStats.hits;
+        }
         return {asset->assetKey(), rc<Asset>{rc_acquire, asset}};
     }
 
@@ -61,7 +114,24 @@ auto up::AssetLoader::loadAssetSync(AssetId id, string_view type) -> UntypedAsse
 
     string filename = _makeCasPath(record->hash);
 
-    Stream stream = fs::openRead(filename);
+    // content in the archive is read with a single read, rather than opening its loose file
+    vector<byte> packed;
+    Stream stream;
+    if (AssetArchive::Entry const* const entry = _findArchiveEntry(record->hash); entry != nullptr) {
+        if (IOResult const rs = _archive->read(*entry, packed); rs != IOResult::Success) {
+            _logger.error(
+                "Failed to read asset `{}` [{}] ({}) from archive: {}",
+                id,
+                record->filename,
+                record->type,
+                rs);
+            return {};
+        }
+        stream = openMemoryRead(packed);
+    }
+    else {
+        stream = fs::openRead(filename);
+    }
     if (!stream) {
         _logger.error("Unknown asset `{}` [{}] ({}) from `{}`", id, record->filename, record->type, filename);
         return {};
@@ -69,6 +139,7 @@ auto up::AssetLoader::loadAssetSync(AssetId id, string_view type) -> UntypedAsse
 
     AssetLoadContext const ctx{.key = {.uuid = record->uuid, .logical = string{}}, .stream = stream, .loader = *this};
 
+    auto const contentSize = static_cast<uint64>(stream.remaining());
     auto asset = backend->loadFromStream(ctx);
 
     stream.close();
@@ -78,7 +149,9 @@ auto up::AssetLoader::loadAssetSync(AssetId id, string_view type) -> UntypedAsse
         return {};
     }
 
+    asset->_sizeEstimate = backend->estimateSize(*asset, contentSize);
     _assets.push_back(asset.get());
+    ++_cacheStats.misses;
 
     return {AssetKey{.uuid = record->uuid, .logical = record->logicalName}, std::move(asset)};
 }
@@ -86,6 +159,7 @@ auto up::AssetLoader::loadAssetSync(AssetId id, string_view type) -> UntypedAsse
 void up::AssetLoader::registerBackend(box<AssetLoaderBackend> backend) {
     UP_GUARD_VOID(backend != nullptr);
 
+    _backendTypes.push_back(Name{backend->typeName()});
     _backends.push_back(std::move(backend));
 }
 
@@ -98,15 +172,19 @@ auto up::AssetLoader::_findAsset(AssetId id) const noexcept -> Asset* {
     return nullptr;
 }
 
-auto up::AssetLoader::_findBackend(string_view type) const -> AssetLoaderBackend* {
-    for (box<AssetLoaderBackend> const& backend : _backends) {
-        if (backend->typeName() == type) {
-            return backend.get();
+auto up::AssetLoader::_findBackend(Name type) const noexcept -> AssetLoaderBackend* {
+    for (size_t index = 0; index != _backendTypes.size(); ++index) {
+        if (_backendTypes[index] == type) {
+            return _backends[index].get();
         }
     }
     return nullptr;
 }
 
+auto up::AssetLoader::_findArchiveEntry(uint64 contentHash) const noexcept -> AssetArchive::Entry const* {
+    return _archive != nullptr && _archive->isOpen() ? _archive->findEntry(contentHash) : nullptr;
+}
+
 auto up::AssetLoader::_makeCasPath(uint64 contentHash) const -> string {
     char casFilePath[32] = {
         0,
@@ -121,13 +199,172 @@ auto up::AssetLoader::_makeCasPath(uint64 contentHash) const -> string {
 }
 
 void up::AssetLoader::collectDoomedAssets() {
-    auto it = begin(_assets);
-    while (it != end(_assets)) {
-        if ((*it)->isDoomed()) {
-            delete *it;
-            it = _assets.erase(it);
+    // replaced assets hold their replacements, and are ordered oldest first, so
+    // that a whole chain of reloads is released in a single pass
+    for (vector<Asset*>* const assets : {&_replacedAssets, &_assets}) {
+        auto it = begin(*assets);
+        while (it != end(*assets)) {
+            Asset* const asset = *it;
+            if (!asset->isDoomed() || asset->_retained) {
+                ++it;
+                continue;
+            }
+
+            // only current assets can be found again, so only those are retained
+            if (_retentionBudget != 0 && assets == &_assets) {
+                asset->_retained = true;
+                _retainedAssets.push_back(asset);
+                _cacheStats.residentBytes += asset->_sizeEstimate;
+                ++it;
+                continue;
+            }
+
+            delete asset;
+            it = assets->erase(it);
+        }
+    }
+
+    _evictRetained();
+}
+
+void up::AssetLoader::setRetentionBudget(uint64 bytes) {
+    _retentionBudget = bytes;
+    _evictRetained();
+}
+
+void up::AssetLoader::_release(Asset* asset) noexcept {
+    if (asset->_retained) {
+        _retainedAssets.erase(find(_retainedAssets, asset));
+        _cacheStats.residentBytes -= asset->_sizeEstimate;
+    }
+    delete asset;
+}
+
+void up::AssetLoader::_evictRetained() {
+    size_t evicted = 0;
+    while (evicted != _retainedAssets.size() && (_retentionBudget == 0 || _cacheStats.residentBytes > _retentionBudget)) {
+        Asset* const asset = _retainedAssets[evicted++];
+        _cacheStats.residentBytes -= asset->_sizeEstimate;
+        _assets.erase(find(_assets, asset));
+        delete asset;
+    }
+
+    if (evicted != 0) {
+        _retainedAssets.erase(begin(_retainedAssets), begin(_retainedAssets) + evicted);
+        _cacheStats.evictions += evicted;
+    }
+}
+
+void up::AssetLoader::processReloads() {
+    ZoneScopedN("Process Asset Reloads");
+
+    auto it = begin(_reloads);
+    while (it != end(_reloads)) {
+        if (!(*it)->read.load(std::memory_order_acquire)) {
+            ++it;
             continue;
         }
-        ++it;
+
+        box<PendingReload> const reload = std::move(*it);
+        it = _reloads.erase(it);
+        if (!reload->superseded) {
+            _swapReload(*reload);
+        }
+    }
+}
+
+void up::AssetLoader::_scheduleReload(Asset& asset, ResourceManifest::Record const& record) {
+    // a newer manifest supersedes a reload that is still in flight; the reload
+    // is kept until its read completes, as the reading task refers to it
+    for (box<PendingReload> const& pending : _reloads) {
+        if (pending->asset.get() == &asset) {
+            pending->superseded = true;
+        }
+    }
+
+    auto reload = new_box<PendingReload>();
+    reload->asset = rc<Asset>{rc_acquire, &asset};
+    reload->record = record;
+    reload->filename = _makeCasPath(record.hash);
+    reload->scheduled = std::chrono::steady_clock::now();
+    PendingReload* const pending = reload.get();
+    _reloads.push_back(std::move(reload));
+
+    // packed content costs a single read, so it isn't worth a trip to the worker
+    if (AssetArchive::Entry const* const entry = _findArchiveEntry(record.hash); entry != nullptr) {
+        pending->result = _archive->read(*entry, pending->content);
+        pending->read.store(true, std::memory_order_release);
+        return;
+    }
+
+    if (_reloadWorker == nullptr) {
+        _reloadWorker = new_box<TaskWorker>(_reloadQueue, "Asset Reload");
+    }
+    _reloadQueue.enqueWait([reload = pending] {
+        reload->result = fs::readBinary(reload->filename, reload->content);
+        reload->read.store(true, std::memory_order_release);
+    });
+}
+
+void up::AssetLoader::_swapReload(PendingReload& reload) {
+    ResourceManifest::Record const& record = reload.record;
+    Asset& stale = *reload.asset;
+
+    if (reload.result != IOResult::Success) {
+        _logger.error(
+            "Reload failed for asset `{}` [{}] ({}) from `{}`: {}",
+            stale.assetId(),
+            record.filename,
+            record.type,
+            reload.filename,
+            reload.result);
+        return;
+    }
+
+    if (record.type != string_view{stale.assetType()}) {
+        _logger.error(
+            "Reload changed type of asset `{}` [{}] ({}, was {})",
+            stale.assetId(),
+            record.filename,
+            record.type,
+            stale.assetType());
+        return;
+    }
+
+    AssetLoaderBackend* const backend = _findBackend(record.type);
+    if (backend == nullptr) {
+        _logger.error("Unknown backend for asset `{}` [{}] ({})", stale.assetId(), record.filename, record.type);
+        return;
     }
+
+    Stream stream = openMemoryRead(reload.content);
+    AssetLoadContext const ctx{.key = {.uuid = record.uuid, .logical = string{}}, .stream = stream, .loader = *this};
+
+    rc<Asset> fresh = backend->loadFromStream(ctx);
+    if (!fresh) {
+        _logger.error(
+            "Reload failed for asset `{}` [{}] ({}) from `{}`",
+            stale.assetId(),
+            record.filename,
+            record.type,
+            reload.filename);
+        return;
+    }
+
+    fresh->_sizeEstimate = backend->estimateSize(*fresh, reload.content.size());
+
+    // the stale asset is kept until the handles to it are released, and forwards
+    // them to its replacement until then
+    for (Asset*& asset : _assets) {
+        if (asset == &stale) {
+            asset = fresh.get();
+            break;
+        }
+    }
+    _replacedAssets.push_back(&stale);
+    stale._replacement = std::move(fresh);
+    ++_completedReloadCount;
+
+    std::chrono::duration<double, std::milli> const latency = std::chrono::steady_clock::now() - reload.scheduled;
+    _logger.info("Reloaded asset `{}` [{}] in {:.2f}ms", stale.assetId(), record.filename, latency.count());
 }
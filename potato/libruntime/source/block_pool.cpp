@@ -0,0 +1,370 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/runtime/block_pool.h"
+
+#include "potato/runtime/assertion.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+
+namespace up {
+    namespace {
+        constexpr size_t slabSize = 64 * 1024;
+        constexpr size_t sizeClassSizes[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+        constexpr size_t sizeClassCount = std::size(sizeClassSizes);
+
+        static_assert(sizeClassSizes[sizeClassCount - 1] == BlockPool::maxBlockSize);
+
+        // slabs are numbered so that free blocks can be named by a 32-bit index,
+        // leaving room for an ABA tag beside the index in a 64-bit word
+        constexpr uint32 blocksPerSlabIndex = slabSize / BlockPool::blockAlignment;
+        constexpr uint32 slabPageSize = 1024;
+        constexpr uint32 slabPageCount = 512;
+        constexpr uint32 maxSlabs = slabPageSize * slabPageCount;
+
+        static_assert(uint64{maxSlabs} * blocksPerSlabIndex < ~uint32{0});
+
+        struct alignas(BlockPool::blockAlignment) SlabHeader {
+            uint32 number = 0;
+        };
+
+        /// Overlaid on a block while it is free.
+        ///
+        /// Blocks are exchanged with the global free list in batches: blocks
+        /// within a batch are chained through next, and the first block of
+        /// each batch records the batch size and the next batch in the list.
+        struct FreeBlock {
+            FreeBlock* next = nullptr;
+            std::atomic<uint32> nextBatch = 0;
+            uint32 count = 0;
+        };
+
+        static_assert(sizeof(FreeBlock) <= sizeClassSizes[0]);
+
+        constexpr uint8 makeClassLookupEntry(size_t size) noexcept {
+            uint8 index = 0;
+            while (sizeClassSizes[index] < size) {
+                ++index;
+            }
+            return index;
+        }
+
+        // maps (size + 15) / 16 to a size class index
+        constexpr auto classLookup = [] {
+            struct Table {
+                uint8 entries[BlockPool::maxBlockSize / BlockPool::blockAlignment + 1] = {};
+            } table;
+            for (size_t index = 0; index != std::size(table.entries); ++index) {
+                table.entries[index] = makeClassLookupEntry(index * BlockPool::blockAlignment);
+            }
+            return table;
+        }();
+
+        uint32 classIndexOf(size_t size) noexcept {
+            return classLookup.entries[(size + BlockPool::blockAlignment - 1) / BlockPool::blockAlignment];
+        }
+
+        struct alignas(64) SizeClass {
+            std::atomic<uint64> freeBatches = 0;
+            std::atomic<size_t> reserved = 0;
+            std::atomic<size_t> inUse = 0;
+            std::atomic<size_t> highWater = 0;
+            uint32 blockSize = 0;
+            uint32 batchSize = 0;
+        };
+
+        class Pool {
+        public:
+            static Pool& instance() {
+                // never destroyed, so that pooled objects may be released during static destruction
+                // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+                static Pool* const pool = new Pool;
+                return *pool;
+            }
+
+            SizeClass& sizeClass(uint32 index) noexcept { return _classes[index]; }
+
+            void pushBatch(SizeClass& cls, FreeBlock* first, uint32 count) noexcept;
+            FreeBlock* popBatch(SizeClass& cls) noexcept;
+            FreeBlock* refill(SizeClass& cls);
+
+            void noteAllocated(SizeClass& cls) noexcept;
+            void noteFreed(SizeClass& cls) noexcept { cls.inUse.fetch_sub(1, std::memory_order_relaxed); }
+
+        private:
+            Pool() noexcept;
+
+            uint32 _encode(FreeBlock* block) const noexcept;
+            FreeBlock* _decode(uint32 index) const noexcept;
+            FreeBlock* _addSlab(SizeClass& cls);
+
+            SizeClass _classes[sizeClassCount];
+            std::atomic<std::atomic<SlabHeader*>*> _slabPages[slabPageCount] = {};
+            std::mutex _slabLock;
+            uint32 _slabCount = 0;
+        };
+
+        /// Per-thread lists of free blocks, one per size class.
+        struct ThreadCache {
+            struct List {
+                FreeBlock* head = nullptr;
+                uint32 count = 0;
+            };
+
+            ThreadCache() noexcept = default;
+            ~ThreadCache();
+
+            ThreadCache(ThreadCache const&) = delete;
+            ThreadCache& operator=(ThreadCache const&) = delete;
+
+            List lists[sizeClassCount];
+        };
+
+        // set once the thread's cache has been destroyed; blocks released
+        // after that point go straight to the global free list
+        thread_local bool threadCacheDestroyed = false;
+        thread_local ThreadCache threadCache;
+
+        Pool::Pool() noexcept {
+            for (uint32 index = 0; index != sizeClassCount; ++index) {
+                auto const blockSize = static_cast<uint32>(sizeClassSizes[index]);
+                _classes[index].blockSize = blockSize;
+
+                // move roughly 8KiB per batch, clamped so small blocks don't hoard and large ones still batch
+                uint32 const batchSize = 8 * 1024 / blockSize;
+                _classes[index].batchSize = batchSize < 8 ? 8 : batchSize > 64 ? 64 : batchSize;
+            }
+        }
+
+        uint32 Pool::_encode(FreeBlock* block) const noexcept {
+            auto const address = reinterpret_cast<uintptr_t>(block);
+            auto const* const header = reinterpret_cast<SlabHeader const*>(address & ~uintptr_t{slabSize - 1});
+            auto const offset = static_cast<uint32>((address & (slabSize - 1)) / BlockPool::blockAlignment);
+            return header->number * blocksPerSlabIndex + offset + 1;
+        }
+
+        FreeBlock* Pool::_decode(uint32 index) const noexcept {
+            --index;
+            uint32 const number = index / blocksPerSlabIndex;
+            uint32 const offset = index % blocksPerSlabIndex;
+
+            std::atomic<SlabHeader*>* const page = _slabPages[number / slabPageSize].load(std::memory_order_acquire);
+            SlabHeader* const header = page[number % slabPageSize].load(std::memory_order_acquire);
+            return reinterpret_cast<FreeBlock*>(reinterpret_cast<char*>(header) + offset * BlockPool::blockAlignment);
+        }
+
+        void Pool::pushBatch(SizeClass& cls, FreeBlock* first, uint32 count) noexcept {
+            first->count = count;
+            uint64 const index = _encode(first);
+
+            uint64 head = cls.freeBatches.load(std::memory_order_relaxed);
+            uint64 desired = 0;
+            do {
+                first->nextBatch.store(static_cast<uint32>(head), std::memory_order_relaxed);
+                desired = (((head >> 32) + 1) << 32) | index;
+            } while (!cls.freeBatches
+                          .compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        FreeBlock* Pool::popBatch(SizeClass& cls) noexcept {
+            uint64 head = cls.freeBatches.load(std::memory_order_acquire);
+            while (static_cast<uint32>(head) != 0) {
+                FreeBlock* const first = _decode(static_cast<uint32>(head));
+
+                // first may already have been popped and reused by another thread,
+                // in which case nextBatch is garbage; the tag makes the exchange fail
+                uint64 const next = first->nextBatch.load(std::memory_order_relaxed);
+                uint64 const desired = (((head >> 32) + 1) << 32) | next;
+                if (cls.freeBatches
+                        .compare_exchange_weak(head, desired, std::memory_order_acquire, std::memory_order_acquire)) {
+                    return first;
+                }
+            }
+            return nullptr;
+        }
+
+        FreeBlock* Pool::refill(SizeClass& cls) {
+            if (FreeBlock* const batch = popBatch(cls); batch != nullptr) {
+                return batch;
+            }
+
+            std::lock_guard lock(_slabLock);
+
+            // another thread may have added a slab while we waited for the lock
+            if (FreeBlock* const batch = popBatch(cls); batch != nullptr) {
+                return batch;
+            }
+
+            return _addSlab(cls);
+        }
+
+        FreeBlock* Pool::_addSlab(SizeClass& cls) {
+            if (_slabCount == maxSlabs) {
+                UP_UNREACHABLE("BlockPool slab table is full");
+                std::abort();
+            }
+
+            uint32 const number = _slabCount++;
+            auto& page = _slabPages[number / slabPageSize];
+            if (page.load(std::memory_order_relaxed) == nullptr) {
+                page.store(new std::atomic<SlabHeader*>[slabPageSize]{}, std::memory_order_release);
+            }
+
+            // slabs are aligned to their size so a block can find its slab header
+            void* const memory = ::operator new(slabSize, std::align_val_t{slabSize});
+            auto* const header = new (memory) SlabHeader{.number = number};
+            page.load(std::memory_order_relaxed)[number % slabPageSize].store(header, std::memory_order_release);
+
+            char* const begin = reinterpret_cast<char*>(header + 1);
+            uint32 const blockCount = static_cast<uint32>((slabSize - sizeof(SlabHeader)) / cls.blockSize);
+            cls.reserved.fetch_add(blockCount, std::memory_order_relaxed);
+
+            // the first batch goes straight to the caller, the rest to the free list
+            FreeBlock* first = nullptr;
+            for (uint32 start = 0; start < blockCount; start += cls.batchSize) {
+                uint32 const count = blockCount - start < cls.batchSize ? blockCount - start : cls.batchSize;
+
+                FreeBlock* next = nullptr;
+                for (uint32 index = start + count; index != start; --index) {
+                    next = new (begin + (index - 1) * cls.blockSize) FreeBlock{.next = next};
+                }
+                next->count = count;
+
+                if (first == nullptr) {
+                    first = next;
+                }
+                else {
+                    pushBatch(cls, next, count);
+                }
+            }
+            return first;
+        }
+
+        void Pool::noteAllocated(SizeClass& cls) noexcept {
+            size_t const inUse = cls.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+            size_t highWater = cls.highWater.load(std::memory_order_relaxed);
+            while (inUse > highWater &&
+                   !cls.highWater.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed)) {
+            }
+        }
+
+        ThreadCache::~ThreadCache() {
+            threadCacheDestroyed = true;
+
+            Pool& pool = Pool::instance();
+            for (uint32 index = 0; index != sizeClassCount; ++index) {
+                SizeClass& cls = pool.sizeClass(index);
+                List& list = lists[index];
+
+                while (list.head != nullptr) {
+                    FreeBlock* const first = list.head;
+                    uint32 count = 1;
+                    FreeBlock* last = first;
+                    while (last->next != nullptr && count != cls.batchSize) {
+                        last = last->next;
+                        ++count;
+                    }
+                    list.head = last->next;
+                    last->next = nullptr;
+                    pool.pushBatch(cls, first, count);
+                }
+                list.count = 0;
+            }
+        }
+    } // namespace
+} // namespace up
+
+void* up::BlockPool::allocate(size_t size) {
+    if (size > maxBlockSize) {
+        return ::operator new(size);
+    }
+
+    Pool& pool = Pool::instance();
+    uint32 const classIndex = classIndexOf(size);
+    SizeClass& cls = pool.sizeClass(classIndex);
+
+    FreeBlock* block = nullptr;
+    if (!threadCacheDestroyed) {
+        ThreadCache::List& list = threadCache.lists[classIndex];
+        if (list.head == nullptr) {
+            list.head = pool.refill(cls);
+            list.count = list.head->count;
+        }
+
+        block = list.head;
+        list.head = block->next;
+        --list.count;
+    }
+    else {
+        block = pool.refill(cls);
+        if (block->next != nullptr) {
+            pool.pushBatch(cls, block->next, block->count - 1);
+        }
+    }
+
+    pool.noteAllocated(cls);
+    return block;
+}
+
+void up::BlockPool::deallocate(void* block, size_t size) noexcept {
+    if (block == nullptr) {
+        return;
+    }
+
+    if (size > maxBlockSize) {
+        ::operator delete(block, size);
+        return;
+    }
+
+    Pool& pool = Pool::instance();
+    uint32 const classIndex = classIndexOf(size);
+    SizeClass& cls = pool.sizeClass(classIndex);
+    pool.noteFreed(cls);
+
+    auto* const freed = new (block) FreeBlock{};
+
+    if (threadCacheDestroyed) {
+        pool.pushBatch(cls, freed, 1);
+        return;
+    }
+
+    ThreadCache::List& list = threadCache.lists[classIndex];
+    freed->next = list.head;
+    list.head = freed;
+    ++list.count;
+
+    // keep one batch in the cache for reuse and hand the rest back
+    if (list.count >= 2 * cls.batchSize) {
+        FreeBlock* last = list.head;
+        for (uint32 index = 1; index != cls.batchSize; ++index) {
+            last = last->next;
+        }
+
+        FreeBlock* const surplus = list.head;
+        list.head = last->next;
+        list.count -= cls.batchSize;
+        last->next = nullptr;
+        pool.pushBatch(cls, surplus, cls.batchSize);
+    }
+}
+
+auto up::BlockPool::sizeClassCount() noexcept -> size_t {
+    return up::sizeClassCount;
+}
+
+auto up::BlockPool::sizeClassOf(size_t size) noexcept -> size_t {
+    return size > maxBlockSize ? up::sizeClassCount : classIndexOf(size);
+}
+
+auto up::BlockPool::stats(size_t sizeClass) noexcept -> BlockPoolStats {
+    UP_GUARD(sizeClass < up::sizeClassCount, BlockPoolStats{});
+
+    SizeClass const& cls = Pool::instance().sizeClass(static_cast<uint32>(sizeClass));
+    return {
+        .blockSize = cls.blockSize,
+        .reserved = cls.reserved.load(std::memory_order_relaxed),
+        .inUse = cls.inUse.load(std::memory_order_relaxed),
+        .highWater = cls.highWater.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,126 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/runtime/name.h"
+
+#include "potato/runtime/assertion.h"
+#include "potato/spud/vector.h"
+
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+
+/// Global table of interned strings.
+///
+/// Lookups take a shared lock and probe an open-addressed table of entry
+/// pointers; only a miss that must insert takes the exclusive lock. Entries
+/// are carved out of large chunks which are never released, so Names remain
+/// valid for the lifetime of the process.
+class up::Name::Table {
+public:
+    static Table& instance() {
+        // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+        static Table table;
+        return table;
+    }
+
+    Entry const* find(string_view str, uint64 hash) const {
+        std::shared_lock lock(_mutex);
+        return _find(str, hash);
+    }
+
+    Entry const* intern(string_view str, uint64 hash) {
+        UP_ASSERT(str.size() < ~uint32{0});
+
+        if (Entry const* const found = find(str, hash); found != nullptr) {
+            return found;
+        }
+
+        std::unique_lock lock(_mutex);
+
+        // another thread may have inserted the string between the locks
+        if (Entry const* const found = _find(str, hash); found != nullptr) {
+            return found;
+        }
+
+        if ((_count + 1) * 2 > _slots.size()) {
+            _grow();
+        }
+
+        Entry* const entry = _allocate(str, hash);
+        _slots[_probe(str, hash)] = entry;
+        ++_count;
+        return entry;
+    }
+
+private:
+    static constexpr size_t initialSlots = 1024;
+    static constexpr size_t chunkSize = 64 * 1024;
+
+    Entry const* _find(string_view str, uint64 hash) const noexcept {
+        return _slots.empty() ? nullptr : _slots[_probe(str, hash)];
+    }
+
+    // returns the slot holding the string or the empty slot where it belongs
+    size_t _probe(string_view str, uint64 hash) const noexcept {
+        size_t const mask = _slots.size() - 1;
+        for (size_t index = hash & mask;; index = (index + 1) & mask) {
+            Entry const* const entry = _slots[index];
+            if (entry == nullptr ||
+                (entry->hash == hash && entry->size == str.size() &&
+                 std::memcmp(entry->chars(), str.data(), str.size()) == 0)) {
+                return index;
+            }
+        }
+    }
+
+    void _grow() {
+        vector<Entry const*> old = std::move(_slots);
+        _slots.resize(old.empty() ? initialSlots : old.size() * 2);
+
+        for (Entry const* const entry : old) {
+            if (entry != nullptr) {
+                _slots[_probe({entry->chars(), entry->size}, entry->hash)] = entry;
+            }
+        }
+    }
+
+    Entry* _allocate(string_view str, uint64 hash) {
+        size_t const bytes = (sizeof(Entry) + str.size() + 1 /*NUL*/ + alignof(Entry) - 1) & ~(alignof(Entry) - 1);
+
+        if (_chunks.empty() || _chunkUsed + bytes > _chunkCapacity) {
+            _chunkCapacity = bytes > chunkSize ? bytes : chunkSize;
+            _chunks.emplace_back().resize(_chunkCapacity);
+            _chunkUsed = 0;
+        }
+
+        char* const memory = _chunks.back().data() + _chunkUsed;
+        _chunkUsed += bytes;
+
+        auto* const entry = new (memory) Entry{.hash = hash, .size = static_cast<uint32>(str.size())};
+        auto* const chars = reinterpret_cast<char*>(entry + 1);
+        std::memcpy(chars, str.data(), str.size());
+        chars[str.size()] = 0;
+        return entry;
+    }
+
+    mutable std::shared_mutex _mutex;
+    vector<Entry const*> _slots;
+    size_t _count = 0;
+    vector<vector<char>> _chunks;
+    size_t _chunkUsed = 0;
+    size_t _chunkCapacity = 0;
+};
+
+up::Name::Name(string_view str) {
+    if (!str.empty()) {
+        _entry = Table::instance().intern(str, hash_value(str));
+    }
+}
+
+auto up::Name::find(string_view str) -> Name {
+    if (str.empty()) {
+        return {};
+    }
+    return Name{Table::instance().find(str, hash_value(str))};
+}
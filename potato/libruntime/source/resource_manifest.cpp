@@ -124,7 +124,7 @@ bool up::ResourceManifest::parseManifest(string_view input, ResourceManifest& ma
                         mask |= ColumnDebugNameMask;
                     }
                     else if (column == contentTypeColumn) {
-                        record.type = string{data};
+                        record.type = Name{data};
                         mask |= ColumnContentTypeMask;
                     }
 
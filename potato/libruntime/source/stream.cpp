@@ -4,8 +4,98 @@
 
 #include "potato/spud/string.h"
 #include "potato/spud/string_writer.h"
+#include "potato/spud/numeric_util.h"
 #include "potato/spud/vector.h"
 
+#include <cstring>
+
+namespace up {
+    namespace {
+        /// Reads a byte view, or reads and writes a byte vector when one is given.
+        class MemoryBackend final : public Stream::Backend {
+        public:
+            explicit MemoryBackend(view<byte> bytes) noexcept : _bytes(bytes) { }
+            explicit MemoryBackend(vector<byte>& target) noexcept : _bytes(target), _target(&target) { }
+
+            bool isOpen() const noexcept override { return true; }
+            bool isEof() const noexcept override { return _position >= _bytes.size(); }
+            bool canRead() const noexcept override { return true; }
+            bool canWrite() const noexcept override { return _target != nullptr; }
+            bool canSeek() const noexcept override { return true; }
+
+            IOResult seek(Stream::Seek position, Stream::difference_type offset) override {
+                auto const size = static_cast<Stream::difference_type>(_bytes.size());
+                auto const base = position == Stream::Seek::Begin ? 0
+                    : position == Stream::Seek::End              ? size
+                                                                 : static_cast<Stream::difference_type>(_position);
+                if (base + offset < 0 || base + offset > size) {
+                    return IOResult::InvalidArgument;
+                }
+                _position = static_cast<size_t>(base + offset);
+                return IOResult::Success;
+            }
+            Stream::difference_type tell() const override { return static_cast<Stream::difference_type>(_position); }
+            Stream::difference_type remaining() const override {
+                return static_cast<Stream::difference_type>(_bytes.size() - _position);
+            }
+
+            IOResult read(span<byte>& buffer) override {
+                size_t const count = min(buffer.size(), _bytes.size() - _position);
+                if (count != 0) {
+                    std::memcpy(buffer.data(), _bytes.data() + _position, count);
+                }
+                _position += count;
+                buffer = buffer.first(count);
+                return IOResult::Success;
+            }
+
+            IOResult write(span<byte const> buffer) override {
+                if (_target == nullptr) {
+                    return IOResult::UnsupportedOperation;
+                }
+                if (buffer.empty()) {
+                    return IOResult::Success;
+                }
+                if (_position + buffer.size() > _target->size()) {
+                    _target->resize(_position + buffer.size());
+                }
+                std::memcpy(_target->data() + _position, buffer.data(), buffer.size());
+                _position += buffer.size();
+                _bytes = *_target;
+                return IOResult::Success;
+            }
+
+            IOResult flush() override {
+                return _target != nullptr ? IOResult::Success : IOResult::UnsupportedOperation;
+            }
+
+        private:
+            view<byte> _bytes;
+            vector<byte>* _target = nullptr;
+            size_t _position = 0;
+        };
+    } // namespace
+} // namespace up
+
+auto up::openMemoryRead(view<up::byte> bytes) -> Stream {
+    return Stream{new_box<MemoryBackend>(bytes)};
+}
+
+auto up::openMemory(vector<up::byte>& bytes) -> Stream {
+    return Stream{new_box<MemoryBackend>(bytes)};
+}
+
+auto up::readExact(Stream& stream, span<up::byte> buffer) -> IOResult {
+    if (buffer.empty()) {
+        return IOResult::Success;
+    }
+    span<up::byte> target = buffer;
+    if (IOResult const rs = stream.read(target); rs != IOResult::Success) {
+        return rs;
+    }
+    return target.size() == buffer.size() ? IOResult::Success : IOResult::Malformed;
+}
+
 auto up::readBinary(Stream& stream, vector<up::byte>& out) -> IOResult {
     if (!stream.canRead() || !stream.canSeek()) {
         return IOResult::UnsupportedOperation;
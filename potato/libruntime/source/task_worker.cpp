@@ -5,7 +5,7 @@
 #include "potato/runtime/thread_util.h"
 #include "potato/spud/string.h"
 
-up::TaskWorker::TaskWorker(ConcurrentQueue<Task>& queue, zstring_view name) : _queue(queue) {
+up::TaskWorker::TaskWorker(TaskQueue& queue, zstring_view name) : _queue(queue) {
     // just to make sure this is called at least once on the main thread...
     [[maybe_unused]] auto const _ = currentSmallThreadId();
 
@@ -0,0 +1,64 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "potato/runtime/asset.h"
+#include "potato/runtime/asset_loader.h"
+#include "potato/runtime/resource_manifest.h"
+#include "potato/spud/box.h"
+#include "potato/spud/span.h"
+#include "potato/spud/zstring_view.h"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <nanofmt/format.h>
+#include <thread>
+
+namespace test {
+    /// CAS files read by the asset tests, relative to the fixtures directory the tests run in;
+    /// kept outside of it so that the filesystem tests, which enumerate it, do not see them.
+    constexpr char casPath[] = "../cas";
+
+    /// One asset listed by makeManifest.
+    struct ManifestRecord {
+        up::zstring_view uuid;
+        up::AssetId id;
+        up::zstring_view type;
+        up::uint64 contentHash = 0;
+        up::zstring_view debugName;
+    };
+
+    /// Parses a manifest listing records, in the form recon writes them.
+    inline up::box<up::ResourceManifest> makeManifest(up::view<ManifestRecord> records) {
+        char input[1024] = {};
+        nanofmt::format_to(input, ":UUID|LOGICAL_ID|LOGICAL_NAME|CONTENT_TYPE|CONTENT_HASH|DEBUG_NAME\n");
+        for (ManifestRecord const& record : records) {
+            nanofmt::format_append_to(
+                input,
+                "{}|{:X}||{}|{:X}|{}\n",
+                record.uuid,
+                record.id.value(),
+                record.type,
+                record.contentHash,
+                record.debugName);
+        }
+
+        auto manifest = up::new_box<up::ResourceManifest>();
+        REQUIRE(up::ResourceManifest::parseManifest(input, *manifest));
+        return manifest;
+    }
+
+    inline up::box<up::ResourceManifest> makeManifest(ManifestRecord const& record) {
+        return makeManifest(up::view<ManifestRecord>{&record, 1});
+    }
+
+    /// Services reloads until none are pending; fails rather than hangs when one is lost.
+    inline void waitForReloads(up::AssetLoader& loader) {
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (loader.pendingReloadCount() != 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            loader.processReloads();
+        }
+        REQUIRE(loader.pendingReloadCount() == 0);
+    }
+} // namespace test
@@ -0,0 +1,171 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "manifest_fixture.h"
+
+#include "potato/runtime/asset_archive.h"
+#include "potato/runtime/asset_loader.h"
+#include "potato/runtime/path.h"
+#include "potato/runtime/resource_manifest.h"
+#include "potato/runtime/stream.h"
+#include "potato/spud/string.h"
+
+#include <catch2/catch.hpp>
+
+namespace {
+    // the content hashes of the files in tests/cas
+    constexpr up::uint64 firstHash = 0x1000'0000'0000'0001;
+    constexpr up::uint64 secondHash = 0x1000'0000'0000'0002;
+    constexpr up::uint64 packedHash = 0x1000'0000'0000'0003;
+
+    constexpr up::zstring_view firstFile = "10/0000/1000000000000001.bin";
+    constexpr up::zstring_view secondFile = "10/0000/1000000000000002.bin";
+
+    up::string casFile(up::string_view name) { return up::path::join(test::casPath, name); }
+
+    constexpr up::zstring_view blobUuid = "5C0A3D6E-2B4F-4E8A-8D1C-9F7E6B5A4C3D";
+
+    up::string asText(up::view<up::byte> bytes) {
+        return up::string{reinterpret_cast<char const*>(bytes.data()), bytes.size()};
+    }
+
+    class BlobAsset : public up::AssetBase<BlobAsset> {
+    public:
+        static constexpr up::zstring_view assetTypeName = "test.blob";
+
+        BlobAsset(up::AssetKey key, up::vector<up::byte> bytes) noexcept
+            : AssetBase(std::move(key))
+            , bytes(std::move(bytes)) { }
+
+        up::vector<up::byte> bytes;
+    };
+
+    class BlobLoader : public up::AssetLoaderBackend {
+    public:
+        up::zstring_view typeName() const noexcept override { return BlobAsset::assetTypeName; }
+        up::rc<up::Asset> loadFromStream(up::AssetLoadContext const& ctx) override {
+            up::vector<up::byte> bytes;
+            if (readBinary(ctx.stream, bytes) != up::IOResult::Success) {
+                return nullptr;
+            }
+            return up::new_shared<BlobAsset>(ctx.key, std::move(bytes));
+        }
+    };
+} // namespace
+
+TEST_CASE("potato.runtime.AssetArchive", "[potato][runtime]") {
+    using namespace up;
+
+    vector<byte> bytes;
+    AssetArchiveWriter writer;
+
+    SECTION("reads back what was written") {
+        writer.addFile(secondHash, casFile(secondFile));
+        writer.addFile(firstHash, casFile(firstFile));
+        writer.addFile(secondHash, casFile(secondFile));
+        Stream output = openMemory(bytes);
+        REQUIRE(writer.write(output) == IOResult::Success);
+
+        AssetArchive archive;
+        REQUIRE(archive.open(openMemoryRead(bytes)) == IOResult::Success);
+        REQUIRE(archive.entries().size() == 2);
+        CHECK(archive.entries()[0].hash == firstHash);
+        CHECK(archive.entries()[1].hash == secondHash);
+        for (AssetArchive::Entry const& entry : archive.entries()) {
+            CHECK(entry.offset % AssetArchive::alignment == 0);
+        }
+
+        vector<byte> content;
+        AssetArchive::Entry const* const second = archive.findEntry(secondHash);
+        REQUIRE(second != nullptr);
+        REQUIRE(archive.read(*second, content) == IOResult::Success);
+        CHECK(asText(content) == "second");
+
+        AssetArchive::Entry const* const first = archive.findEntry(firstHash);
+        REQUIRE(first != nullptr);
+        REQUIRE(archive.read(*first, content) == IOResult::Success);
+        CHECK(asText(content) == "first");
+
+        CHECK(archive.findEntry(packedHash) == nullptr);
+    }
+
+    SECTION("rejects malformed archives") {
+        writer.addFile(firstHash, casFile(firstFile));
+        Stream output = openMemory(bytes);
+        REQUIRE(writer.write(output) == IOResult::Success);
+
+        AssetArchive archive;
+
+        vector<byte> truncated(bytes.data(), bytes.data() + 40);
+        CHECK(archive.open(openMemoryRead(truncated)) == IOResult::Malformed);
+
+        vector<byte> corrupted(bytes.data(), bytes.data() + bytes.size());
+        corrupted[0] = byte{0};
+        CHECK(archive.open(openMemoryRead(corrupted)) == IOResult::Malformed);
+        CHECK_FALSE(archive.isOpen());
+    }
+
+    SECTION("rejects unsupported entry flags") {
+        writer.addFile(firstHash, casFile(firstFile), 1u << 31);
+        Stream output = openMemory(bytes);
+        REQUIRE(writer.write(output) == IOResult::Success);
+
+        AssetArchive archive;
+        CHECK(archive.open(openMemoryRead(bytes)) == IOResult::Malformed);
+    }
+
+    SECTION("fails on missing files") {
+        writer.addFile(packedHash, casFile("missing.bin"));
+        Stream output = openMemory(bytes);
+        CHECK(writer.write(output) != IOResult::Success);
+    }
+}
+
+TEST_CASE("potato.runtime.AssetLoader.archive", "[potato][runtime]") {
+    using namespace up;
+
+    // the archive holds content that has no loose file
+    vector<byte> bytes;
+    AssetArchiveWriter writer;
+    writer.addFile(packedHash, casFile(firstFile));
+    Stream output = openMemory(bytes);
+    REQUIRE(writer.write(output) == IOResult::Success);
+
+    auto archive = new_box<AssetArchive>();
+    REQUIRE(archive->open(openMemoryRead(bytes)) == IOResult::Success);
+
+    AssetLoader loader;
+    loader.registerBackend(new_box<BlobLoader>());
+    loader.bindArchive(std::move(archive));
+
+    auto bindManifest = [&loader](AssetId id, uint64 contentHash) {
+        loader.bindManifest(
+            test::makeManifest(
+                {.uuid = blobUuid,
+                 .id = id,
+                 .type = BlobAsset::assetTypeName,
+                 .contentHash = contentHash,
+                 .debugName = "blob.bin"}),
+            test::casPath);
+    };
+
+    AssetId const id = loader.translate(UUID::fromString(blobUuid));
+    bindManifest(id, packedHash);
+
+    AssetHandle<BlobAsset> handle = loader.loadAssetSync<BlobAsset>(id);
+    REQUIRE(handle.ready());
+    CHECK(asText(handle.asset()->bytes) == "first");
+
+    // content missing from the archive falls back to the loose files
+    bindManifest(id, secondHash);
+    test::waitForReloads(loader);
+    CHECK(asText(handle.asset()->bytes) == "second");
+
+    // reloads of packed content are read without the worker
+    bindManifest(id, packedHash);
+    loader.processReloads();
+    CHECK(loader.pendingReloadCount() == 0);
+    CHECK(asText(handle.asset()->bytes) == "first");
+
+    handle = {};
+    loader.collectDoomedAssets();
+}
@@ -0,0 +1,212 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "manifest_fixture.h"
+
+#include "potato/runtime/asset_loader.h"
+#include "potato/runtime/resource_manifest.h"
+#include "potato/runtime/stream.h"
+#include "potato/spud/string.h"
+
+#include <catch2/catch.hpp>
+
+namespace {
+    class TextAsset : public up::AssetBase<TextAsset> {
+    public:
+        static constexpr up::zstring_view assetTypeName = "test.text";
+
+        TextAsset(up::AssetKey key, up::string text) noexcept : AssetBase(std::move(key)), text(std::move(text)) { }
+
+        up::string text;
+    };
+
+    class TextLoader : public up::AssetLoaderBackend {
+    public:
+        up::zstring_view typeName() const noexcept override { return TextAsset::assetTypeName; }
+        up::rc<up::Asset> loadFromStream(up::AssetLoadContext const& ctx) override {
+            up::string text;
+            if (readText(ctx.stream, text) != up::IOResult::Success) {
+                return nullptr;
+            }
+            return up::new_shared<TextAsset>(ctx.key, std::move(text));
+        }
+    };
+
+    // the content hashes of the files in tests/cas
+    constexpr up::uint64 firstHash = 0x1000'0000'0000'0001;
+    constexpr up::uint64 secondHash = 0x1000'0000'0000'0002;
+    constexpr up::uint64 missingHash = 0x1000'0000'0000'0003;
+
+    constexpr up::zstring_view firstUuid = "F2D1B621-9A00-4263-9786-80073F493796";
+    constexpr up::zstring_view secondUuid = "0E4A6B2C-7D3F-4B8A-9C1E-5F6A7B8C9D0E";
+
+    test::ManifestRecord textRecord(up::zstring_view uuid, up::AssetId id, up::uint64 contentHash) {
+        return {
+            .uuid = uuid,
+            .id = id,
+            .type = TextAsset::assetTypeName,
+            .contentHash = contentHash,
+            .debugName = "text.txt"};
+    }
+
+    up::box<up::ResourceManifest> makeManifest(up::AssetId id, up::uint64 contentHash) {
+        return test::makeManifest(textRecord(firstUuid, id, contentHash));
+    }
+
+    // two assets of 5 and 6 bytes, so that a budget can hold either but not both
+    up::box<up::ResourceManifest> makeManifest(up::AssetId firstId, up::AssetId secondId) {
+        test::ManifestRecord const records[] = {
+            textRecord(firstUuid, firstId, firstHash),
+            textRecord(secondUuid, secondId, secondHash)};
+        return test::makeManifest(records);
+    }
+} // namespace
+
+TEST_CASE("potato.runtime.AssetLoader", "[potato][runtime]") {
+    using namespace up;
+
+    AssetLoader loader;
+    loader.registerBackend(new_box<TextLoader>());
+
+    AssetId const id = loader.translate(UUID::fromString(firstUuid));
+    loader.bindManifest(makeManifest(id, firstHash), test::casPath);
+
+    AssetHandle<TextAsset> handle = loader.loadAssetSync<TextAsset>(id);
+    REQUIRE(handle.ready());
+    CHECK(handle.asset()->text == "first");
+
+    SECTION("reloads changed assets in place") {
+        loader.bindManifest(makeManifest(id, secondHash), test::casPath);
+        CHECK(loader.pendingReloadCount() == 1);
+
+        // nothing changes until the reload is processed
+        CHECK(handle.asset()->text == "first");
+
+        test::waitForReloads(loader);
+        CHECK(loader.completedReloadCount() == 1);
+        CHECK(handle.asset()->text == "second");
+
+        AssetHandle<TextAsset> const later = loader.loadAssetSync<TextAsset>(id);
+        CHECK(later.asset() == handle.asset());
+
+        // handles follow a chain of reloads
+        loader.bindManifest(makeManifest(id, firstHash), test::casPath);
+        test::waitForReloads(loader);
+        CHECK(handle.asset()->text == "first");
+        CHECK(later.asset()->text == "first");
+    }
+
+    SECTION("later manifests supersede reloads in flight") {
+        Asset const* const original = handle.asset();
+
+        loader.bindManifest(makeManifest(id, secondHash), test::casPath);
+        loader.bindManifest(makeManifest(id, firstHash), test::casPath);
+        test::waitForReloads(loader);
+
+        CHECK(loader.completedReloadCount() == 1);
+        CHECK(handle.asset() != original);
+        CHECK(handle.asset()->text == "first");
+    }
+
+    SECTION("unchanged assets are not reloaded") {
+        loader.bindManifest(makeManifest(id, firstHash), test::casPath);
+        CHECK(loader.pendingReloadCount() == 0);
+    }
+
+    SECTION("failed reloads keep the loaded asset") {
+        loader.bindManifest(makeManifest(id, missingHash), test::casPath);
+        test::waitForReloads(loader);
+        CHECK(loader.completedReloadCount() == 0);
+        CHECK(handle.asset()->text == "first");
+    }
+
+    handle = {};
+    loader.collectDoomedAssets();
+}
+
+TEST_CASE("potato.runtime.AssetLoader.retention", "[potato][runtime]") {
+    using namespace up;
+
+    AssetLoader loader;
+    loader.registerBackend(new_box<TextLoader>());
+
+    AssetId const firstId = loader.translate(UUID::fromString(firstUuid));
+    AssetId const secondId = loader.translate(UUID::fromString(secondUuid));
+    loader.bindManifest(makeManifest(firstId, secondId), test::casPath);
+
+    SECTION("released assets are dropped without a budget") {
+        Asset const* const first = loader.loadAssetSync<TextAsset>(firstId).asset();
+        REQUIRE(first != nullptr);
+        CHECK(first->sizeEstimate() == 5);
+
+        loader.collectDoomedAssets();
+        CHECK(loader.cacheStats().residentBytes == 0);
+
+        REQUIRE(loader.loadAssetSync<TextAsset>(firstId).ready());
+        CHECK(loader.cacheStats().hits == 0);
+        CHECK(loader.cacheStats().misses == 2);
+    }
+
+    SECTION("released assets are resurrected from the cache") {
+        loader.setRetentionBudget(16);
+
+        Asset const* const first = loader.loadAssetSync<TextAsset>(firstId).asset();
+        loader.collectDoomedAssets();
+        CHECK(loader.cacheStats().residentBytes == 5);
+
+        AssetHandle<TextAsset> const handle = loader.loadAssetSync<TextAsset>(firstId);
+        CHECK(handle.asset() == first);
+        CHECK(handle.asset()->text == "first");
+        CHECK(loader.cacheStats().residentBytes == 0);
+        CHECK(loader.cacheStats().hits == 1);
+        CHECK(loader.cacheStats().misses == 1);
+        CHECK(loader.cacheStats().hitRate() == 0.5);
+
+        // assets in use are never evicted
+        loader.setRetentionBudget(1);
+        loader.collectDoomedAssets();
+        CHECK(handle.asset()->text == "first");
+        CHECK(loader.cacheStats().evictions == 0);
+    }
+
+    SECTION("the least recently released asset is evicted first") {
+        loader.setRetentionBudget(8);
+
+        AssetHandle<TextAsset> first = loader.loadAssetSync<TextAsset>(firstId);
+        AssetHandle<TextAsset> second = loader.loadAssetSync<TextAsset>(secondId);
+
+        first = {};
+        loader.collectDoomedAssets();
+        second = {};
+        loader.collectDoomedAssets();
+        CHECK(loader.cacheStats().evictions == 1);
+        CHECK(loader.cacheStats().residentBytes == 6);
+
+        REQUIRE(loader.loadAssetSync<TextAsset>(secondId).ready());
+        REQUIRE(loader.loadAssetSync<TextAsset>(firstId).ready());
+        CHECK(loader.cacheStats().hits == 1);
+        CHECK(loader.cacheStats().misses == 3);
+
+        loader.collectDoomedAssets();
+        loader.setRetentionBudget(0);
+        CHECK(loader.cacheStats().residentBytes == 0);
+        CHECK(loader.cacheStats().evictions == 3);
+    }
+
+    SECTION("changed assets are dropped from the cache") {
+        loader.setRetentionBudget(16);
+
+        REQUIRE(loader.loadAssetSync<TextAsset>(firstId).ready());
+        loader.collectDoomedAssets();
+        CHECK(loader.cacheStats().residentBytes == 5);
+
+        loader.bindManifest(makeManifest(firstId, secondHash), test::casPath);
+        CHECK(loader.pendingReloadCount() == 0);
+        CHECK(loader.cacheStats().residentBytes == 0);
+
+        AssetHandle<TextAsset> const handle = loader.loadAssetSync<TextAsset>(firstId);
+        CHECK(handle.asset()->text == "second");
+        CHECK(loader.cacheStats().hits == 0);
+    }
+
+    loader.collectDoomedAssets();
+}
@@ -0,0 +1,184 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/runtime/block_pool.h"
+#include "potato/spud/box.h"
+#include "potato/spud/rc.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace {
+    struct PooledBase : up::PoolAllocated {
+        virtual ~PooledBase() = default;
+        int value = 0;
+    };
+
+    struct PooledDerived : PooledBase {
+        char payload[200] = {};
+    };
+
+    struct PooledShared
+        : up::shared<PooledShared>
+        , up::PoolAllocated {
+        char payload[40] = {};
+    };
+
+    struct alignas(64) PooledOverAligned : up::PoolAllocated {
+        char payload[64] = {};
+    };
+} // namespace
+
+TEST_CASE("potato.runtime.BlockPool", "[potato][runtime]") {
+    using namespace up;
+
+    SECTION("size classes") {
+        CHECK(BlockPool::sizeClassOf(1) == 0);
+        CHECK(BlockPool::sizeClassOf(16) == 0);
+        CHECK(BlockPool::sizeClassOf(17) == 1);
+        CHECK(BlockPool::sizeClassOf(BlockPool::maxBlockSize) == BlockPool::sizeClassCount() - 1);
+        CHECK(BlockPool::sizeClassOf(BlockPool::maxBlockSize + 1) == BlockPool::sizeClassCount());
+
+        for (size_t sizeClass = 0; sizeClass != BlockPool::sizeClassCount(); ++sizeClass) {
+            size_t const blockSize = BlockPool::stats(sizeClass).blockSize;
+            CHECK(BlockPool::sizeClassOf(blockSize) == sizeClass);
+            CHECK(blockSize % BlockPool::blockAlignment == 0);
+        }
+    }
+
+    SECTION("allocate and reuse") {
+        void* const first = BlockPool::allocate(24);
+        CHECK(reinterpret_cast<uintptr_t>(first) % BlockPool::blockAlignment == 0);
+        std::memset(first, 0xcd, 24);
+        BlockPool::deallocate(first, 24);
+
+        // the thread cache hands back the most recently freed block
+        void* const second = BlockPool::allocate(32);
+        CHECK(second == first);
+        BlockPool::deallocate(second, 32);
+    }
+
+    SECTION("occupancy") {
+        size_t const sizeClass = BlockPool::sizeClassOf(100);
+        BlockPoolStats const before = BlockPool::stats(sizeClass);
+
+        vector<void*> blocks;
+        for (int index = 0; index != 1000; ++index) {
+            blocks.push_back(BlockPool::allocate(100));
+        }
+
+        BlockPoolStats const during = BlockPool::stats(sizeClass);
+        CHECK(during.inUse == before.inUse + 1000);
+        CHECK(during.highWater >= during.inUse);
+        CHECK(during.reserved >= during.inUse);
+
+        for (void* block : blocks) {
+            BlockPool::deallocate(block, 100);
+        }
+
+        BlockPoolStats const after = BlockPool::stats(sizeClass);
+        CHECK(after.inUse == before.inUse);
+        CHECK(after.highWater == during.highWater);
+
+        // freed blocks are recycled instead of growing the pool
+        for (void*& block : blocks) {
+            block = BlockPool::allocate(100);
+        }
+        CHECK(BlockPool::stats(sizeClass).reserved == during.reserved);
+        for (void* block : blocks) {
+            BlockPool::deallocate(block, 100);
+        }
+    }
+
+    SECTION("large allocations") {
+        size_t const reserved = BlockPool::stats(BlockPool::sizeClassCount() - 1).reserved;
+        void* const block = BlockPool::allocate(BlockPool::maxBlockSize + 1);
+        CHECK(block != nullptr);
+        BlockPool::deallocate(block, BlockPool::maxBlockSize + 1);
+        CHECK(BlockPool::stats(BlockPool::sizeClassCount() - 1).reserved == reserved);
+    }
+
+    SECTION("PoolAllocated") {
+        size_t const sizeClass = BlockPool::sizeClassOf(sizeof(PooledDerived));
+        size_t const inUse = BlockPool::stats(sizeClass).inUse;
+
+        box<PooledBase> boxed = new_box<PooledDerived>();
+        CHECK(BlockPool::stats(sizeClass).inUse == inUse + 1);
+
+        // deleting through the base returns the block to the derived type's size class
+        boxed.reset();
+        CHECK(BlockPool::stats(sizeClass).inUse == inUse);
+
+        size_t const sharedClass = BlockPool::sizeClassOf(sizeof(PooledShared));
+        size_t const sharedInUse = BlockPool::stats(sharedClass).inUse;
+        {
+            rc<PooledShared> shared = new_shared<PooledShared>();
+            rc<PooledShared> copy = shared;
+            CHECK(BlockPool::stats(sharedClass).inUse == sharedInUse + 1);
+        }
+        CHECK(BlockPool::stats(sharedClass).inUse == sharedInUse);
+
+        box<PooledOverAligned> aligned = new_box<PooledOverAligned>();
+        CHECK(reinterpret_cast<uintptr_t>(aligned.get()) % 64 == 0);
+    }
+
+    SECTION("concurrency") {
+        constexpr int threadCount = 4;
+        constexpr int iterations = 20000;
+
+        size_t const sizeClass = BlockPool::sizeClassOf(48);
+        size_t const inUse = BlockPool::stats(sizeClass).inUse;
+
+        // blocks allocated on one thread are freed on the next, so they
+        // migrate between thread caches through the global free list
+        vector<vector<void*>> handoff(threadCount);
+        for (auto& blocks : handoff) {
+            blocks.reserve(iterations);
+        }
+
+        vector<std::thread> threads;
+        for (int thread = 0; thread != threadCount; ++thread) {
+            threads.emplace_back([&blocks = handoff[thread], thread] {
+                for (int index = 0; index != iterations; ++index) {
+                    auto* const block = static_cast<int*>(BlockPool::allocate(48));
+                    *block = thread;
+                    blocks.push_back(block);
+
+                    if (index % 3 == 0) {
+                        BlockPool::deallocate(blocks.back(), 48);
+                        blocks.pop_back();
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        threads.clear();
+
+        CHECK(BlockPool::stats(sizeClass).inUse == inUse + handoff.size() * (iterations - (iterations + 2) / 3));
+
+        bool intact = true;
+        for (int thread = 0; thread != threadCount; ++thread) {
+            for (void* block : handoff[thread]) {
+                intact = intact && *static_cast<int*>(block) == thread;
+            }
+        }
+        CHECK(intact);
+
+        for (int thread = 0; thread != threadCount; ++thread) {
+            threads.emplace_back([&blocks = handoff[(thread + 1) % threadCount]] {
+                for (void* block : blocks) {
+                    BlockPool::deallocate(block, 48);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        CHECK(BlockPool::stats(sizeClass).inUse == inUse);
+    }
+}
@@ -0,0 +1,88 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/runtime/name.h"
+#include "potato/spud/string_writer.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <thread>
+
+TEST_CASE("potato.runtime.Name", "[potato][runtime]") {
+    using namespace up;
+
+    SECTION("empty") {
+        Name empty;
+        CHECK(empty.empty());
+        CHECK(empty.size() == 0);
+        CHECK(empty.c_str() != nullptr);
+        CHECK(Name{""} == empty);
+        CHECK(hash_value(empty) == hash_value(string_view{}));
+    }
+
+    SECTION("interning") {
+        Name const first{"potato.test.name"};
+        string_writer buffer;
+        buffer.append("potato.test.");
+        buffer.append("name");
+        Name const second{string_view{buffer}};
+
+        CHECK(first == second);
+        CHECK(first.c_str() == second.c_str());
+        CHECK(first == "potato.test.name"_sv);
+        CHECK(first != Name{"potato.test.other"});
+        CHECK(first.size() == 16);
+        CHECK(first.c_str()[first.size()] == 0);
+    }
+
+    SECTION("hashing") {
+        Name const name{"potato.test.hash"};
+        CHECK(hash_value(name) == hash_value("potato.test.hash"_sv));
+    }
+
+    SECTION("find") {
+        CHECK(Name::find("potato.test.never_interned").empty());
+
+        Name const name{"potato.test.found"};
+        CHECK(Name::find("potato.test.found") == name);
+    }
+
+    SECTION("growth") {
+        vector<Name> names;
+        for (int index = 0; index != 5000; ++index) {
+            string_writer buffer;
+            buffer.format("potato.test.growth.{}", index);
+            names.push_back(Name{string_view{buffer}});
+        }
+        for (int index = 0; index != 5000; ++index) {
+            string_writer buffer;
+            buffer.format("potato.test.growth.{}", index);
+            CHECK(Name::find(buffer) == names[index]);
+        }
+    }
+
+    SECTION("concurrency") {
+        constexpr int threadCount = 4;
+        constexpr int nameCount = 1000;
+
+        vector<vector<Name>> results(threadCount);
+        vector<std::thread> threads;
+        for (int thread = 0; thread != threadCount; ++thread) {
+            threads.emplace_back([&names = results[thread]] {
+                for (int index = 0; index != nameCount; ++index) {
+                    string_writer buffer;
+                    buffer.format("potato.test.concurrent.{}", index);
+                    names.push_back(Name{string_view{buffer}});
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        for (int thread = 1; thread != threadCount; ++thread) {
+            for (int index = 0; index != nameCount; ++index) {
+                CHECK(results[thread][index] == results[0][index]);
+            }
+        }
+    }
+}
@@ -0,0 +1,177 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/runtime/segmented_queue.h"
+#include "potato/spud/box.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <thread>
+
+namespace {
+    struct Tracked {
+        explicit Tracked(std::atomic<int>& live) : live(&live) { ++live; }
+        Tracked(Tracked const& rhs) : live(rhs.live) { ++*live; }
+        Tracked& operator=(Tracked const&) = default;
+        ~Tracked() { --*live; }
+
+        std::atomic<int>* live = nullptr;
+    };
+} // namespace
+
+TEST_CASE("potato.runtime.SegmentedQueue", "[potato][runtime]") {
+    using namespace up;
+
+    SECTION("default") { SegmentedQueue<int> queue; }
+
+    SECTION("sequential") {
+        // a small segment size exercises segment changes and recycling
+        SegmentedQueue<int, 4> queue;
+        CHECK(queue.empty());
+
+        for (int round = 0; round != 3; ++round) {
+            for (int i = 0; i != 1000; ++i) {
+                CHECK(queue.tryEnque(i));
+            }
+            CHECK(!queue.empty());
+
+            for (int i = 0; i != 1000; ++i) {
+                int result = -1;
+                REQUIRE(queue.tryDeque(result));
+                CHECK(result == i);
+            }
+
+            int empty = -1;
+            CHECK(!queue.tryDeque(empty));
+            CHECK(queue.empty());
+        }
+    }
+
+    SECTION("move-only") {
+        SegmentedQueue<box<int>, 4> queue;
+        for (int i = 0; i != 10; ++i) {
+            CHECK(queue.tryEnque(new_box<int>(i)));
+        }
+
+        box<int> result;
+        REQUIRE(queue.tryDeque(result));
+        CHECK(*result == 0);
+    }
+
+    SECTION("destroys remaining elements") {
+        std::atomic<int> live = 0;
+        {
+            SegmentedQueue<Tracked, 4> queue;
+            for (int i = 0; i != 10; ++i) {
+                CHECK(queue.tryEnque(Tracked{live}));
+            }
+
+            Tracked out{live};
+            REQUIRE(queue.tryDeque(out));
+            CHECK(live == 10);
+        }
+        CHECK(live == 0);
+    }
+
+    SECTION("close") {
+        SegmentedQueue<int> queue;
+        CHECK(queue.tryEnque(1));
+        queue.close();
+
+        CHECK(queue.isClosed());
+        CHECK(!queue.tryEnque(2));
+
+        // elements enqueued before closing are still delivered
+        int result = 0;
+        CHECK(queue.dequeWait(result));
+        CHECK(result == 1);
+        CHECK(!queue.dequeWait(result));
+    }
+
+    SECTION("parked consumer") {
+        SegmentedQueue<int> queue;
+
+        int last = 0;
+        auto consumer = std::thread([&] {
+            int value = 0;
+            while (queue.dequeWait(value)) {
+                last = value;
+            }
+        });
+
+        for (int i = 0; i != 1024; ++i) {
+            queue.enqueWait(i);
+            if (i % 256 == 0) {
+                // give the consumer a chance to drain the queue and park
+                queue.waitUntilEmpty();
+            }
+        }
+        queue.waitUntilEmpty();
+        queue.close();
+        consumer.join();
+
+        CHECK(last == 1023);
+    }
+
+    SECTION("stress") {
+        constexpr int producerCount = 4;
+        constexpr int consumerCount = 4;
+        constexpr int itemCount = 50000;
+
+        SegmentedQueue<int, 8> queue;
+
+        vector<vector<int>> received(consumerCount);
+        vector<std::thread> consumers;
+        for (int consumer = 0; consumer != consumerCount; ++consumer) {
+            consumers.emplace_back([&queue, &items = received[consumer]] {
+                int value = 0;
+                while (queue.dequeWait(value)) {
+                    items.push_back(value);
+                }
+            });
+        }
+
+        std::atomic<int> rejected = 0;
+        vector<std::thread> producers;
+        for (int producer = 0; producer != producerCount; ++producer) {
+            producers.emplace_back([&queue, &rejected, producer] {
+                for (int index = 0; index != itemCount; ++index) {
+                    if (!queue.tryEnque(producer * itemCount + index)) {
+                        ++rejected;
+                    }
+                }
+            });
+        }
+
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+        queue.waitUntilEmpty();
+        queue.close();
+        for (std::thread& consumer : consumers) {
+            consumer.join();
+        }
+
+        // every item arrives exactly once, and each consumer sees a
+        // producer's items in the order they were enqueued
+        vector<int> seen(producerCount * itemCount);
+        bool ordered = true;
+        for (vector<int> const& items : received) {
+            int last[producerCount] = {-1, -1, -1, -1};
+            for (int value : items) {
+                ++seen[value];
+                int const producer = value / itemCount;
+                ordered = ordered && value > last[producer];
+                last[producer] = value;
+            }
+        }
+        CHECK(rejected == 0);
+        CHECK(ordered);
+
+        bool once = true;
+        for (int count : seen) {
+            once = once && count == 1;
+        }
+        CHECK(once);
+    }
+}
@@ -0,0 +1,58 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/runtime/stream.h"
+#include "potato/spud/string.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("potato.runtime.Stream", "[potato][runtime]") {
+    using namespace up;
+
+    SECTION("memory streams write, seek and read") {
+        vector<byte> bytes;
+        Stream stream = openMemory(bytes);
+        REQUIRE(stream.canWrite());
+        REQUIRE(writeAllText(stream, "hello world") == IOResult::Success);
+        CHECK(bytes.size() == 11);
+        CHECK(stream.isEof());
+
+        // writes overwrite at the current position and grow past the end
+        REQUIRE(stream.seek(Stream::Seek::Begin, 6) == IOResult::Success);
+        REQUIRE(writeAllText(stream, "potato") == IOResult::Success);
+        CHECK(bytes.size() == 12);
+
+        REQUIRE(stream.seek(Stream::Seek::Begin, 0) == IOResult::Success);
+        string text;
+        REQUIRE(readText(stream, text) == IOResult::Success);
+        CHECK(text == "hello potato");
+
+        CHECK(stream.seek(Stream::Seek::Current, 1) == IOResult::InvalidArgument);
+        CHECK(stream.seek(Stream::Seek::End, -13) == IOResult::InvalidArgument);
+    }
+
+    SECTION("memory read streams only read") {
+        char const data[] = "abc";
+        Stream stream = openMemoryRead(span{data, 3}.as_bytes());
+        CHECK_FALSE(stream.canWrite());
+        CHECK(writeAllText(stream, "x") == IOResult::UnsupportedOperation);
+
+        REQUIRE(stream.seek(Stream::Seek::End, -1) == IOResult::Success);
+        vector<byte> tail;
+        REQUIRE(readBinary(stream, tail) == IOResult::Success);
+        REQUIRE(tail.size() == 1);
+        CHECK(tail[0] == byte{'c'});
+        CHECK(stream.isEof());
+    }
+
+    SECTION("readExact reports truncated data") {
+        char const data[] = "abcd";
+        Stream stream = openMemoryRead(span{data, 4}.as_bytes());
+
+        byte buffer[3] = {};
+        CHECK(readExact(stream, buffer) == IOResult::Success);
+        CHECK(buffer[2] == byte{'c'});
+        CHECK(readExact(stream, {}) == IOResult::Success);
+        CHECK(readExact(stream, buffer) == IOResult::Malformed);
+    }
+}
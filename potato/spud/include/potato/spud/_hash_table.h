@@ -3,14 +3,18 @@
 #pragma once
 
 #include "hash.h"
+#include "memory_resource.h"
 #include "platform.h"
 #include "utility.h"
 
 #if UP_ARCH_INTEL
 #    include <emmintrin.h>
 #    include <tmmintrin.h>
-#else
-#    error "Unsupported architecture"
+#    if defined(__AVX2__)
+#        include <immintrin.h>
+#    endif
+#elif UP_ARCH_ARM64
+#    include <arm_neon.h>
 #endif
 
 #include <bit>
@@ -41,12 +45,79 @@ namespace up::_detail::hash_table {
         Value value;
     };
 
+    // Group match operations; each returns a bitmask with bit N set if slot N
+    // of the WIDTH-slot group at control matches.
+    //
+    // A backend may also set groupsPerStep to 2 and provide match2/matchEmpty2,
+    // which examine two (not necessarily adjacent) groups at once and return
+    // the first group's mask in the low 16 bits and the second's in the high bits.
+
+    /// Portable fallback operating on the group as two 64-bit words.
+    struct match_ops_swar {
+        static constexpr int groupsPerStep = 1;
+
+        static inline unsigned match(int8 const* control, int8 match) noexcept;
+        static inline unsigned matchEmpty(int8 const* control) noexcept;
+        static inline unsigned matchEmptyOrTombstone(int8 const* control) noexcept;
+        static inline unsigned matchFull(int8 const* control) noexcept;
+
+        static constexpr uint64 _broadcast(int8 value) noexcept {
+            return static_cast<uint8>(value) * 0x0101'0101'0101'0101ull;
+        }
+        static constexpr uint64 _zeroBytes(uint64 word) noexcept;
+        static constexpr unsigned _packHighBits(uint64 word) noexcept;
+        static inline uint64 _load(int8 const* control) noexcept;
+        static inline unsigned _matchBytes(int8 const* control, uint64 pattern) noexcept;
+    };
+
+#if UP_ARCH_INTEL
     struct match_ops_sse {
+        static constexpr int groupsPerStep = 1;
+
+        static inline unsigned match(int8 const* control, int8 match) noexcept;
+        static inline unsigned matchEmpty(int8 const* control) noexcept;
+        static inline unsigned matchEmptyOrTombstone(int8 const* control) noexcept;
+        static inline unsigned matchFull(int8 const* control) noexcept;
+    };
+#endif
+
+#if UP_ARCH_INTEL && defined(__AVX2__)
+    /// SSE group matching, plus a 256-bit path used by lookups to test a group
+    /// and the next group in its probe sequence in one step.
+    struct match_ops_avx2 : match_ops_sse {
+        static constexpr int groupsPerStep = 2;
+
+        static inline uint32 match2(int8 const* first, int8 const* second, int8 match) noexcept;
+        static inline uint32 matchEmpty2(int8 const* first, int8 const* second) noexcept;
+
+        static inline __m256i _load2(int8 const* first, int8 const* second) noexcept;
+    };
+#endif
+
+#if UP_ARCH_ARM64
+    struct match_ops_neon {
+        static constexpr int groupsPerStep = 1;
+
         static inline unsigned match(int8 const* control, int8 match) noexcept;
         static inline unsigned matchEmpty(int8 const* control) noexcept;
         static inline unsigned matchEmptyOrTombstone(int8 const* control) noexcept;
         static inline unsigned matchFull(int8 const* control) noexcept;
+
+        static inline unsigned _movemask(uint8x16_t mask) noexcept;
     };
+#endif
+
+    // the paired AVX2 lookup is opt-in; at typical load factors most lookups
+    // resolve in their first group, so the wider compare rarely pays for itself
+#if UP_ARCH_INTEL && defined(__AVX2__) && defined(UP_SPUD_HASH_TABLE_AVX2)
+    using match_ops = match_ops_avx2;
+#elif UP_ARCH_INTEL
+    using match_ops = match_ops_sse;
+#elif UP_ARCH_ARM64
+    using match_ops = match_ops_neon;
+#else
+    using match_ops = match_ops_swar;
+#endif
 
     template <typename Item>
     struct memory_ops {
@@ -55,8 +126,12 @@ namespace up::_detail::hash_table {
         static constexpr size_t padding(size_t groups) noexcept;
         static constexpr size_t size(size_t groups) noexcept;
 
-        static void allocate(size_t groups, int8*& out_control, Item*& out_items);
-        static void deallocate(size_t groups, void* data);
+        static void allocate(
+            size_t groups,
+            int8*& out_control,
+            Item*& out_items,
+            memory_resource* resource = nullptr);
+        static void deallocate(size_t groups, void* data, memory_resource* resource = nullptr);
     };
 
     template <typename Hash>
@@ -88,6 +163,56 @@ namespace up::_detail::hash_table {
         static bool clear(size_t groups, int8* control, Item* items) noexcept;
     };
 
+    constexpr uint64 match_ops_swar::_zeroBytes(uint64 word) noexcept {
+        // sets the high bit of exactly those bytes which are zero; unlike the
+        // cheaper (x - 0x01..) & ~x form this has no false positives from borrows
+        constexpr uint64 low7 = 0x7f7f'7f7f'7f7f'7f7full;
+        return ~(((word & low7) + low7) | word | low7);
+    }
+
+    constexpr unsigned match_ops_swar::_packHighBits(uint64 word) noexcept {
+        // gathers the high bit of each byte into the low 8 bits, byte 0 first
+        return static_cast<unsigned>((((word >> 7) & 0x0101'0101'0101'0101ull) * 0x0102'0408'1020'4080ull) >> 56);
+    }
+
+    uint64 match_ops_swar::_load(int8 const* control) noexcept {
+        // assembled bytewise so that byte 0 is always the low byte; this is a
+        // single load on little-endian targets
+        uint64 word = 0;
+        for (int index = 0; index != 8; ++index) {
+            word |= static_cast<uint64>(static_cast<uint8>(control[index])) << (index * 8);
+        }
+        return word;
+    }
+
+    unsigned match_ops_swar::_matchBytes(int8 const* control, uint64 pattern) noexcept {
+        return _packHighBits(_zeroBytes(_load(control) ^ pattern)) |
+            (_packHighBits(_zeroBytes(_load(control + 8) ^ pattern)) << 8);
+    }
+
+    unsigned match_ops_swar::match(int8 const* control, int8 match) noexcept {
+        return _matchBytes(control, _broadcast(match));
+    }
+
+    unsigned match_ops_swar::matchEmpty(int8 const* control) noexcept {
+        return _matchBytes(control, _broadcast(constants::EMPTY));
+    }
+
+    unsigned match_ops_swar::matchEmptyOrTombstone(int8 const* control) noexcept {
+        // control bytes are either full (high bit clear), EMPTY, or TOMBSTONE
+        // so this is every byte with the high bit set other than SPECIAL
+        constexpr uint64 special = _broadcast(constants::SPECIAL);
+        uint64 const low = _load(control);
+        uint64 const high = _load(control + 8);
+        return _packHighBits(low & ~_zeroBytes(low ^ special)) |
+            (_packHighBits(high & ~_zeroBytes(high ^ special)) << 8);
+    }
+
+    unsigned match_ops_swar::matchFull(int8 const* control) noexcept {
+        return ~matchEmptyOrTombstone(control) & 0xffff;
+    }
+
+#if UP_ARCH_INTEL
     unsigned match_ops_sse::match(int8 const* control, int8 match) noexcept {
         auto const* const slots = reinterpret_cast<__m128i const*>(control);
         return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(slots), _mm_set1_epi8(match)));
@@ -105,6 +230,52 @@ namespace up::_detail::hash_table {
     }
 
     unsigned match_ops_sse::matchFull(int8 const* control) noexcept { return ~matchEmptyOrTombstone(control) & 0xffff; }
+#endif
+
+#if UP_ARCH_INTEL && defined(__AVX2__)
+    __m256i match_ops_avx2::_load2(int8 const* first, int8 const* second) noexcept {
+        return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first))),
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(second)),
+            1);
+    }
+
+    uint32 match_ops_avx2::match2(int8 const* first, int8 const* second, int8 match) noexcept {
+        auto const slots = _load2(first, second);
+        return static_cast<uint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(slots, _mm256_set1_epi8(match))));
+    }
+
+    uint32 match_ops_avx2::matchEmpty2(int8 const* first, int8 const* second) noexcept {
+        auto const slots = _load2(first, second);
+        return static_cast<uint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(slots, _mm256_set1_epi8(constants::EMPTY))));
+    }
+#endif
+
+#if UP_ARCH_ARM64
+    unsigned match_ops_neon::_movemask(uint8x16_t mask) noexcept {
+        // NEON has no movemask; weight each lane by its bit and sum each half
+        static constexpr uint8 weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t const bits = vandq_u8(mask, vld1q_u8(weights));
+        return static_cast<unsigned>(vaddv_u8(vget_low_u8(bits))) |
+            (static_cast<unsigned>(vaddv_u8(vget_high_u8(bits))) << 8);
+    }
+
+    unsigned match_ops_neon::match(int8 const* control, int8 match) noexcept {
+        return _movemask(vceqq_s8(vld1q_s8(control), vdupq_n_s8(match)));
+    }
+
+    unsigned match_ops_neon::matchEmpty(int8 const* control) noexcept {
+        return _movemask(vceqq_s8(vld1q_s8(control), vdupq_n_s8(constants::EMPTY)));
+    }
+
+    unsigned match_ops_neon::matchEmptyOrTombstone(int8 const* control) noexcept {
+        return _movemask(vcltq_s8(vld1q_s8(control), vdupq_n_s8(constants::SPECIAL)));
+    }
+
+    unsigned match_ops_neon::matchFull(int8 const* control) noexcept {
+        return _movemask(vcgeq_s8(vld1q_s8(control), vdupq_n_s8(0)));
+    }
+#endif
 
     template <typename Item>
     constexpr auto memory_ops<Item>::padding(size_t groups) noexcept -> size_t {
@@ -120,14 +291,18 @@ namespace up::_detail::hash_table {
     }
 
     template <typename Item>
-    void memory_ops<Item>::allocate(size_t groups, int8*& out_control, Item*& out_items) {
+    void memory_ops<Item>::allocate(
+        size_t groups,
+        int8*& out_control,
+        Item*& out_items,
+        memory_resource* resource) {
         using constants = constants;
 
         auto const bytes = size(groups);
         auto const slots = groups * constants::WIDTH;
         auto const itemsOffset = sizeof(int8) * slots + padding(groups);
 
-        void* const data = operator new(bytes, std::align_val_t(alignment));
+        void* const data = allocate_from(resource, bytes, alignment);
 
         out_control = static_cast<int8*>(data);
         out_items = reinterpret_cast<Item*>(static_cast<char*>(data) + itemsOffset);
@@ -136,8 +311,8 @@ namespace up::_detail::hash_table {
     }
 
     template <typename Item>
-    void memory_ops<Item>::deallocate(size_t groups, void* data) {
-        ::operator delete(data, size(groups), std::align_val_t(alignment));
+    void memory_ops<Item>::deallocate(size_t groups, void* data, memory_resource* resource) {
+        deallocate_to(resource, data, size(groups), alignment);
     }
 
     template <typename Item, typename Key, typename Hash, typename Equality, typename HashOps, typename MatchOps>
@@ -153,6 +328,38 @@ namespace up::_detail::hash_table {
         auto const h2 = HashOps::_h2(hash);
         size_t probe = 1;
 
+        if constexpr (MatchOps::groupsPerStep == 2) {
+            // test a group and its successor in the probe sequence together;
+            // the sequence itself is unchanged
+            for (;;) {
+                size_t const nextGroup = (group + probe) & (groups - 1);
+                size_t const indices[2] = {group * constants::WIDTH, nextGroup * constants::WIDTH};
+
+                uint32 matches = MatchOps::match2(control + indices[0], control + indices[1], h2);
+                uint32 const empties = MatchOps::matchEmpty2(control + indices[0], control + indices[1]);
+
+                for (int half = 0; half != 2; ++half) {
+                    unsigned groupMatches = (matches >> (half * constants::WIDTH)) & 0xffff;
+                    while (groupMatches != 0) {
+                        size_t index = indices[half] + std::countr_zero(groupMatches);
+
+                        if (Equality{}(items[index], key)) {
+                            return index;
+                        }
+
+                        groupMatches &= groupMatches - 1;
+                    }
+
+                    if (((empties >> (half * constants::WIDTH)) & 0xffff) != 0) {
+                        return constants::SENTINEL;
+                    }
+                }
+
+                group = (nextGroup + probe + 1) & (groups - 1);
+                probe += 2;
+            }
+        }
+
         for (;;) {
             auto const alignedIndex = group * constants::WIDTH;
 
@@ -0,0 +1,168 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "memory_resource.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace up {
+    /// Bump allocator over a list of blocks.
+    ///
+    /// Individual deallocations are ignored; memory is reclaimed all at once
+    /// by reset() or rewind(). Blocks are kept for reuse across resets, so an
+    /// arena that has reached its steady-state size no longer allocates.
+    class arena_resource final : public memory_resource {
+    public:
+        static constexpr size_t default_block_size = 64 * 1024;
+
+        /// Position in the arena that may later be rewound to.
+        struct marker {
+            void* block = nullptr;
+            size_t offset = 0;
+        };
+
+        explicit arena_resource(size_t blockSize = default_block_size) noexcept : _blockSize(blockSize) { }
+        ~arena_resource() override { release(); }
+
+        arena_resource(arena_resource const&) = delete;
+        arena_resource& operator=(arena_resource const&) = delete;
+
+        [[nodiscard]] void* allocate(size_t size, size_t alignment) override;
+        void deallocate(void*, size_t, size_t) noexcept override { }
+
+        /// Total size of all blocks owned by the arena.
+        size_t capacity() const noexcept { return _capacity; }
+
+        marker mark() const noexcept { return {_current, _offset}; }
+
+        /// Frees everything allocated since the marker was taken.
+        void rewind(marker mark) noexcept {
+            _current = static_cast<block*>(mark.block);
+            _offset = mark.offset;
+        }
+
+        /// Frees everything allocated from the arena but keeps its blocks.
+        void reset() noexcept { rewind({}); }
+
+        /// Frees everything allocated from the arena and returns its blocks.
+        inline void release() noexcept;
+
+    private:
+        struct alignas(std::max_align_t) block {
+            block* next = nullptr;
+            size_t size = 0;
+
+            char* data() noexcept { return reinterpret_cast<char*>(this + 1); }
+        };
+
+        inline void* _allocateFrom(block* target, size_t offset, size_t size, size_t alignment) noexcept;
+
+        block* _first = nullptr;
+        block* _last = nullptr;
+        block* _current = nullptr;
+        size_t _offset = 0;
+        size_t _capacity = 0;
+        size_t _blockSize = default_block_size;
+    };
+
+    /// Double-buffered arena for data that lives for a single frame.
+    ///
+    /// Memory allocated during a frame remains valid until the end of the
+    /// following frame, so a frame may still be consumed while the next one is
+    /// being built. The frame loop calls flip() once at the start of each frame.
+    class frame_arena {
+    public:
+        explicit frame_arena(size_t blockSize = arena_resource::default_block_size) noexcept
+            : _arenas{arena_resource{blockSize}, arena_resource{blockSize}} { }
+
+        memory_resource* resource() noexcept { return &_arenas[_index]; }
+
+        void flip() noexcept {
+            _index ^= 1;
+            _arenas[_index].reset();
+        }
+
+        size_t capacity() const noexcept { return _arenas[0].capacity() + _arenas[1].capacity(); }
+
+    private:
+        arena_resource _arenas[2];
+        int _index = 0;
+    };
+
+    /// Scoped allocation from the calling thread's scratch arena.
+    ///
+    /// Everything allocated from resource() is freed when the scope ends;
+    /// scopes nest, and must be destroyed in the reverse order of creation.
+    class scratch_scope {
+    public:
+        scratch_scope() noexcept : _arena(thread_arena()), _mark(_arena.mark()) { }
+        ~scratch_scope() { _arena.rewind(_mark); }
+
+        scratch_scope(scratch_scope const&) = delete;
+        scratch_scope& operator=(scratch_scope const&) = delete;
+
+        memory_resource* resource() noexcept { return &_arena; }
+
+        static arena_resource& thread_arena() noexcept {
+            thread_local arena_resource arena;
+            return arena;
+        }
+
+    private:
+        arena_resource& _arena;
+        arena_resource::marker _mark;
+    };
+
+    void* arena_resource::_allocateFrom(block* target, size_t offset, size_t size, size_t alignment) noexcept {
+        char* const base = target->data();
+        size_t const aligned = (reinterpret_cast<uintptr_t>(base + offset) + alignment - 1) & ~(alignment - 1);
+        size_t const end = aligned - reinterpret_cast<uintptr_t>(base) + size;
+        if (end > target->size) {
+            return nullptr;
+        }
+
+        _current = target;
+        _offset = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    inline void* arena_resource::allocate(size_t size, size_t alignment) {
+        // walk forward through blocks retained from before the last reset
+        block* target = _current != nullptr ? _current : _first;
+        size_t offset = _current != nullptr ? _offset : 0;
+        for (; target != nullptr; target = target->next, offset = 0) {
+            if (void* const memory = _allocateFrom(target, offset, size, alignment)) {
+                return memory;
+            }
+        }
+
+        size_t const padding = alignment > alignof(block) ? alignment : 0;
+        size_t const dataSize = size + padding > _blockSize ? size + padding : _blockSize;
+        void* const memory = allocate_from(nullptr, sizeof(block) + dataSize, alignof(block));
+        auto* const added = new (memory) block{.next = nullptr, .size = dataSize};
+
+        if (_last != nullptr) {
+            _last->next = added;
+        }
+        else {
+            _first = added;
+        }
+        _last = added;
+        _capacity += dataSize;
+
+        return _allocateFrom(added, 0, size, alignment);
+    }
+
+    void arena_resource::release() noexcept {
+        for (block* current = _first; current != nullptr;) {
+            block* const next = current->next;
+            deallocate_to(nullptr, current, sizeof(block) + current->size, alignof(block));
+            current = next;
+        }
+        _first = _last = _current = nullptr;
+        _offset = 0;
+        _capacity = 0;
+    }
+} // namespace up
@@ -34,7 +34,9 @@ namespace up {
 
             template <callable_r<ReturnType, ParamTypes...> Functor>
             // NOLINTNEXTLINE(bugprone-forwarding-reference-overload)
-            delegate_ref_holder(Functor&& functor) noexcept requires(!same_as<Functor, delegate_ref_holder>) {
+            delegate_ref_holder(Functor&& functor) noexcept
+                requires(!same_as<std::remove_cvref_t<Functor>, delegate_ref_holder>)
+            {
                 using FunctorType = std::remove_reference_t<Functor>;
                 _call = &_detail::delegate_ref_thunk<FunctorType, ReturnType, ParamTypes...>;
                 _functor = &functor;
@@ -58,12 +60,12 @@ public:
 
     template <callable_r<ReturnType, ParamTypes...> Functor>
     // NOLINTNEXTLINE(bugprone-forwarding-reference-overload)
-    /*implicit*/ delegate_ref(Functor&& functor) noexcept requires(!same_as<Functor, delegate_ref>)
+    /*implicit*/ delegate_ref(Functor&& functor) noexcept requires(!same_as<std::remove_cvref_t<Functor>, delegate_ref>)
         : _holder(std::forward<Functor>(functor)) { }
 
     template <callable_r<ReturnType, ParamTypes...> Functor>
     // NOLINTNEXTLINE(bugprone-forwarding-reference-overload)
-    delegate_ref& operator=(Functor&& functor) noexcept requires(!same_as<Functor, delegate_ref>) {
+    delegate_ref& operator=(Functor&& functor) noexcept requires(!same_as<std::remove_cvref_t<Functor>, delegate_ref>) {
         _holder = holder_t(std::forward<Functor>(functor));
         return *this;
     }
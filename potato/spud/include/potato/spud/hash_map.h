@@ -9,13 +9,6 @@
 #include "span.h"
 #include "utility.h"
 
-#if UP_ARCH_INTEL
-#    include <emmintrin.h>
-#    include <tmmintrin.h>
-#else
-#    error "Unsupported architecture"
-#endif
-
 #include <bit>
 
 namespace up {
@@ -88,9 +81,9 @@ namespace up {
     /// show that supporting the floating group windows offers a ~10% read improvement with a ~-5% write
     /// regression.
     ///
-    /// Our non-SSE fallback is also far less optimized, as we only intend to support SSE at this time.
-    /// The portable implementation of SwissTable also changes some bits of layout (e.g. group width) and
-    /// supporting this complicates the code.
+    /// Group matching uses SSE on x86-64 (with opt-in paired AVX2 lookups), NEON on ARM64, and a
+    /// 64-bit SWAR fallback elsewhere. All backends share the 16-slot group layout; unlike the portable
+    /// SwissTable we do not shrink groups to 8 slots for the fallback.
     ///
     template <typename Key, typename Value, typename Hash = uhash<>, typename Equality = equality>
     class hash_map {
@@ -111,6 +104,9 @@ namespace up {
         };
 
         constexpr hash_map() noexcept = default;
+
+        /// Creates an empty table that allocates from the given resource.
+        constexpr explicit hash_map(memory_resource* resource) noexcept : _resource(resource) { }
         constexpr ~hash_map() noexcept {
             clear();
             _drop();
@@ -120,13 +116,17 @@ namespace up {
             : _size(rhs._size)
             , _groups(rhs._groups)
             , _control(rhs._control)
-            , _items(rhs._items) {
+            , _items(rhs._items)
+            , _resource(rhs._resource) {
             rhs._groups = rhs._size = 0;
             rhs._control = nullptr;
             rhs._items = nullptr;
         }
         constexpr hash_map& operator=(hash_map&& rhs) noexcept;
 
+        /// Source of the table's memory; null for the global heap.
+        [[nodiscard]] constexpr memory_resource* resource() const noexcept { return _resource; }
+
         [[nodiscard]] constexpr bool empty() const noexcept { return _size == 0; }
         [[nodiscard]] constexpr size_type size() const noexcept { return _size; }
         [[nodiscard]] constexpr size_type capacity() const noexcept {
@@ -169,7 +169,7 @@ namespace up {
 
     private:
         using control_type = int8;
-        using match_ops = _detail::hash_table::match_ops_sse;
+        using match_ops = _detail::hash_table::match_ops;
         using memory_ops = _detail::hash_table::memory_ops<item_type>;
         using hash_ops = _detail::hash_table::hash_ops<hash_type>;
         using table_ops = _detail::hash_table::table_ops<
@@ -191,6 +191,7 @@ namespace up {
         size_type _groups = 0;
         control_type* _control = nullptr;
         item_type* _items = nullptr;
+        memory_resource* _resource = nullptr;
     };
 
     template <typename Key, typename Value, typename Hash, typename Equality>
@@ -203,6 +204,7 @@ namespace up {
             _groups = rhs._groups;
             _control = rhs._control;
             _items = rhs._items;
+            _resource = rhs._resource;
 
             rhs._size = rhs._groups = 0;
             rhs._control = nullptr;
@@ -254,7 +256,7 @@ namespace up {
 
     template <typename Key, typename Value, typename Hash, typename Equality>
     constexpr void hash_map<Key, Value, Hash, Equality>::_drop() noexcept {
-        memory_ops::deallocate(_groups, _control);
+        memory_ops::deallocate(_groups, _control, _resource);
 
         _groups = 0;
         _control = nullptr;
@@ -270,7 +272,7 @@ namespace up {
 
         _groups = temp._groups != 0 ? temp._groups << 1 : 1;
 
-        memory_ops::allocate(_groups, _control, _items);
+        memory_ops::allocate(_groups, _control, _items, _resource);
 
         if (temp._groups != 0) {
             auto const oldCapacity = temp.capacity();
@@ -9,13 +9,6 @@
 #include "span.h"
 #include "utility.h"
 
-#if UP_ARCH_INTEL
-#    include <emmintrin.h>
-#    include <tmmintrin.h>
-#else
-#    error "Unsupported architecture"
-#endif
-
 #include <bit>
 
 namespace up {
@@ -33,6 +26,9 @@ namespace up {
         using hash_type = hash_result_t<Hash, Value>;
 
         constexpr hash_set() noexcept = default;
+
+        /// Creates an empty table that allocates from the given resource.
+        constexpr explicit hash_set(memory_resource* resource) noexcept : _resource(resource) { }
         constexpr ~hash_set() noexcept {
             clear();
             _drop();
@@ -42,13 +38,17 @@ namespace up {
             : _size(rhs._size)
             , _groups(rhs._groups)
             , _control(rhs._control)
-            , _items(rhs._items) {
+            , _items(rhs._items)
+            , _resource(rhs._resource) {
             rhs._groups = rhs._size = 0;
             rhs._control = nullptr;
             rhs._items = nullptr;
         }
         constexpr hash_set& operator=(hash_set&& rhs) noexcept;
 
+        /// Source of the table's memory; null for the global heap.
+        [[nodiscard]] constexpr memory_resource* resource() const noexcept { return _resource; }
+
         [[nodiscard]] constexpr bool empty() const noexcept { return _size == 0; }
         [[nodiscard]] constexpr size_type size() const noexcept { return _size; }
         [[nodiscard]] constexpr size_type capacity() const noexcept {
@@ -87,7 +87,7 @@ namespace up {
     private:
         using item_type = Value;
         using control_type = int8;
-        using match_ops = _detail::hash_table::match_ops_sse;
+        using match_ops = _detail::hash_table::match_ops;
         using memory_ops = _detail::hash_table::memory_ops<item_type>;
         using hash_ops = _detail::hash_table::hash_ops<hash_type>;
         using table_ops = _detail::hash_table::table_ops<item_type, Value, Hash, Equality, hash_ops, match_ops>;
@@ -103,6 +103,7 @@ namespace up {
         size_type _groups = 0;
         control_type* _control = nullptr;
         item_type* _items = nullptr;
+        memory_resource* _resource = nullptr;
     };
 
     template <typename Value, typename Hash, typename Equality>
@@ -114,6 +115,7 @@ namespace up {
             _groups = rhs._groups;
             _control = rhs._control;
             _items = rhs._items;
+            _resource = rhs._resource;
 
             rhs._size = rhs._groups = 0;
             rhs._control = nullptr;
@@ -165,7 +167,7 @@ namespace up {
 
     template <typename Value, typename Hash, typename Equality>
     constexpr void hash_set<Value, Hash, Equality>::_drop() noexcept {
-        memory_ops::deallocate(_groups, _control);
+        memory_ops::deallocate(_groups, _control, _resource);
 
         _groups = 0;
         _control = nullptr;
@@ -181,7 +183,7 @@ namespace up {
 
         _groups = temp._groups != 0 ? temp._groups << 1 : 1;
 
-        memory_ops::allocate(_groups, _control, _items);
+        memory_ops::allocate(_groups, _control, _items, _resource);
 
         if (temp._groups != 0) {
             auto const oldCapacity = temp.capacity();
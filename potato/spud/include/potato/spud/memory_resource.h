@@ -0,0 +1,40 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#pragma once
+
+#include "int_types.h"
+
+#include <new>
+
+namespace up {
+    /// Polymorphic source of memory for the spud containers.
+    ///
+    /// Containers hold a nullable pointer to a resource; a null resource means
+    /// the global operator new and delete, so a container that never opts in
+    /// pays only for a pointer test on allocation.
+    class memory_resource {
+    public:
+        virtual ~memory_resource() = default;
+
+        [[nodiscard]] virtual void* allocate(size_t size, size_t alignment) = 0;
+        virtual void deallocate(void* memory, size_t size, size_t alignment) noexcept = 0;
+    };
+
+    /// Allocates from the resource, or from the global heap if resource is null.
+    [[nodiscard]] inline void* allocate_from(memory_resource* resource, size_t size, size_t alignment) {
+        if (resource == nullptr) {
+            return operator new(size, std::align_val_t(alignment));
+        }
+        return resource->allocate(size, alignment);
+    }
+
+    /// Returns memory obtained from allocate_from with the same resource.
+    inline void deallocate_to(memory_resource* resource, void* memory, size_t size, size_t alignment) noexcept {
+        if (resource == nullptr) {
+            ::operator delete(memory, size, std::align_val_t(alignment));
+        }
+        else if (memory != nullptr) {
+            resource->deallocate(memory, size, alignment);
+        }
+    }
+} // namespace up
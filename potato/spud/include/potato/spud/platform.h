@@ -49,6 +49,20 @@
 #    define UP_ARCH_64 1
 #    define UP_ARCH_LP64 1
 #    define UP_ARCH_CACHELINE 64
+#elif defined(_M_ARM64)
+#    define UP_ARCH_LITTLE_ENDIAN 1
+#    define UP_ARCH_ARM 1
+#    define UP_ARCH_ARM64 1
+#    define UP_ARCH_64 1
+#    define UP_ARCH_LLP64 1
+#    define UP_ARCH_CACHELINE 64
+#elif defined(__aarch64__)
+#    define UP_ARCH_LITTLE_ENDIAN 1
+#    define UP_ARCH_ARM 1
+#    define UP_ARCH_ARM64 1
+#    define UP_ARCH_64 1
+#    define UP_ARCH_LP64 1
+#    define UP_ARCH_CACHELINE 64
 #else
 //#    error "Unsupported architecture"
 #endif
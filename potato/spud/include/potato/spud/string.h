@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "int_types.h"
+#include "memory_resource.h"
 #include "string_util.h"
 #include "string_view.h"
 #include "zstring_view.h"
@@ -24,6 +26,10 @@ namespace up {
     inline string operator"" _s(char const* str, size_t size);
 } // namespace up
 
+/// Owning, immutable string.
+///
+/// Strings of up to inline_capacity characters are stored inline in the
+/// object itself and never allocate; longer strings live on the heap.
 class up::string {
 public:
     using value_type = char;
@@ -36,108 +42,94 @@ public:
 
     static constexpr size_type npos = ~size_type{0};
 
+    /// Longest string that is stored without a heap allocation.
+    static constexpr size_type inline_capacity = 22;
+
     constexpr string() noexcept = default;
-    ~string() { _free(_data, _size); }
+    ~string() { _free(); }
 
-    /*implicit*/ string(string const& str) : _data(_copy(str._data, str._size)), _size(str._size) { }
-    constexpr string(string&& rhs) noexcept : _data(rhs._data), _size(rhs._size) {
-        rhs._data = nullptr;
-        rhs._size = 0;
+    /*implicit*/ string(string const& str) { _init(str.data(), str.size()); }
+    constexpr string(string&& rhs) noexcept : _storage(rhs._storage) { rhs._storage = Storage{}; }
+    /*implicit*/ string(const_pointer zstr) {
+        if (zstr != nullptr) {
+            _init(zstr, stringLength(zstr));
+        }
     }
-    /*implicit*/ string(const_pointer zstr) : _size(zstr != nullptr ? stringLength(zstr) : 0) {
-        _data = _copy(zstr, _size);
+    /*implicit*/ string(const_pointer data, size_type size) { _init(data, size); }
+    explicit string(zstring_view view) { _init(view.data(), view.size()); }
+    explicit string(string_view view) { _init(view.data(), view.size()); }
+
+    /// Copies the string, allocating from the given resource if it does not fit inline.
+    string(string_view view, memory_resource* resource) {
+        if (resource == nullptr || view.size() <= inline_capacity) {
+            _init(view.data(), view.size());
+        }
+        else {
+            _initFrom(resource, view.data(), view.size());
+        }
     }
-    /*implicit*/ string(const_pointer data, size_type size) : _data(_copy(data, size)), _size(size) { }
-    explicit string(zstring_view view) : _data(_copy(view.data(), view.size())), _size(view.size()) { }
-    explicit string(string_view view) : _data(_copy(view.data(), view.size())), _size(view.size()) { }
 
+    /// Adopts a buffer of length+1 characters allocated with new[].
     static string take_ownership(pointer str, size_type length) noexcept {
         string s;
-        s._data = str;
-        s._size = length;
+        if (str != nullptr) {
+            s._storage.heap = Heap{.tag = _heapTag, .data = str, .size = length};
+        }
         return s;
     }
 
     string& operator=(string const& rhs) {
-        _free(_data, _size);
-        _data = _copy(rhs._data, rhs._size);
-        _size = rhs._size;
+        if (this != &rhs) {
+            string{rhs}.swap(*this);
+        }
         return *this;
     }
 
     string& operator=(string&& rhs) noexcept {
         if (this != &rhs) {
-            _free(_data, _size);
-            _size = rhs._size;
-            _data = rhs.release();
+            _free();
+            _storage = rhs._storage;
+            rhs._storage = Storage{};
         }
         return *this;
     }
 
-    constexpr const_pointer c_str() const noexcept { return _data != nullptr ? _data : _empty; }
+    constexpr const_pointer c_str() const noexcept { return data(); }
 
-    constexpr const_pointer data() const noexcept { return _data != nullptr ? _data : _empty; }
-    constexpr size_type size() const noexcept { return _size; }
+    constexpr const_pointer data() const noexcept { return _isHeap() ? _storage.heap.data : _storage.small.chars; }
+    constexpr size_type size() const noexcept { return _isHeap() ? _storage.heap.size : _storage.small.tag; }
 
-    constexpr bool empty() const noexcept { return _size == 0; }
-    constexpr explicit operator bool() const noexcept { return _size != 0; }
+    constexpr bool empty() const noexcept { return size() == 0; }
+    constexpr explicit operator bool() const noexcept { return size() != 0; }
 
-    constexpr const_iterator begin() const noexcept { return _data; }
-    constexpr const_iterator end() const noexcept { return _data + _size; }
+    constexpr const_iterator begin() const noexcept { return data(); }
+    constexpr const_iterator end() const noexcept { return data() + size(); }
 
-    constexpr value_type front() const noexcept { return *_data; }
-    constexpr value_type back() const noexcept { return *(_data + _size - 1); }
+    constexpr value_type front() const noexcept { return *data(); }
+    constexpr value_type back() const noexcept { return *(end() - 1); }
 
-    constexpr value_type operator[](size_type index) const noexcept { return _data[index]; }
+    constexpr value_type operator[](size_type index) const noexcept { return data()[index]; }
 
-    constexpr string_view first(size_type count) const noexcept { return {_data, count}; }
-    constexpr string_view last(size_type count) const noexcept { return {_data + _size - count, count}; }
+    constexpr string_view first(size_type count) const noexcept { return {data(), count}; }
+    constexpr string_view last(size_type count) const noexcept { return {end() - count, count}; }
 
     constexpr string_view substr(size_type offset, size_type count = npos) const noexcept {
-        if (offset > _size) {
-            offset = _size;
-        }
-        auto remaining = _size - offset;
-        if (count > remaining) {
-            count = remaining;
-        }
-        return {_data + offset, count};
+        return string_view{data(), size()}.substr(offset, count);
     }
 
-    constexpr bool starts_with(string_view str) const noexcept {
-        if (str.size() > _size) {
-            return false;
-        }
-        return stringCompare(_data, str.data(), str.size()) == 0;
-    }
-    constexpr bool ends_with(string_view str) const noexcept {
-        if (str.size() > _size) {
-            return false;
-        }
-        return stringCompare(_data + _size - str.size(), str.data(), str.size()) == 0;
-    }
+    constexpr bool starts_with(string_view str) const noexcept { return string_view{data(), size()}.starts_with(str); }
+    constexpr bool ends_with(string_view str) const noexcept { return string_view{data(), size()}.ends_with(str); }
 
     constexpr size_type find(value_type ch) const noexcept {
-        auto iter = stringFindChar(_data, _size, ch);
-        return iter != nullptr ? iter - _data : npos;
+        auto iter = stringFindChar(data(), size(), ch);
+        return iter != nullptr ? iter - data() : npos;
     }
 
     constexpr size_type find_first_of(string_view chars) const noexcept {
-        for (size_type i = 0; i != _size; ++i) {
-            if (chars.find(_data[i]) != string_view::npos) {
-                return i;
-            }
-        }
-        return npos;
+        return string_view{data(), size()}.find_first_of(chars);
     }
-
     constexpr size_type find_last_of(string_view chars) const noexcept {
-        for (size_type i = _size; i != 0; --i) {
-            if (chars.find(_data[i - 1]) != string_view::npos) {
-                return i - 1;
-            }
-        }
-        return npos;
+        return string_view{data(), size()}.find_last_of(chars);
     }
 
     constexpr friend std::strong_ordering operator<=>(string const& lhs, string const& rhs) noexcept {
@@ -162,79 +154,120 @@ public:
         return lhs.size() == rhsSize && stringCompare(lhs.data(), rhs, rhsSize) == 0;
     }
 
-    /*implicit*/ operator string_view() const noexcept { return {_data != nullptr ? _data : _empty, _size}; }
+    /*implicit*/ operator string_view() const noexcept { return {data(), size()}; }
 
-    /*implicit*/ operator zstring_view() const noexcept { return {_data != nullptr ? _data : _empty}; }
+    /*implicit*/ operator zstring_view() const noexcept { return {data()}; }
 
     string& assign(const_pointer str, size_type length) {
-        // RAII ensures self-assign of a range works
-        string tmp;
-        tmp.swap(*this);
-
-        if (length != 0) {
-            _data = _copy(str, length);
-            _size = length;
-        }
-
+        // building a new string first ensures self-assign of a range works
+        string{str, length}.swap(*this);
         return *this;
     }
 
     string& assign(const_pointer zstr) {
-        // RAII ensures self-assign of a range works
-        string tmp;
-        tmp.swap(*this);
-
-        if (zstr != nullptr) {
-            assign(zstr, stringLength(zstr));
-        }
-
+        string{zstr}.swap(*this);
         return *this;
     }
 
-    void reset() {
-        _free(_data, _size);
-        _data = nullptr;
-        _size = 0;
+    void reset() noexcept {
+        _free();
+        _storage = Storage{};
     }
 
-    [[nodiscard]] pointer release() noexcept {
-        pointer tmp = _data;
-        _data = nullptr;
-        _size = 0;
-        return tmp;
+    /// Releases the contents as a new[] allocated buffer owned by the caller.
+    ///
+    /// Inline strings are copied to the heap; empty strings return nullptr.
+    [[nodiscard]] pointer release() {
+        pointer result = nullptr;
+        if (_storage.small.tag == _heapTag) {
+            result = _storage.heap.data;
+        }
+        else if (_storage.small.tag == _resourceTag) {
+            result = _copy(_storage.heap.data, _storage.heap.size);
+            _free();
+        }
+        else if (_storage.small.tag != 0) {
+            result = _copy(_storage.small.chars, _storage.small.tag);
+        }
+        _storage = Storage{};
+        return result;
     }
 
     string& swap(string& other) noexcept {
-        pointer tmp = other._data;
-        size_type tmpSize = other._size;
-        other._data = _data;
-        other._size = _size;
-        _data = tmp;
-        _size = tmpSize;
+        Storage tmp = other._storage;
+        other._storage = _storage;
+        _storage = tmp;
         return *this;
     }
 
 private:
-    [[nodiscard]] static pointer _copy(const_pointer str, size_type length) {
-        if (length == 0) {
-            return nullptr;
+    static constexpr uint8 _heapTag = 0xff;
+    static constexpr uint8 _resourceTag = 0xfe;
+
+    // both layouts start with the tag byte, so it may be read through either
+    // member; inline strings store their length in the tag. Strings allocated
+    // from a memory_resource keep the resource pointer just before their
+    // characters, so that the common case needs no extra space.
+    struct Inline {
+        uint8 tag = 0;
+        char chars[inline_capacity + 1] = {};
+    };
+    struct Heap {
+        uint8 tag;
+        pointer data;
+        size_type size;
+    };
+    union Storage {
+        Inline small{};
+        Heap heap;
+    };
+
+    static_assert(sizeof(Inline) == sizeof(Heap));
+
+    constexpr bool _isHeap() const noexcept { return _storage.small.tag >= _resourceTag; }
+
+    void _init(const_pointer str, size_type length) {
+        if (length <= inline_capacity) {
+            if (length != 0) {
+                std::memcpy(_storage.small.chars, str, length);
+            }
+            _storage.small.chars[length] = 0;
+            _storage.small.tag = static_cast<uint8>(length);
         }
+        else {
+            _storage.heap = Heap{.tag = _heapTag, .data = _copy(str, length), .size = length};
+        }
+    }
 
+    void _initFrom(memory_resource* resource, const_pointer str, size_type length) {
+        void* const block = resource->allocate(sizeof(memory_resource*) + length + 1, alignof(memory_resource*));
+        std::memcpy(block, &resource, sizeof(memory_resource*));
+        auto* const chars = static_cast<pointer>(block) + sizeof(memory_resource*);
+        std::memcpy(chars, str, length);
+        chars[length] = 0;
+        _storage.heap = Heap{.tag = _resourceTag, .data = chars, .size = length};
+    }
+
+    [[nodiscard]] static pointer _copy(const_pointer str, size_type length) {
         auto* p = new value_type[length + 1];
         std::memmove(p, str, length);
         p[length] = 0;
         return p;
     }
 
-    static void _free(const_pointer data, [[maybe_unused]] size_type length) {
-        delete[] data;
-        data = nullptr;
+    void _free() noexcept {
+        if (_storage.small.tag == _heapTag) {
+            delete[] _storage.heap.data;
+        }
+        else if (_storage.small.tag == _resourceTag) {
+            char* const block = _storage.heap.data - sizeof(memory_resource*);
+            memory_resource* resource = nullptr;
+            std::memcpy(&resource, block, sizeof(memory_resource*));
+            resource->deallocate(block, sizeof(memory_resource*) + _storage.heap.size + 1, alignof(memory_resource*));
+        }
     }
 
-    constexpr static value_type _empty[] = "";
-
-    pointer _data = nullptr;
-    size_type _size = 0;
+    Storage _storage;
 };
 
 template <typename HashAlgorithm>
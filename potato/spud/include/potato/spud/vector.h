@@ -6,6 +6,7 @@
 
 #    include "_assertion.h"
 #    include "int_types.h"
+#    include "memory_resource.h"
 #    include "memory_util.h"
 #    include "numeric_util.h"
 #    include "span.h"
@@ -42,6 +43,9 @@ namespace up {
 
         vector() noexcept = default;
 
+        /// Creates an empty vector that allocates from the given resource.
+        explicit vector(memory_resource* resource) noexcept : _resource(resource) { }
+
         template <typename IteratorT, typename SentinelT>
         inline explicit vector(IteratorT begin, SentinelT end) requires std::is_constructible_v<T, deref_t<IteratorT>>;
         template <typename InsertT>
@@ -76,6 +80,9 @@ namespace up {
 
         pointer release() noexcept;
 
+        /// Source of the vector's memory; null for the global heap.
+        memory_resource* resource() const noexcept { return _resource; }
+
         bool empty() const noexcept { return _first == _last; }
         size_type size() const noexcept { return _last - _first; }
         size_type capacity() const noexcept { return _sentinel - _first; }
@@ -155,6 +162,7 @@ namespace up {
         T* _first = nullptr;
         T* _last = nullptr;
         T* _sentinel = nullptr;
+        memory_resource* _resource = nullptr;
     };
 
     template <typename T>
@@ -188,7 +196,8 @@ namespace up {
     template <typename T>
     vector<T>::vector(vector&& src) noexcept : _first(src._first)
                                              , _last(src._last)
-                                             , _sentinel(src._sentinel) {
+                                             , _sentinel(src._sentinel)
+                                             , _resource(src._resource) {
         src._sentinel = src._last = src._first = nullptr;
     }
 
@@ -204,9 +213,11 @@ namespace up {
             clear();
             shrink_to_fit();
 
+            // the memory resource travels with the storage
             _first = src._first;
             _last = src._last;
             _sentinel = src._sentinel;
+            _resource = src._resource;
 
             src._sentinel = src._last = src._first = nullptr;
         }
@@ -226,6 +237,7 @@ namespace up {
         UP_SPUD_ASSERT(
             _last == _sentinel,
             "Releasing memory from a vector that has uninitialized capacity; call resize(capacity()) first!");
+        UP_SPUD_ASSERT(_resource == nullptr, "Releasing memory from a vector that uses a memory resource");
         T* tmp = _first;
         _first = _last = _sentinel = nullptr;
         return tmp;
@@ -234,13 +246,13 @@ namespace up {
     template <typename T>
     T* vector<T>::_allocate(size_type capacity) {
         // NOLINTNEXTLINE(bugprone-sizeof-expression)
-        return static_cast<T*>(operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T*>(allocate_from(_resource, capacity * sizeof(T), alignof(T)));
     }
 
     template <typename T>
     void vector<T>::_deallocate(T* ptr, size_type capacity) {
         // NOLINTNEXTLINE(bugprone-sizeof-expression)
-        ::operator delete(ptr, capacity * sizeof(T), std::align_val_t(alignof(T)));
+        deallocate_to(_resource, ptr, capacity * sizeof(T), alignof(T));
     }
 
     template <typename T>
@@ -0,0 +1,157 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/spud/arena.h"
+#include "potato/spud/hash_map.h"
+#include "potato/spud/string.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <cstdint>
+
+namespace {
+    // forwards to an arena while counting the calls made through it
+    class counting_resource final : public up::memory_resource {
+    public:
+        void* allocate(size_t size, size_t alignment) override {
+            ++allocations;
+            return arena.allocate(size, alignment);
+        }
+        void deallocate(void* memory, size_t size, size_t alignment) noexcept override {
+            ++deallocations;
+            arena.deallocate(memory, size, alignment);
+        }
+
+        up::arena_resource arena;
+        int allocations = 0;
+        int deallocations = 0;
+    };
+} // namespace
+
+TEST_CASE("potato.spud.arena", "[potato][spud]") {
+    using namespace up;
+
+    SECTION("arena_resource") {
+        arena_resource arena(1024);
+
+        void* const first = arena.allocate(16, 16);
+        void* const second = arena.allocate(100, 8);
+        CHECK(reinterpret_cast<uintptr_t>(first) % 16 == 0);
+        CHECK(reinterpret_cast<uintptr_t>(second) % 8 == 0);
+        CHECK(second != first);
+        CHECK(arena.capacity() == 1024);
+
+        void* const large = arena.allocate(4096, 64);
+        CHECK(reinterpret_cast<uintptr_t>(large) % 64 == 0);
+        size_t const capacity = arena.capacity();
+        CHECK(capacity > 1024 + 4096);
+
+        // reuse all blocks after a reset without growing
+        arena.reset();
+        CHECK(arena.allocate(16, 16) == first);
+        CHECK(arena.allocate(100, 8) != nullptr);
+        CHECK(arena.allocate(4096, 64) != nullptr);
+        CHECK(arena.capacity() == capacity);
+
+        arena.release();
+        CHECK(arena.capacity() == 0);
+    }
+
+    SECTION("rewind") {
+        arena_resource arena(256);
+
+        CHECK(arena.allocate(64, 8) != nullptr);
+        auto const mark = arena.mark();
+        void* const scoped = arena.allocate(64, 8);
+        CHECK(arena.allocate(512, 8) != nullptr);
+
+        arena.rewind(mark);
+        CHECK(arena.allocate(64, 8) == scoped);
+    }
+
+    SECTION("frame_arena") {
+        frame_arena frames(1024);
+
+        void* const even = frames.resource()->allocate(64, 8);
+        frames.flip();
+        void* const odd = frames.resource()->allocate(64, 8);
+        CHECK(odd != even);
+
+        // the previous frame's memory is only recycled two flips later
+        frames.flip();
+        CHECK(frames.resource()->allocate(64, 8) == even);
+        frames.flip();
+        CHECK(frames.resource()->allocate(64, 8) == odd);
+    }
+
+    SECTION("scratch_scope") {
+        void* outer = nullptr;
+        {
+            scratch_scope scratch;
+            outer = scratch.resource()->allocate(32, 8);
+            {
+                scratch_scope nested;
+                CHECK(nested.resource()->allocate(32, 8) != outer);
+            }
+        }
+        scratch_scope again;
+        CHECK(again.resource()->allocate(32, 8) == outer);
+    }
+
+    SECTION("vector") {
+        counting_resource resource;
+        {
+            vector<int> values(&resource);
+            for (int index = 0; index != 100; ++index) {
+                values.push_back(index);
+            }
+            CHECK(values.resource() == &resource);
+            CHECK(values.size() == 100);
+            CHECK(values[99] == 99);
+
+            vector<int> moved = std::move(values);
+            CHECK(moved.resource() == &resource);
+            CHECK(moved[42] == 42);
+        }
+        CHECK(resource.allocations != 0);
+        CHECK(resource.allocations == resource.deallocations);
+    }
+
+    SECTION("hash_map") {
+        counting_resource resource;
+        {
+            hash_map<int, int> map(&resource);
+            for (int index = 0; index != 100; ++index) {
+                map.insert(index, index * 2);
+            }
+            CHECK(map.resource() == &resource);
+            CHECK(map.size() == 100);
+            CHECK(map.find(42)->value == 84);
+        }
+        CHECK(resource.allocations != 0);
+        CHECK(resource.allocations == resource.deallocations);
+    }
+
+    SECTION("string") {
+        counting_resource resource;
+        {
+            string small("short"_sv, &resource);
+            CHECK(resource.allocations == 0);
+
+            string large("this string is too long to be stored inline"_sv, &resource);
+            CHECK(resource.allocations == 1);
+            CHECK(large == "this string is too long to be stored inline");
+            CHECK(large.c_str()[large.size()] == 0);
+
+            string moved = std::move(large);
+            CHECK(moved.size() == 43);
+
+            char* const released = moved.release();
+            CHECK(string_view{released} == "this string is too long to be stored inline"_sv);
+            delete[] released;
+
+            string other("another string that is too long to be inline"_sv, &resource);
+        }
+        CHECK(resource.allocations == 2);
+        CHECK(resource.deallocations == 2);
+    }
+}
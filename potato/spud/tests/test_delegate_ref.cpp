@@ -36,4 +36,21 @@ TEST_CASE("potato.spud.delegate_ref", "[potato][spud]") {
         d(4);
         CHECK(i2 == 8);
     }
+
+    SECTION("delegate_ref copy") {
+        auto f1 = [](int i) {
+            return i * 3;
+        };
+        auto f2 = [](int i) {
+            return i * 5;
+        };
+
+        delegate_ref<int(int)> d(f1);
+        // copying a non-const delegate_ref copies the reference rather than wrapping the source
+        delegate_ref<int(int)> copy = d;
+        d = f2;
+
+        CHECK(copy(2) == 6);
+        CHECK(d(2) == 10);
+    }
 }
@@ -0,0 +1,227 @@
+// Copyright by Potato Engine contributors. See accompanying License.txt for copyright details.
+
+#include "potato/spud/_hash_table.h"
+#include "potato/spud/hash_map.h"
+#include "potato/spud/vector.h"
+
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+namespace {
+    using namespace up;
+    using namespace up::_detail::hash_table;
+
+    // minimal table over the shared table_ops, so that each backend can be
+    // exercised independently of the one hash_map selects
+    template <typename MatchOps>
+    struct test_table {
+        using hash_ops = _detail::hash_table::hash_ops<uint64>;
+        using memory_ops = _detail::hash_table::memory_ops<uint64>;
+        using table_ops = _detail::hash_table::table_ops<uint64, uint64, uhash<>, equality, hash_ops, MatchOps>;
+
+        explicit test_table(size_t groupCount) : groups(groupCount) { memory_ops::allocate(groups, control, items); }
+        ~test_table() { memory_ops::deallocate(groups, control); }
+
+        test_table(test_table const&) = delete;
+        test_table& operator=(test_table const&) = delete;
+
+        size_t insert(uint64 key) {
+            auto const hash = uhash<>{}(key);
+            size_t const index = table_ops::findEmptyOrTombstone(groups, control, hash);
+            control[index] = hash_ops::_h2(hash);
+            items[index] = key;
+            return index;
+        }
+
+        size_t find(uint64 key) const { return table_ops::find(groups, control, items, key, uhash<>{}(key)); }
+
+        bool erase(uint64 key) { return table_ops::erase(groups, control, items, key, uhash<>{}(key)); }
+
+        size_t groups = 0;
+        int8* control = nullptr;
+        uint64* items = nullptr;
+    };
+
+    // roughly a quarter of slots are EMPTY or TOMBSTONE
+    int8 randomControl(int value) {
+        if (value < 48) {
+            return constants::EMPTY;
+        }
+        if (value < 64) {
+            return constants::TOMBSTONE;
+        }
+        return static_cast<int8>(value & 0x7f);
+    }
+
+    // reference results for the group match operations
+    unsigned referenceMatch(int8 const* control, int8 match) {
+        unsigned mask = 0;
+        for (int index = 0; index != constants::WIDTH; ++index) {
+            mask |= control[index] == match ? 1u << index : 0u;
+        }
+        return mask;
+    }
+
+    unsigned referenceEmptyOrTombstone(int8 const* control) {
+        return referenceMatch(control, constants::EMPTY) | referenceMatch(control, constants::TOMBSTONE);
+    }
+
+    template <typename MatchOps>
+    void checkGroupParity(int8 const* control) {
+        for (int h2 = 0; h2 != 128; ++h2) {
+            CHECK(MatchOps::match(control, static_cast<int8>(h2)) == referenceMatch(control, static_cast<int8>(h2)));
+        }
+        CHECK(MatchOps::matchEmpty(control) == referenceMatch(control, constants::EMPTY));
+        CHECK(MatchOps::matchEmptyOrTombstone(control) == referenceEmptyOrTombstone(control));
+        CHECK(MatchOps::matchFull(control) == (~referenceEmptyOrTombstone(control) & 0xffff));
+    }
+
+    template <typename MatchOps>
+    vector<size_t> fillAndProbe(vector<uint64> const& keys, size_t groups) {
+        test_table<MatchOps> table(groups);
+        vector<size_t> indices;
+
+        for (uint64 const key : keys) {
+            indices.push_back(table.insert(key));
+        }
+        for (size_t index = 0; index < keys.size(); index += 2) {
+            CHECK(table.erase(keys[index]));
+        }
+        for (size_t index = 0; index != keys.size(); ++index) {
+            size_t const found = table.find(keys[index]);
+            CHECK(found == (index % 2 == 0 ? constants::SENTINEL : indices[index]));
+            indices.push_back(found);
+        }
+        for (size_t index = 0; index < keys.size(); index += 2) {
+            indices.push_back(table.insert(keys[index]));
+        }
+        return indices;
+    }
+} // namespace
+
+TEST_CASE("potato.spud.hash_table", "[potato][spud]") {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> pick(0, 255);
+
+    SECTION("group match parity") {
+        alignas(constants::WIDTH) int8 control[constants::WIDTH];
+
+        for (int round = 0; round != 256; ++round) {
+            for (int8& slot : control) {
+                slot = randomControl(pick(rng));
+            }
+
+            checkGroupParity<match_ops_swar>(control);
+#if UP_ARCH_INTEL
+            checkGroupParity<match_ops_sse>(control);
+#endif
+#if UP_ARCH_ARM64
+            checkGroupParity<match_ops_neon>(control);
+#endif
+        }
+    }
+
+#if UP_ARCH_INTEL && defined(__AVX2__)
+    SECTION("paired group match parity") {
+        alignas(constants::WIDTH) int8 control[constants::WIDTH * 2];
+
+        for (int round = 0; round != 256; ++round) {
+            for (int8& slot : control) {
+                slot = randomControl(pick(rng));
+            }
+
+            int8 const h2 = control[pick(rng) % (constants::WIDTH * 2)] & 0x7f;
+            uint32 const expectedMatch =
+                referenceMatch(control, h2) | (referenceMatch(control + constants::WIDTH, h2) << constants::WIDTH);
+            uint32 const expectedEmpty = referenceMatch(control, constants::EMPTY) |
+                (referenceMatch(control + constants::WIDTH, constants::EMPTY) << constants::WIDTH);
+
+            CHECK(match_ops_avx2::match2(control, control + constants::WIDTH, h2) == expectedMatch);
+            CHECK(match_ops_avx2::matchEmpty2(control, control + constants::WIDTH) == expectedEmpty);
+        }
+    }
+#endif
+
+    SECTION("table parity") {
+        constexpr size_t groups = 64;
+        constexpr size_t count = groups * constants::GROUP_LOAD;
+
+        vector<uint64> keys;
+        for (size_t index = 0; index != count; ++index) {
+            keys.push_back(index * 0x9e37'79b9'7f4a'7c15ull);
+        }
+
+        // every backend walks the same probe sequence, so slot assignment
+        // must be identical and not merely equivalent
+        auto const expected = fillAndProbe<match_ops_swar>(keys, groups);
+        auto const selected = fillAndProbe<match_ops>(keys, groups);
+        CHECK(std::equal(selected.begin(), selected.end(), expected.begin(), expected.end()));
+#if UP_ARCH_INTEL
+        auto const sse = fillAndProbe<match_ops_sse>(keys, groups);
+        CHECK(std::equal(sse.begin(), sse.end(), expected.begin(), expected.end()));
+#endif
+    }
+}
+
+TEST_CASE("potato.spud.hash_table.benchmark", "[.][benchmark]") {
+    constexpr size_t groups = 4'096;
+    constexpr size_t count = groups * constants::GROUP_LOAD * 3 / 4;
+
+    vector<uint64> keys;
+    for (size_t index = 0; index != count; ++index) {
+        keys.push_back(index * 0x9e37'79b9'7f4a'7c15ull);
+    }
+
+    auto const lookups = [&keys](auto const& find) {
+        size_t hits = 0;
+        for (uint64 const key : keys) {
+            hits += find(key);
+            hits += find(key + 1);
+        }
+        return hits;
+    };
+
+    test_table<match_ops_swar> swar(groups);
+    for (uint64 const key : keys) {
+        swar.insert(key);
+    }
+    BENCHMARK("swar") { return lookups([&](uint64 key) { return swar.find(key) != constants::SENTINEL; }); };
+
+#if UP_ARCH_INTEL
+    test_table<match_ops_sse> sse(groups);
+    for (uint64 const key : keys) {
+        sse.insert(key);
+    }
+    BENCHMARK("sse") { return lookups([&](uint64 key) { return sse.find(key) != constants::SENTINEL; }); };
+#endif
+
+#if UP_ARCH_INTEL && defined(__AVX2__)
+    test_table<match_ops_avx2> avx2(groups);
+    for (uint64 const key : keys) {
+        avx2.insert(key);
+    }
+    BENCHMARK("avx2") { return lookups([&](uint64 key) { return avx2.find(key) != constants::SENTINEL; }); };
+#endif
+
+#if UP_ARCH_ARM64
+    test_table<match_ops_neon> neon(groups);
+    for (uint64 const key : keys) {
+        neon.insert(key);
+    }
+    BENCHMARK("neon") { return lookups([&](uint64 key) { return neon.find(key) != constants::SENTINEL; }); };
+#endif
+
+    hash_map<uint64, uint64> map;
+    for (uint64 const key : keys) {
+        map.insert(key, key);
+    }
+    BENCHMARK("up::hash_map") { return lookups([&](uint64 key) { return map.contains(key); }); };
+
+    std::unordered_map<uint64, uint64> stdMap;
+    for (uint64 const key : keys) {
+        stdMap.emplace(key, key);
+    }
+    BENCHMARK("std::unordered_map") { return lookups([&](uint64 key) { return stdMap.count(key) != 0; }); };
+}
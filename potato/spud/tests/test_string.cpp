@@ -3,8 +3,33 @@
 #include "potato/spud/string.h"
 
 #include <catch2/catch.hpp>
+#include <cstdlib>
+#include <new>
 #include <ostream>
 
+namespace {
+    // up::string allocates its heap buffers with new[], which is replaced
+    // here so that the tests can observe when allocations happen
+    int arrayAllocations = 0;
+
+    struct AllocationCounter {
+        int const start = arrayAllocations;
+
+        int count() const noexcept { return arrayAllocations - start; }
+    };
+} // namespace
+
+void* operator new[](std::size_t size) {
+    ++arrayAllocations;
+    if (void* const memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
 TEST_CASE("potato.spud.string", "[potato][spud]") {
     using namespace up;
 
@@ -98,4 +123,59 @@ TEST_CASE("potato.spud.string", "[potato][spud]") {
 
         s.reset();
     }
+
+    SECTION("inline storage") {
+        AllocationCounter allocs;
+
+        string empty;
+        string s("short name"_sv);
+        string full("0123456789012345678901"_sv);
+        string copy = full;
+        string moved = std::move(copy);
+
+        CHECK(allocs.count() == 0);
+        CHECK(full.size() == string::inline_capacity);
+        CHECK(moved == full);
+        CHECK(s.c_str() == "short name"_sv);
+        CHECK(s.c_str()[s.size()] == 0);
+        CHECK(empty.c_str() != nullptr);
+        CHECK(*empty.c_str() == 0);
+    }
+
+    SECTION("heap storage") {
+        AllocationCounter allocs;
+
+        string s("this string is too long to be stored inline"_sv);
+        CHECK(allocs.count() == 1);
+
+        string copy = s;
+        CHECK(allocs.count() == 2);
+
+        string moved = std::move(copy);
+        CHECK(allocs.count() == 2);
+        CHECK(moved == s);
+        CHECK(moved.c_str() == "this string is too long to be stored inline"_sv);
+    }
+
+    SECTION("self assignment") {
+        string s("this string is too long to be stored inline"_sv);
+        s.assign(s.data() + 5, 6);
+        CHECK(s == "string");
+
+        string t("short"_sv);
+        t.assign(t.data() + 1, 3);
+        CHECK(t == "hor");
+    }
+
+    SECTION("release") {
+        string s("short"_sv);
+        char* released = s.release();
+
+        CHECK(s.empty());
+        CHECK(string_view{released} == "short"_sv);
+        delete[] released;
+
+        string empty;
+        CHECK(empty.release() == nullptr);
+    }
 }